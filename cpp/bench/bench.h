@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+/// Keeps the optimizer from discarding a computed value.
+template <class T>
+inline void keep(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Calls `fn` until at least `min_time` has passed and returns the mean wall
+/// time per call in nanoseconds.
+template <class F>
+double measure(F&& fn,
+               std::chrono::nanoseconds min_time = std::chrono::milliseconds{
+                   300}) {
+  fn();
+  size_t iters{0};
+  auto start = Clock::now();
+  Clock::duration elapsed{};
+  do {
+    fn();
+    ++iters;
+    elapsed = Clock::now() - start;
+  } while (elapsed < min_time);
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iters;
+}
+
+/// Calls to global operator new so far in this process.
+size_t allocations();
+/// Bytes allocated with global operator new and not yet deleted.
+size_t live_bytes();
+
+/// Mean heap allocations per call of `fn`.
+template <class F>
+double allocations_per_call(F&& fn, size_t calls = 100) {
+  fn();
+  auto before = allocations();
+  for (size_t i{0}; i < calls; ++i) fn();
+  return static_cast<double>(allocations() - before) / calls;
+}
+
+/// Prints a timing line; throughput is added when `bytes` is non-zero.
+void report(std::string_view name, double ns, size_t bytes = 0);
+/// Prints a non-timing measurement such as a memory footprint.
+void report(std::string_view name, double value, std::string_view unit);
+
+struct Registrar {
+  Registrar(const char* name, void (*fn)());
+};
+
+/// A synthetic script of roughly `bytes` bytes shaped like our generated
+/// rule files: many independent top-level lets binding functions, long
+/// identifiers, integer literals and calls.
+std::string generate_script(size_t bytes);
+
+} // namespace bench
+
+#define BENCH_CAT2(a, b) a##b
+#define BENCH_CAT(a, b)  BENCH_CAT2(a, b)
+#define BENCH(name)                                                            \
+  static void BENCH_CAT(bench_fn_, __LINE__)();                                \
+  static const bench::Registrar BENCH_CAT(bench_reg_, __LINE__){               \
+      name, BENCH_CAT(bench_fn_, __LINE__)};                                   \
+  static void BENCH_CAT(bench_fn_, __LINE__)()
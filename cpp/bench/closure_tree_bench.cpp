@@ -0,0 +1,48 @@
+#include <monkey/closure_tree.h>
+#include <monkey/evaluator.h>
+#include <monkey/parser.h>
+
+#include <string>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+
+BENCH("closure tree") {
+  // The same programs as "eval" and "eval calls", once walked and once
+  // lowered to closures, which no longer decide anything by node kind.
+  string src{};
+  for (int i{0}; i < 200; ++i) {
+    src += "(-3 + 4 * 5 - 6 / 2) * 2 + 7 < 100 == !false;\n";
+  }
+  TokenStream tokens{src};
+  auto program = Parser{tokens}.parse_program();
+  closure::Tree tree{program};
+  report("arithmetic, tree-walker", measure([&] { keep(eval(program)); }));
+  report("arithmetic, closures", measure([&] { keep(tree.run()); }));
+  report("lowering", measure([&] { keep(closure::Tree{program}); }));
+
+  TokenStream fib_tokens{R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(20);
+)"};
+  auto fib = Parser{fib_tokens}.parse_program();
+  closure::Tree fib_tree{fib};
+  report("fib(20), tree-walker", measure([&] { keep(eval(fib)); }));
+  report("fib(20), closures", measure([&] { keep(fib_tree.run()); }));
+
+  TokenStream loop_tokens{R"(
+let loop = fn(i, acc) { if (i == 0) { acc } else { loop(i - 1, acc + i) } };
+loop(10000, 0);
+)"};
+  auto loop = Parser{loop_tokens}.parse_program();
+  closure::Tree loop_tree{loop};
+  report("tail-recursive loop, tree-walker",
+         measure([&] { keep(eval(loop)); }));
+  report("tail-recursive loop, closures",
+         measure([&] { keep(loop_tree.run()); }));
+}
@@ -0,0 +1,42 @@
+#include <monkey/compiler.h>
+#include <monkey/parser.h>
+#include <monkey/register_vm.h>
+#include <monkey/vm.h>
+
+#include <string>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+
+BENCH("dispatch") {
+  // Runs of the cheapest instructions there are, so the time per
+  // instruction is mostly the cost of getting from one to the next. Build
+  // with -DMONKEY_COMPUTED_GOTO=OFF to compare against the plain switch.
+  string src{"let f = fn(a, b) {\n"};
+  for (int i{0}; i < 50; ++i) src += "  a + b == b + a; a - b < b - a;\n";
+  src += R"(  0
+};
+let loop = fn(i) { if (i == 0) { 0 } else { f(i, 2); loop(i - 1) } };
+loop(500);
+)";
+  Lexer l{src};
+  auto program = Parser{l}.parse_program();
+
+  Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  VM vm{};
+  reg::Compiler reg_compiler{};
+  auto reg_bytecode = reg_compiler.compile(program);
+  reg::VM reg_vm{};
+
+  string mode{threaded_dispatch() ? "computed goto" : "switch"};
+  auto stack = measure([&] { keep(vm.run(bytecode)); });
+  report("stack, " + mode + ", per instruction", stack / vm.dispatched);
+  auto regs = measure([&] { keep(reg_vm.run(reg_bytecode)); });
+  report("register, " + mode + ", per instruction", regs / reg_vm.dispatched);
+}
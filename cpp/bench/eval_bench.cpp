@@ -0,0 +1,99 @@
+#include <monkey/evaluator.h>
+#include <monkey/parser.h>
+
+#include <string>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+
+BENCH("eval") {
+  // Straight-line arithmetic: every node visit is dispatch plus one small
+  // operation, so this is dominated by the evaluator's per-node overhead.
+  string src{};
+  for (int i{0}; i < 200; ++i) {
+    src += "(-3 + 4 * 5 - 6 / 2) * 2 + 7 < 100 == !false;\n";
+  }
+  TokenStream tokens{src};
+  auto program = Parser{tokens}.parse_program();
+  FlatAst flat{program};
+  auto nodes = static_cast<double>(flat.nodes.size());
+
+  report("tree, per node", measure([&] { keep(eval(program)); }) / nodes);
+  report("flat, per node", measure([&] { keep(eval(flat)); }) / nodes);
+  report("tree, allocations per node",
+         bench::allocations_per_call([&] { keep(eval(program)); }) / nodes,
+         "");
+}
+
+BENCH("eval calls") {
+  auto fib = R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(20);
+)";
+  Lexer l{fib};
+  auto program = Parser{l}.parse_program();
+  report("fib(20)", measure([&] { keep(eval(program)); }));
+  FlatAst flat{program};
+  report("fib(20), flat", measure([&] { keep(eval(flat)); }));
+
+  // Every call is in tail position, so the loop reuses one native frame.
+  auto loop = R"(
+let loop = fn(i, acc) { if (i == 0) { acc } else { loop(i - 1, acc + i) } };
+loop(10000, 0);
+)";
+  Lexer loop_lexer{loop};
+  auto loop_program = Parser{loop_lexer}.parse_program();
+  report("tail-recursive loop, per iteration",
+         measure([&] { keep(eval(loop_program)); }) / 10000);
+}
+
+BENCH("eval closures") {
+  // A chain of closures, each made by a call with more locals than it
+  // uses, so what a closure keeps alive shows up in the bytes per link.
+  auto chain = R"(
+let make = fn(n, rest) {
+  let a = n * 2;
+  let b = a + 1;
+  let c = b * a;
+  let d = c - b;
+  fn() { n + rest() }
+};
+let build = fn(n, acc) {
+  if (n == 0) { acc } else { build(n - 1, make(n, acc)) }
+};
+build(500, fn() { 0 });
+)";
+  Lexer chain_lexer{chain};
+  auto chain_program = Parser{chain_lexer}.parse_program();
+  auto before = bench::live_bytes();
+  {
+    auto links = eval(chain_program);
+    report("bytes kept per closure",
+           static_cast<double>(bench::live_bytes() - before) / 500,
+           "B");
+  }
+
+  // Variables read from three functions out, on every iteration.
+  auto upvalues = R"(
+let outer = fn(a) {
+  fn(b) {
+    fn(c) {
+      let loop = fn(i, acc) {
+        if (i == 0) { acc } else { loop(i - 1, acc + a + b + c) }
+      };
+      loop(300, 0)
+    }
+  }
+};
+outer(1)(2)(3);
+)";
+  Lexer upvalue_lexer{upvalues};
+  auto upvalue_program = Parser{upvalue_lexer}.parse_program();
+  report("loop reading captures, per iteration",
+         measure([&] { keep(eval(upvalue_program)); }) / 300);
+}
@@ -0,0 +1,27 @@
+#include <monkey/evaluator.h>
+#include <monkey/jit.h>
+#include <monkey/parser.h>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+
+BENCH("jit") {
+  // Integer recursion, all calls and arithmetic: the tree-walker's worst
+  // case, and the JIT's best.
+  TokenStream tokens{R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(20);
+)"};
+  auto program = Parser{tokens}.parse_program();
+  auto env     = std::make_shared<object::Environment>();
+
+  report("fib(20), tree-walker", measure([&] { keep(eval(program, env)); }));
+  if (!jit::available()) return;
+  jit::Jit jit{};
+  report("fib(20), jit",
+         measure([&] { keep(eval(program, env, &jit)); }));
+}
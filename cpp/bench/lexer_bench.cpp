@@ -0,0 +1,63 @@
+#include <monkey/lexer.h>
+#include <monkey/scan.h>
+
+#include <string>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+
+BENCH("lexer") {
+  auto src = bench::generate_script(8 << 20);
+
+  report("next_token",
+         measure([&] {
+           Lexer lex{std::string_view{src}};
+           for (auto t = lex.next_token(); t.type != Token::Type::EOF_;
+                t      = lex.next_token())
+             keep(t);
+         }),
+         src.size());
+
+  report("next_view",
+         measure([&] {
+           Lexer lex{std::string_view{src}};
+           for (auto t = lex.next_view(); t.type != Token::Type::EOF_;
+                t      = lex.next_view())
+             keep(t);
+         }),
+         src.size());
+}
+
+BENCH("scan") {
+  auto run = [](const char* name, const string& src, auto skip) {
+    report(name,
+           measure([&] {
+             const char* p = src.data();
+             const char* e = src.data() + src.size();
+             // Runs of 63 class bytes separated by one terminator.
+             while (p < e) p = skip(p, e) + 1;
+             keep(p);
+           }),
+           src.size());
+  };
+  auto runs = [](string run) {
+    string out{};
+    while (out.size() < (4 << 20)) out += run + "#";
+    return out;
+  };
+  auto spaces  = runs(string(63, ' '));
+  auto letters = runs(string(63, 'q'));
+  auto digits  = runs(string(63, '7'));
+
+  run("whitespace scalar", spaces, scan::scalar::skip_whitespace);
+  run("whitespace simd", spaces, scan::skip_whitespace);
+  run("letters scalar", letters, scan::scalar::skip_letters);
+  run("letters simd", letters, scan::skip_letters);
+  run("digits scalar", digits, scan::scalar::skip_digits);
+  run("digits simd", digits, scan::skip_digits);
+}
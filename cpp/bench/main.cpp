@@ -0,0 +1,120 @@
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace bench {
+
+std::atomic<size_t> allocation_count{0};
+std::atomic<size_t> live_byte_count{0};
+
+size_t allocations() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+size_t live_bytes() {
+  return live_byte_count.load(std::memory_order_relaxed);
+}
+
+struct Case {
+  const char* name;
+  void (*fn)();
+};
+
+vector<Case>& registry() {
+  static vector<Case> cases{};
+  return cases;
+}
+
+Registrar::Registrar(const char* name, void (*fn)()) {
+  registry().push_back({name, fn});
+}
+
+void report(string_view name, double ns, size_t bytes) {
+  fmt::print("  {:<44} {:>12.1f} ns/op", name, ns);
+  if (bytes) fmt::print(" {:>10.1f} MB/s", bytes / ns * 1e9 / (1 << 20));
+  fmt::print("\n");
+}
+
+void report(string_view name, double value, string_view unit) {
+  fmt::print("  {:<44} {:>12.1f} {}\n", name, value, unit);
+}
+
+/// Identifiers are letters only, so indices are spelled out in them.
+string letters(size_t i) {
+  string s{};
+  do s += static_cast<char>('a' + i % 26);
+  while (i /= 26);
+  return s;
+}
+
+string generate_script(size_t bytes) {
+  string out{};
+  out.reserve(bytes + 512);
+  for (size_t i{0}; out.size() < bytes; ++i) {
+    out += fmt::format(R"(let rule_{0} = fn(first_argument, second_argument) {{
+    if (first_argument < second_argument) {{
+        return first_argument * 2 + second_argument;
+    }} else {{
+        return second_argument - first_argument / 3;
+    }}
+}};
+let limit_{0} = 1000000 + {1};
+let result_{0} = rule_{0}(limit_{0}, 424242);
+)",
+                       letters(i),
+                       i);
+  }
+  return out;
+}
+
+} // namespace bench
+
+//<editor-fold desc="allocation counting">
+// Each block starts with a header holding its size, so delete can tell how
+// many bytes go back.
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+  bench::allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (auto* p = static_cast<char*>(std::malloc(HEADER + size))) {
+    *reinterpret_cast<size_t*>(p) = size;
+    bench::live_byte_count.fetch_add(size, std::memory_order_relaxed);
+    return p + HEADER;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+  if (!p) return;
+  auto* block = static_cast<char*>(p) - HEADER;
+  bench::live_byte_count.fetch_sub(*reinterpret_cast<size_t*>(block),
+                                   std::memory_order_relaxed);
+  std::free(block);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+//</editor-fold>
+
+int main(int argc, char* argv[]) {
+  string_view filter = argc > 1 ? argv[1] : "";
+  for (auto& c : bench::registry()) {
+    if (string_view{c.name}.find(filter) == string_view::npos) continue;
+    fmt::print("{}\n", c.name);
+    c.fn();
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <monkey/parser.h>
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::Clock;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+using std::vector;
+
+BENCH("parse") {
+  auto src = bench::generate_script(8 << 20);
+
+  report("sequential",
+         measure([&] {
+           Lexer lex{std::string_view{src}};
+           Parser parser{lex};
+           keep(parser.parse_program().statements.size());
+         }),
+         src.size());
+
+  for (unsigned threads : {2u, 4u, std::thread::hardware_concurrency()}) {
+    report(fmt::format("parallel, {} threads", threads),
+           measure([&] {
+             vector<string> errors{};
+             auto program = parse_program_parallel(src, errors, threads);
+             keep(program.statements.size());
+           }),
+           src.size());
+  }
+}
+
+BENCH("parse expression") {
+  // REPL-sized inputs, where building the Parser is a large share of the work.
+  string src = "(5 + 10 * 2 + 15 / 3) * 2 + -10 == !(a < b)";
+
+  report("Parser construction + parse",
+         measure([&] {
+           TokenStream tokens{src};
+           Parser parser{tokens};
+           keep(parser.parse_program().statements.size());
+         }),
+         src.size());
+
+  TokenStream tokens{src};
+  report("Parser over a ready TokenStream", measure([&] {
+           Parser parser{tokens};
+           keep(parser.parse_program().statements.size());
+         }));
+}
+
+BENCH("ast lifetime") {
+  // Batch runs parse a script, evaluate it once and throw the tree away, so
+  // freeing it is on the critical path too.
+  auto src = bench::generate_script(8 << 20);
+  TokenStream tokens{src};
+  std::optional<Program> program{};
+  Clock::duration building{}, freeing{};
+  int runs{0};
+  for (; runs < 5 || building + freeing < std::chrono::seconds{2}; ++runs) {
+    auto start = Clock::now();
+    program.emplace(Parser{tokens}.parse_program());
+    auto built = Clock::now();
+    program.reset();
+    freeing  += Clock::now() - built;
+    building += built - start;
+  }
+  auto per_run = [runs](Clock::duration total) {
+    return std::chrono::duration<double, std::nano>(total).count() / runs;
+  };
+  report("parse into AST", per_run(building), src.size());
+  report("free AST", per_run(freeing));
+}
+
+BENCH("ast memory") {
+  auto src = bench::generate_script(8 << 20);
+  TokenStream tokens{src};
+  auto program = Parser{tokens}.parse_program();
+  FlatAst flat{program};
+  auto nodes = static_cast<double>(flat.nodes.size());
+
+  report("Program (arena) per node", program.arena->used() / nodes, "B");
+  report("FlatAst per node", flat.memory() / nodes, "B");
+  report("walk Program", measure([&] { keep(fmt::format("{}", program)); }));
+  report("walk FlatAst", measure([&] { keep(fmt::format("{}", flat)); }));
+}
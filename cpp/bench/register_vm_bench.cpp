@@ -0,0 +1,64 @@
+#include <monkey/compiler.h>
+#include <monkey/evaluator.h>
+#include <monkey/parser.h>
+#include <monkey/register_vm.h>
+#include <monkey/vm.h>
+
+#include <string>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+
+/// Instructions dispatched and wall time per run under the stack and the
+/// register VM.
+static void compare(const string& name, const string& src) {
+  Lexer l{src};
+  auto program = Parser{l}.parse_program();
+  Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  VM vm{};
+  reg::Compiler reg_compiler{};
+  auto reg_bytecode = reg_compiler.compile(program);
+  reg::VM reg_vm{};
+
+  keep(vm.run(bytecode));
+  keep(reg_vm.run(reg_bytecode));
+  report(name + ", stack instructions", vm.dispatched, "");
+  report(name + ", register instructions", reg_vm.dispatched, "");
+  report(name + ", eval", measure([&] { keep(eval(program)); }));
+  report(name + ", stack", measure([&] { keep(vm.run(bytecode)); }));
+  report(name + ", register",
+         measure([&] { keep(reg_vm.run(reg_bytecode)); }));
+}
+
+BENCH("register vm") {
+  // The evaluator's test programs, scaled up by repetition or a bigger
+  // argument.
+  compare("fib(20)", R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(20);
+)");
+  compare("closures", R"(
+let newAdder = fn(x) { fn(y) { x + y } };
+let sum = fn(n, acc) {
+  if (n == 0) { acc } else { sum(n - 1, newAdder(n)(acc)) }
+};
+sum(500, 0);
+)");
+  compare("arithmetic", R"(
+let f = fn(a, b) {
+  let c = (a * 3 + b * 4 - 6 / 2) * 2 + -a;
+  let d = c * c - a * b + 50 / 2 * 2 + 10;
+  if (d > c) { d - c } else { c - d }
+};
+let loop = fn(i, acc) {
+  if (i == 0) { acc } else { loop(i - 1, acc + f(i, acc)) }
+};
+loop(500, 0);
+)");
+}
@@ -0,0 +1,87 @@
+#include <monkey/lexer.h>
+#include <monkey/token.h>
+#include <monkey/token_stream.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+/// The keyword lookup lookup_ident replaced, kept for comparison.
+Token::Type hashed_lookup_ident(const string& ident) {
+  static std::unordered_map<string, Token::Type> keywords{
+      {"fn", Token::Type::FUNCTION},
+      {"let", Token::Type::LET},
+      {"true", Token::Type::TRUE},
+      {"false", Token::Type::FALSE},
+      {"if", Token::Type::IF},
+      {"else", Token::Type::ELSE},
+      {"return", Token::Type::RETURN},
+  };
+  auto s = keywords.find(ident);
+  if (s == keywords.end()) return Token::Type::IDENT;
+  return s->second;
+}
+
+} // namespace
+
+BENCH("keywords") {
+  auto src = bench::generate_script(1 << 20);
+  vector<string_view> views{};
+  vector<string> strings{};
+  Lexer lex{string_view{src}};
+  for (auto t = lex.next_view(); t.type != Token::Type::EOF_;
+       t      = lex.next_view()) {
+    // Identifiers and keywords; lookup_ident maps anything else to IDENT.
+    if (Token::lookup_ident(t.literal) == t.type) {
+      views.push_back(t.literal);
+      strings.emplace_back(t.literal);
+    }
+  }
+  auto n = static_cast<double>(views.size());
+
+  report("unordered_map per identifier", measure([&] {
+           for (auto& s : strings) keep(hashed_lookup_ident(s));
+         }) / n);
+  report("length/first-char switch per identifier", measure([&] {
+           for (auto& s : views) keep(Token::lookup_ident(s));
+         }) / n);
+}
+
+BENCH("token stream") {
+  auto src = bench::generate_script(8 << 20);
+
+  report("TokenStream", measure([&] { keep(TokenStream{src}.size()); }),
+         src.size());
+
+  TokenStream tokens{src};
+  vector<Token> owned{};
+  size_t heap{0};
+  Lexer lex{string_view{src}};
+  for (auto t = lex.next_token();; t = lex.next_token()) {
+    // Literals beyond the small-string buffer live on the heap.
+    if (t.literal.capacity() > string{}.capacity()) {
+      heap += t.literal.capacity() + 1;
+    }
+    owned.push_back(std::move(t));
+    if (owned.back().type == Token::Type::EOF_) break;
+  }
+  auto n = static_cast<double>(tokens.size());
+  report("tokens", n, "");
+  report("TokenStream bytes per token", tokens.memory() / n, "B");
+  report("vector<Token> bytes per token",
+         (owned.capacity() * sizeof(Token) + heap) / n,
+         "B");
+}
@@ -0,0 +1,47 @@
+#include <monkey/compiler.h>
+#include <monkey/evaluator.h>
+#include <monkey/parser.h>
+#include <monkey/vm.h>
+
+#include <string>
+
+#include "bench.h"
+
+using namespace monkey;
+using bench::keep;
+using bench::measure;
+using bench::report;
+using std::string;
+
+/// Times one script under the tree walker and under the VM. Compilation is
+/// done once up front, as a script run repeatedly would.
+static void compare(const string& name, const string& src) {
+  Lexer l{src};
+  auto program = Parser{l}.parse_program();
+  Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  VM vm{};
+
+  report(name + ", eval", measure([&] { keep(eval(program)); }));
+  report(name + ", vm", measure([&] { keep(vm.run(bytecode)); }));
+}
+
+BENCH("vm") {
+  compare("fib(20)", R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(20);
+)");
+  // A counting loop written as recursion that builds and calls a closure on
+  // every iteration.
+  compare("closure loop", R"(
+let adder = fn(x) { fn(y) { x + y } };
+let loop = fn(i, acc) {
+  if (i == 0) { acc } else { loop(i - 1, adder(i)(acc)) }
+};
+loop(500, 0);
+)");
+  compare("arithmetic", R"(
+let f = fn(a, b) { (a * 3 + b * 4 - 6 / 2) * 2 + a < 100 == !false };
+f(1, 2); f(3, 4); f(5, 6); f(7, 8); f(9, 10); f(11, 12); f(13, 14);
+)");
+}
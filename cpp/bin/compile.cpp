@@ -0,0 +1,81 @@
+#include "compile.h"
+
+#include <fmt/ostream.h>
+#include <monkey/parser.h>
+#include <monkey/repl.h>
+#include <monkey/source.h>
+#include <monkey/transpiler.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+using std::cerr;
+using std::cout;
+using std::string;
+using std::vector;
+
+const auto COMPILE_USAGE =
+    "usage: monkey compile [--emit-c] [-o <output>] <file>\n";
+
+int compile(const vector<string>& args) {
+  using namespace monkey;
+
+  string path{};
+  string output{};
+  bool emit{false};
+  for (size_t i{0}; i < args.size(); ++i) {
+    if (args[i] == "--emit-c") {
+      emit = true;
+    } else if (args[i] == "-o" && i + 1 < args.size() && output.empty()) {
+      output = args[++i];
+    } else if (path.empty() && !args[i].starts_with("-")) {
+      path = args[i];
+    } else {
+      cerr << COMPILE_USAGE;
+      return 2;
+    }
+  }
+  if (path.empty()) {
+    cerr << COMPILE_USAGE;
+    return 2;
+  }
+
+  try {
+    MappedFile file{path};
+    Lexer lex{file.view()};
+    Parser parser{lex};
+    Program program = parser.parse_program();
+    if (!parser.errors.empty()) {
+      repl::print_parser_errors(cerr, parser.errors);
+      return 1;
+    }
+    auto source = transpile(program);
+
+    if (emit) {
+      if (output.empty()) {
+        cout << source;
+        return 0;
+      }
+      std::ofstream out{output};
+      out << source;
+      if (!out) {
+        fmt::print(cerr, "monkey: can't write {}\n", output);
+        return 1;
+      }
+      return 0;
+    }
+    if (output.empty()) {
+      output = std::filesystem::path{path}.replace_extension().string();
+    }
+    if (build(source, output) != 0) {
+      fmt::print(cerr, "monkey: compiling {} failed\n", path);
+      return 1;
+    }
+  } catch (const std::system_error& e) {
+    fmt::print(cerr, "monkey: {}\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// Transpiles a script to C++ and compiles it to a native executable.
+/// `args` are the arguments after `compile`:
+///
+///   [--emit-c] [-o <output>] <file>
+///
+/// --emit-c writes the C++ to <output>, or to stdout, instead of compiling
+/// it. Otherwise the executable goes to <output>, by default <file> without
+/// its extension.
+/// Returns the process exit code.
+int compile(const std::vector<std::string>& args);
@@ -2,7 +2,10 @@
 #include <monkey/monkey.h>
 
 #include <iostream>
+#include <string>
 
+#include "compile.h"
+#include "run.h"
 #include "user.h"
 
 using fmt::print;
@@ -10,7 +13,27 @@ using std::string;
 
 const auto VERSION = "0.01";
 
-int main() {
+const auto USAGE = R"(usage: monkey [--engine=eval|vm|register|closures]
+       monkey run [--parallel] [--engine=eval|vm|register|closures] [--jit]
+                  <file>
+       monkey compile [--emit-c] [-o <output>] <file>
+)";
+
+int main(int argc, char* argv[]) {
+  if (argc >= 2 && string{argv[1]} == "run") {
+    return run({argv + 2, argv + argc});
+  }
+  if (argc >= 2 && string{argv[1]} == "compile") {
+    return compile({argv + 2, argv + argc});
+  }
+  auto engine = monkey::repl::Engine::EVAL;
+  if (argc == 2 && parse_engine(argv[1])) {
+    engine = *parse_engine(argv[1]);
+  } else if (argc != 1) {
+    std::cerr << USAGE;
+    return 2;
+  }
+
   User user{};
 
   print(R"(Hello {}! This is the Monkey programming language!
@@ -19,7 +42,7 @@ monkey/{} darwin-x64 cpp
         user.name(),
         VERSION);
 
-  monkey::repl::start(std::cin, std::cout);
+  monkey::repl::start(std::cin, std::cout, engine);
 
   return 0;
 }
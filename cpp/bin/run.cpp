@@ -0,0 +1,109 @@
+#include "run.h"
+
+#include <fmt/ostream.h>
+#include <monkey/closure_tree.h>
+#include <monkey/compiler.h>
+#include <monkey/evaluator.h>
+#include <monkey/jit.h>
+#include <monkey/parser.h>
+#include <monkey/register_vm.h>
+#include <monkey/repl.h>
+#include <monkey/source.h>
+#include <monkey/vm.h>
+
+#include <iostream>
+#include <system_error>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::optional;
+using std::string;
+using std::vector;
+
+const auto RUN_USAGE = "usage: monkey run [--parallel] "
+                       "[--engine=eval|vm|register|closures] [--jit] <file>\n";
+
+optional<monkey::repl::Engine> parse_engine(const string& arg) {
+  using monkey::repl::Engine;
+  if (arg == "--engine=eval") return Engine::EVAL;
+  if (arg == "--engine=vm") return Engine::VM;
+  if (arg == "--engine=register") return Engine::REGISTER_VM;
+  if (arg == "--engine=closures") return Engine::CLOSURES;
+  return std::nullopt;
+}
+
+int run(const vector<string>& args) {
+  using namespace monkey;
+
+  string path{};
+  bool parallel{false};
+  bool native{false};
+  auto engine = repl::Engine::EVAL;
+  for (auto& arg : args) {
+    if (arg == "--parallel") {
+      parallel = true;
+    } else if (arg == "--jit") {
+      native = true;
+    } else if (auto e = parse_engine(arg)) {
+      engine = *e;
+    } else if (path.empty() && !arg.starts_with("--")) {
+      path = arg;
+    } else {
+      cerr << RUN_USAGE;
+      return 2;
+    }
+  }
+  // The JIT compiles functions the tree-walker calls.
+  if (path.empty() || (native && engine != repl::Engine::EVAL)) {
+    cerr << RUN_USAGE;
+    return 2;
+  }
+
+  try {
+    MappedFile file{path};
+    vector<string> errors{};
+    auto parse = [&] {
+      if (parallel) return parse_program_parallel(file.view(), errors);
+      Lexer lex{file.view()};
+      Parser parser{lex};
+      Program program = parser.parse_program();
+      errors          = std::move(parser.errors);
+      return program;
+    };
+    Program program = parse();
+    if (!errors.empty()) {
+      repl::print_parser_errors(cerr, errors);
+      return 1;
+    }
+    auto compile = [&](auto compiler, auto vm) {
+      auto bytecode = compiler.compile(program);
+      if (!compiler.errors.empty()) {
+        return Value::error(compiler.errors.front());
+      }
+      return vm.run(bytecode);
+    };
+    auto execute = [&] {
+      switch (engine) {
+      case repl::Engine::EVAL: break;
+      case repl::Engine::VM: return compile(Compiler{}, VM{});
+      case repl::Engine::REGISTER_VM:
+        return compile(reg::Compiler{}, reg::VM{});
+      case repl::Engine::CLOSURES: return closure::Tree{program}.run();
+      }
+      if (!native) return eval(program);
+      jit::Jit jit{};
+      return eval(program, std::make_shared<object::Environment>(), &jit);
+    };
+    auto result = execute();
+    if (result.is_error()) {
+      cerr << result << endl;
+      return 1;
+    }
+    if (result.type() != Value::Type::NULL_) cout << result << endl;
+  } catch (const std::system_error& e) {
+    fmt::print(cerr, "monkey: {}\n", e.what());
+    return 1;
+  }
+  return 0;
+}
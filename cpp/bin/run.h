@@ -0,0 +1,23 @@
+#pragma once
+
+#include <monkey/repl.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Lexes, parses and evaluates a script straight from a read-only mapping of
+/// the file. `args` are the arguments after `run`:
+///
+///   [--parallel] [--engine=eval|vm|register|closures] [--jit] <file>
+///
+/// --parallel parses top-level statements on a thread per core.
+/// --engine=vm compiles to bytecode and runs it on the VM instead of walking
+/// the tree; --engine=register uses the register VM, and --engine=closures
+/// lowers the tree to closures first.
+/// Returns the process exit code.
+int run(const std::vector<std::string>& args);
+
+/// The engine an `--engine=...` argument names, or nothing if `arg` is not
+/// one.
+std::optional<monkey::repl::Engine> parse_engine(const std::string& arg);
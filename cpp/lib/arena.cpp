@@ -0,0 +1,46 @@
+#include "monkey/arena.h"
+
+#include <cstring>
+
+using std::string_view;
+using std::unique_ptr;
+
+namespace monkey {
+
+/// Sized so a typical REPL line never needs a second block.
+constexpr size_t FIRST_BLOCK = 4096;
+
+Arena::Arena()
+    : pool{FIRST_BLOCK} { }
+
+string_view Arena::copy(string_view text) {
+  if (text.empty()) return {};
+  auto* at = static_cast<char*>(allocate(text.size(), 1));
+  std::memcpy(at, text.data(), text.size());
+  return {at, text.size()};
+}
+
+void Arena::adopt(unique_ptr<Arena> other) {
+  adopted.push_back(std::move(other));
+}
+
+size_t Arena::used() const {
+  size_t total = bytes;
+  for (auto& a : adopted) total += a->used();
+  return total;
+}
+
+void* Arena::do_allocate(size_t n, size_t alignment) {
+  bytes += n;
+  return pool.allocate(n, alignment);
+}
+
+void Arena::do_deallocate(void*, size_t, size_t) {
+  // Freed all at once with the arena.
+}
+
+bool Arena::do_is_equal(const memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+} // namespace monkey
@@ -9,14 +9,14 @@ namespace monkey {
 using namespace fmt::literals;
 using std::move;
 using std::ostream;
-using std::string;
-using ExpressionPtr = std::unique_ptr<Expression>;
+using std::string_view;
 
 //<editor-fold desc="Node">
-Node::Node(Token&& token)
-    : token{move(token)} { }
+Node::Node(Kind kind, TokenView token)
+    : kind{kind}
+    , token{token} { }
 
-const string& Node::token_literal() const {
+string_view Node::token_literal() const {
   return token.literal;
 }
 
@@ -29,18 +29,26 @@ std::ostream& Node::print(ostream& out) const {
 //</editor-fold>
 
 Program::Program()
-    : Node{Token{Token::Type::EOF_, ""}} { }
+    : Node{Kind::PROGRAM, TokenView{Token::Type::EOF_, ""}}
+    , arena{std::make_unique<Arena>()} { }
 
 std::ostream& Program::print(ostream& out) const {
   for (const auto& s : statements) out << *s;
   return out;
 }
 
-Statement::Statement(Token&& token)
-    : Node(move(token)) { }
+void Program::append(Program&& other) {
+  statements.insert(
+      statements.end(), other.statements.begin(), other.statements.end());
+  other.statements.clear();
+  arena->adopt(move(other.arena));
+}
+
+Statement::Statement(Kind kind, TokenView token)
+    : Node(kind, token) { }
 
-BlockStatement::BlockStatement(Token&& token)
-    : Statement(move(token)) { }
+BlockStatement::BlockStatement(TokenView token)
+    : Statement(Kind::BLOCK, token) { }
 
 std::ostream& BlockStatement::print(ostream& out) const {
   out << "{";
@@ -48,19 +56,19 @@ std::ostream& BlockStatement::print(ostream& out) const {
   return out << " }";
 }
 
-Expression::Expression(Token&& token)
-    : Node(move(token)) { }
+Expression::Expression(Kind kind, TokenView token)
+    : Node(kind, token) { }
 
-Identifier::Identifier(Token token)
-    : Expression{move(token)}
-    , value{this->token.literal} { }
+Identifier::Identifier(TokenView token)
+    : Expression{Kind::IDENTIFIER, token}
+    , value{Symbol::intern(this->token.literal)} { }
 
 std::ostream& Identifier::print(ostream& out) const {
   return out << value;
 }
 
-LetStatement::LetStatement(Token token)
-    : Statement{move(token)} { }
+LetStatement::LetStatement(TokenView token)
+    : Statement{Kind::LET, token} { }
 
 std::ostream& LetStatement::print(ostream& out) const {
   out << token_literal() << " " << *name << " = ";
@@ -68,45 +76,45 @@ std::ostream& LetStatement::print(ostream& out) const {
   return out << ";";
 }
 
-ExpressionStatement::ExpressionStatement(Token token)
-    : Statement{move(token)} { }
+ExpressionStatement::ExpressionStatement(TokenView token)
+    : Statement{Kind::EXPRESSION, token} { }
 
 std::ostream& ExpressionStatement::print(ostream& out) const {
   if (expression) out << *expression;
   return out;
 }
 
-ReturnStatement::ReturnStatement(Token token)
-    : Statement{move(token)} { }
+ReturnStatement::ReturnStatement(TokenView token)
+    : Statement{Kind::RETURN, token} { }
 
 std::ostream& ReturnStatement::print(ostream& out) const {
-  return out << token_literal() << " ";
+  out << token_literal() << " ";
   if (return_value) out << *return_value;
   return out << ";";
 }
 
-IntegerLiteral::IntegerLiteral(Token token)
-    : Expression{move(token)} { }
+IntegerLiteral::IntegerLiteral(TokenView token)
+    : Expression{Kind::INTEGER, token} { }
 
-PrefixExpression::PrefixExpression(Token token)
-    : Expression{move(token)}
+PrefixExpression::PrefixExpression(TokenView token)
+    : Expression{Kind::PREFIX, token}
     , op{this->token.literal} { }
 
 std::ostream& PrefixExpression::print(ostream& out) const {
   return out << "(" << op << *right << ")";
 }
 
-InfixExpression::InfixExpression(Token token, ExpressionPtr&& left)
-    : Expression{move(token)}
+InfixExpression::InfixExpression(TokenView token, Expression* left)
+    : Expression{Kind::INFIX, token}
     , op{this->token.literal}
-    , left{move(left)} { }
+    , left{left} { }
 
 std::ostream& InfixExpression::print(ostream& out) const {
   return out << "(" << *left << " " << op << " " << *right << ")";
 }
 
-Boolean::Boolean(Token&& token)
-    : Expression{move(token)} { }
+Boolean::Boolean(TokenView token)
+    : Expression{Kind::BOOLEAN, token} { }
 
 std::ostream& IfExpression::print(ostream& out) const {
   out << "if " << *condition << " " << *consequence;
@@ -114,11 +122,11 @@ std::ostream& IfExpression::print(ostream& out) const {
   return out;
 }
 
-IfExpression::IfExpression(Token&& token)
-    : Expression{move(token)} { }
+IfExpression::IfExpression(TokenView token)
+    : Expression{Kind::IF, token} { }
 
-FunctionLiteral::FunctionLiteral(Token&& token)
-    : Expression{move(token)} { }
+FunctionLiteral::FunctionLiteral(TokenView token)
+    : Expression{Kind::FUNCTION, token} { }
 
 std::ostream& FunctionLiteral::print(ostream& out) const {
   out << token_literal() << "(";
@@ -131,9 +139,9 @@ std::ostream& FunctionLiteral::print(ostream& out) const {
   return out << ") " << *body;
 }
 
-CallExpression::CallExpression(Token&& token, ExpressionPtr func)
-    : Expression(move(token))
-    , function{move(func)} { }
+CallExpression::CallExpression(TokenView token, Expression* func)
+    : Expression(Kind::CALL, token)
+    , function{func} { }
 
 std::ostream& CallExpression::print(ostream& out) const {
   out << *function << "(";
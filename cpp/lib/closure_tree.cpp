@@ -0,0 +1,455 @@
+#include "monkey/closure_tree.h"
+
+#include <fmt/format.h>
+#include <monkey/runtime.h>
+
+namespace monkey::closure {
+
+using namespace fmt::literals;
+using object::Environment;
+using std::span;
+using Scope = Identifier::Scope;
+using Type  = Value::Type;
+
+/// What the calls of one run share.
+struct Machine {
+  /// Callees and arguments of calls being made, so a call allocates nothing
+  /// for them once the stack has grown.
+  std::vector<Value> stack{};
+  /// Where the native stack was when the run started.
+  uintptr_t base;
+  /// What a tail call gives in place of its value. It is an error, so every
+  /// node on the way out hands it up and evaluates nothing more, as eval
+  /// drops what is left of the call. The machine keeps a reference, so the
+  /// values never free it.
+  object::Error tail_call{"tail call"};
+  /// Where the run's functions find the globals.
+  Env globals;
+
+  explicit Machine(Env globals)
+      : globals{std::move(globals)} {
+    char here;
+    base           = reinterpret_cast<uintptr_t>(&here);
+    tail_call.refs = 1;
+  }
+
+  /// Native stack the run has used down to the caller, which grows down.
+  size_t used() const {
+    char here;
+    return base - reinterpret_cast<uintptr_t>(&here);
+  }
+};
+
+/// One call in progress, or the top level.
+struct Frame {
+  Machine& machine;
+  Environment& env;
+  /// Set by a tail call, which leaves its callee and arguments on top of the
+  /// stack for this frame's call to make in its place.
+  bool tail{false};
+};
+
+/// A function a Tree made, which knows the code of its body.
+struct Lambda : object::Function {
+  const Code& body;
+
+  Lambda(const FunctionLiteral& literal,
+         std::vector<object::Cell> captures,
+         Env globals,
+         const Code& body)
+      : Function{literal, std::move(captures), std::move(globals)}
+      , body{body} { }
+};
+
+//<editor-fold desc="variables">
+template <Scope scope>
+Value& variable(Environment& env, uint32_t index) {
+  if constexpr (scope == Scope::LOCAL) return env.slots[index];
+  if constexpr (scope == Scope::CELL) return *env.cells[index];
+  return *env.function->captures[index];
+}
+
+Value constant(const Code& code, Frame&) {
+  return code.value;
+}
+
+template <Scope scope>
+Value load(const Code& code, Frame& frame) {
+  return variable<scope>(frame.env, code.index);
+}
+
+Value load_global(const Code& code, Frame& frame) {
+  auto& name = static_cast<const Identifier&>(*code.node);
+  if (auto* value = frame.env.global(name.value)) return *value;
+  return Value::error("identifier not found: {}"_format(name.value.name()));
+}
+
+template <Scope scope>
+Value let(const Code& code, Frame& frame) {
+  auto value = (*code.a)(frame);
+  if (value.is_error()) return value;
+  variable<scope>(frame.env, code.index) = std::move(value);
+  return Value{};
+}
+
+Value let_global(const Code& code, Frame& frame) {
+  auto value = (*code.a)(frame);
+  if (value.is_error()) return value;
+  auto& name = static_cast<const Identifier&>(*code.node);
+  frame.env.set_global(name.value, std::move(value));
+  return Value{};
+}
+//</editor-fold>
+
+//<editor-fold desc="statements">
+/// Runs statements in order, stopping early at a return or an error; the
+/// last value is the block's.
+Value block(const Code& code, Frame& frame) {
+  Value value{};
+  for (auto* statement : code.list) {
+    value = (*statement)(frame);
+    if (value.returning || value.is_error()) break;
+  }
+  return value;
+}
+
+Value program(const Code& code, Frame& frame) {
+  auto value      = block(code, frame);
+  value.returning = false;
+  return value;
+}
+
+Value ret(const Code& code, Frame& frame) {
+  auto value = (*code.a)(frame);
+  if (!value.is_error()) value.returning = true;
+  return value;
+}
+
+Value conditional(const Code& code, Frame& frame) {
+  auto condition = (*code.a)(frame);
+  if (condition.is_error()) return condition;
+  if (condition.truthy()) return (*code.b)(frame);
+  if (code.c) return (*code.c)(frame);
+  return Value{};
+}
+//</editor-fold>
+
+//<editor-fold desc="operators">
+template <Token::Type op>
+Value prefix(const Code& code, Frame& frame) {
+  return runtime::prefix<op>((*code.a)(frame));
+}
+
+template <Token::Type op>
+Value infix(const Code& code, Frame& frame) {
+  auto left = (*code.a)(frame);
+  // A tail call in the left operand ends the function before the right one
+  // is evaluated, and one in the right ends it whatever the left was.
+  if (left.is_error() && frame.tail) return left;
+  auto right = (*code.b)(frame);
+  if (right.is_error() && frame.tail) return right;
+  return runtime::infix<op>(left, right);
+}
+
+/// Operators the parser never makes; `index` is the token type.
+Value generic_prefix(const Code& code, Frame& frame) {
+  return eval_prefix(static_cast<Token::Type>(code.index), (*code.a)(frame));
+}
+
+Value generic_infix(const Code& code, Frame& frame) {
+  auto left = (*code.a)(frame);
+  if (left.is_error() && frame.tail) return left;
+  auto right = (*code.b)(frame);
+  if (right.is_error() && frame.tail) return right;
+  return eval_infix(static_cast<Token::Type>(code.index), left, right);
+}
+//</editor-fold>
+
+//<editor-fold desc="functions">
+/// Closes the literal over the cells it captures from the running call.
+Value function(const Code& code, Frame& frame) {
+  auto& literal = static_cast<const FunctionLiteral&>(*code.node);
+  std::vector<object::Cell> captures{};
+  captures.reserve(literal.captures.size());
+  for (auto& capture : literal.captures) {
+    captures.push_back(capture.scope == Scope::CELL
+                           ? frame.env.cells[capture.index]
+                           : frame.env.function->captures[capture.index]);
+  }
+  return {Type::FUNCTION,
+          new Lambda{literal,
+                     std::move(captures),
+                     frame.machine.globals,
+                     *code.a}};
+}
+
+void bind(Environment& env, const Identifier& parameter, Value value) {
+  if (parameter.scope == Scope::CELL) {
+    *env.cells[parameter.index] = std::move(value);
+  } else {
+    env.slots[parameter.index] = std::move(value);
+  }
+}
+
+/// Calls the callee at `base` on the stack with the `count` arguments above
+/// it, then any call the body makes in tail position in its place. Takes
+/// them all off the stack.
+Value apply(Machine& machine, size_t base, size_t count) {
+  auto& stack = machine.stack;
+  Value callee{};
+  for (;;) {
+    callee = std::move(stack[base]);
+    if (callee.type() != Type::FUNCTION) {
+      stack.resize(base);
+      return Value::error(
+          "not a function: {}"_format(type_name(callee.type())));
+    }
+    auto& fn     = static_cast<const Lambda&>(callee.as<object::Function>());
+    auto& params = fn.literal.parameters;
+    if (params.size() != count) {
+      stack.resize(base);
+      return Value::error(
+          "wrong number of arguments: want={}, got={}"_format(params.size(),
+                                                              count));
+    }
+    if (machine.used() > Tree::MAX_STACK) {
+      stack.resize(base);
+      return Value::error("stack overflow");
+    }
+
+    Environment env{fn};
+    for (size_t i{0}; i < count; ++i) {
+      bind(env, params[i], std::move(stack[base + 1 + i]));
+    }
+    stack.resize(base);
+    Frame frame{machine, env};
+    auto result = fn.body(frame);
+    if (!frame.tail) {
+      result.returning = false;
+      return result;
+    }
+    count = stack.size() - base - 1;
+  }
+}
+
+/// Evaluates a call's callee and then its arguments onto the stack, and
+/// returns the first error instead if there is one.
+Value operands(const Code& code, Frame& frame) {
+  auto& stack = frame.machine.stack;
+  auto base   = static_cast<ptrdiff_t>(stack.size());
+  auto callee = (*code.a)(frame);
+  if (callee.is_error()) return callee;
+  stack.push_back(std::move(callee));
+  for (ptrdiff_t i{0}; auto* argument : code.list) {
+    auto value = (*argument)(frame);
+    if (value.is_error()) {
+      // Anything a tail call in the argument left stays on top.
+      stack.erase(stack.begin() + base, stack.begin() + base + 1 + i);
+      return value;
+    }
+    stack.push_back(std::move(value));
+    ++i;
+  }
+  return Value{};
+}
+
+Value call(const Code& code, Frame& frame) {
+  auto base = frame.machine.stack.size();
+  if (auto error = operands(code, frame); error.is_error()) return error;
+  return apply(frame.machine, base, code.list.size());
+}
+
+Value tail_call(const Code& code, Frame& frame) {
+  if (auto error = operands(code, frame); error.is_error()) return error;
+  frame.tail = true;
+  return {Type::ERROR, &frame.machine.tail_call};
+}
+//</editor-fold>
+
+//<editor-fold desc="lowering">
+Tree::Tree(const Program& program) {
+  root = &lower_block(program.statements, closure::program);
+  if (too_deep) {
+    auto& error = add(constant);
+    error.value = Value::error("nesting too deep");
+    root        = &error;
+  }
+}
+
+Code& Tree::add(Code::Run run) {
+  return codes.emplace_back(Code{run});
+}
+
+const Code& Tree::lower_block(span<Statement* const> statements,
+                              Code::Run run) {
+  auto& list = lists.emplace_back();
+  list.reserve(statements.size());
+  for (auto* statement : statements) list.push_back(&lower(*statement));
+  auto& code = add(run);
+  code.list  = list;
+  return code;
+}
+
+/// The function that runs a variable of `scope`, given what runs it as a
+/// local, a cell and a capture.
+Code::Run by_scope(Scope scope, Code::Run global, Code::Run local,
+                   Code::Run cell, Code::Run capture) {
+  switch (scope) {
+  case Scope::GLOBAL: return global;
+  case Scope::LOCAL: return local;
+  case Scope::CELL: return cell;
+  case Scope::CAPTURE: return capture;
+  }
+  return global;
+}
+
+Code::Run prefix_run(Token::Type op) {
+  switch (op) {
+  case Token::Type::MINUS: return prefix<Token::Type::MINUS>;
+  case Token::Type::BANG: return prefix<Token::Type::BANG>;
+  default: return generic_prefix;
+  }
+}
+
+Code::Run infix_run(Token::Type op) {
+  using enum Token::Type;
+  switch (op) {
+  case PLUS: return infix<PLUS>;
+  case MINUS: return infix<MINUS>;
+  case ASTERISK: return infix<ASTERISK>;
+  case SLASH: return infix<SLASH>;
+  case LT: return infix<LT>;
+  case GT: return infix<GT>;
+  case EQ: return infix<EQ>;
+  case NOT_EQ: return infix<NOT_EQ>;
+  default: return generic_infix;
+  }
+}
+
+const Code& Tree::lower(const Node& node) {
+  using Kind = Node::Kind;
+  if (depth == MAX_NESTING) {
+    too_deep = true;
+    return add(constant);
+  }
+  ++depth;
+  struct Leave {
+    uint32_t& depth;
+    ~Leave() { --depth; }
+  } leave{depth};
+  switch (node.kind) {
+  case Kind::PROGRAM:
+    return lower_block(static_cast<const Program&>(node).statements,
+                       closure::program);
+  case Kind::LET: {
+    auto& let   = static_cast<const LetStatement&>(node);
+    auto& value = lower(*let.value);
+    auto& code  = add(by_scope(let.name->scope,
+                              let_global,
+                              closure::let<Scope::LOCAL>,
+                              closure::let<Scope::CELL>,
+                              closure::let<Scope::CAPTURE>));
+    code.a      = &value;
+    code.node   = let.name;
+    code.index  = let.name->index;
+    return code;
+  }
+  case Kind::RETURN: {
+    auto& ret   = static_cast<const ReturnStatement&>(node);
+    auto& value = lower(*ret.return_value);
+    auto& code  = add(closure::ret);
+    code.a      = &value;
+    return code;
+  }
+  case Kind::EXPRESSION:
+    return lower(*static_cast<const ExpressionStatement&>(node).expression);
+  case Kind::BLOCK:
+    return lower_block(static_cast<const BlockStatement&>(node).statements,
+                       closure::block);
+  case Kind::IDENTIFIER: {
+    auto& ident = static_cast<const Identifier&>(node);
+    auto& code  = add(by_scope(ident.scope,
+                              load_global,
+                              load<Scope::LOCAL>,
+                              load<Scope::CELL>,
+                              load<Scope::CAPTURE>));
+    code.node   = &ident;
+    code.index  = ident.index;
+    return code;
+  }
+  case Kind::INTEGER: {
+    auto& code = add(constant);
+    code.value = Value::integer(static_cast<const IntegerLiteral&>(node).value);
+    return code;
+  }
+  case Kind::BOOLEAN: {
+    auto& code = add(constant);
+    code.value = Value::boolean(static_cast<const Boolean&>(node).value);
+    return code;
+  }
+  case Kind::PREFIX: {
+    auto& right = lower(*static_cast<const PrefixExpression&>(node).right);
+    auto& code  = add(prefix_run(node.token.type));
+    code.a      = &right;
+    code.index  = static_cast<uint32_t>(node.token.type);
+    return code;
+  }
+  case Kind::INFIX: {
+    auto& infix = static_cast<const InfixExpression&>(node);
+    auto& left  = lower(*infix.left);
+    auto& right = lower(*infix.right);
+    auto& code  = add(infix_run(node.token.type));
+    code.a      = &left;
+    code.b      = &right;
+    code.index  = static_cast<uint32_t>(node.token.type);
+    return code;
+  }
+  case Kind::IF: {
+    auto& ife         = static_cast<const IfExpression&>(node);
+    auto& condition   = lower(*ife.condition);
+    auto& consequence = lower(*ife.consequence);
+    auto* alternative = ife.alternative ? &lower(*ife.alternative) : nullptr;
+    auto& code        = add(conditional);
+    code.a            = &condition;
+    code.b            = &consequence;
+    code.c            = alternative;
+    return code;
+  }
+  case Kind::FUNCTION: {
+    auto& literal = static_cast<const FunctionLiteral&>(node);
+    auto& body    = lower(*literal.body);
+    auto& code    = add(function);
+    code.a        = &body;
+    code.node     = &literal;
+    return code;
+  }
+  case Kind::CALL: {
+    auto& call     = static_cast<const CallExpression&>(node);
+    auto& function = lower(*call.function);
+    auto& list     = lists.emplace_back();
+    list.reserve(call.arguments.size());
+    for (auto* argument : call.arguments) list.push_back(&lower(*argument));
+    auto& code = add(call.tail ? tail_call : closure::call);
+    code.a     = &function;
+    code.list  = list;
+    return code;
+  }
+  }
+  return add(constant);
+}
+//</editor-fold>
+
+Value Tree::run(const Env& env) const {
+  Machine machine{env};
+  Frame frame{machine, *env};
+  return (*root)(frame);
+}
+
+Value Tree::run() const {
+  auto env    = std::make_shared<Environment>();
+  auto result = run(env);
+  env->clear_globals();
+  return result;
+}
+
+} // namespace monkey::closure
@@ -0,0 +1,43 @@
+#include "monkey/code.h"
+
+#include <fmt/format.h>
+
+using std::string;
+
+namespace monkey::code {
+
+Instructions make(Opcode op, std::initializer_list<int> operands) {
+  auto def = lookup(op);
+  Instructions ins{static_cast<uint8_t>(op)};
+  size_t i{0};
+  for (int operand : operands) {
+    switch (def.widths[i++]) {
+    case 2:
+      ins.push_back(static_cast<uint8_t>(operand >> 8));
+      ins.push_back(static_cast<uint8_t>(operand));
+      break;
+    case 1: ins.push_back(static_cast<uint8_t>(operand)); break;
+    }
+  }
+  return ins;
+}
+
+string disassemble(const Instructions& ins) {
+  string out{};
+  for (size_t at{0}; at < ins.size();) {
+    auto op  = static_cast<Opcode>(ins[at]);
+    auto def = lookup(op);
+    out += fmt::format("{:04} {}", at, def.name);
+    size_t offset{at + 1};
+    for (size_t i{0}; i < def.operands; ++i) {
+      int operand = def.widths[i] == 2 ? read_u16(&ins[offset]) : ins[offset];
+      out += fmt::format(" {}", operand);
+      offset += def.widths[i];
+    }
+    out += "\n";
+    at += width(op);
+  }
+  return out;
+}
+
+} // namespace monkey::code
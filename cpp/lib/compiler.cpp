@@ -0,0 +1,295 @@
+#include "monkey/compiler.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <monkey/object.h>
+
+#include <limits>
+
+using namespace fmt::literals;
+using std::optional;
+using std::span;
+
+namespace monkey {
+
+using code::Opcode;
+using Scope = Binding::Scope;
+
+//<editor-fold desc="CompileScope">
+Binding CompileScope::define(Symbol name) {
+  if (!outer) {
+    auto found = store.find(name);
+    if (found != store.end() && found->second.scope == Scope::GLOBAL) {
+      return found->second;
+    }
+    names.push_back(name);
+  }
+  Binding b{outer ? Scope::LOCAL : Scope::GLOBAL,
+            static_cast<uint16_t>(definitions++)};
+  store.insert_or_assign(name, b);
+  return b;
+}
+
+Binding CompileScope::define_function_name(Symbol name) {
+  Binding b{Scope::FUNCTION, 0};
+  store.insert_or_assign(name, b);
+  return b;
+}
+
+optional<Binding> CompileScope::resolve(Symbol name) {
+  if (auto found = store.find(name); found != store.end()) {
+    return found->second;
+  }
+  if (!outer) return std::nullopt;
+  auto b = outer->resolve(name);
+  if (!b || b->scope == Scope::GLOBAL) return b;
+
+  free.push_back(*b);
+  Binding captured{Scope::FREE, static_cast<uint16_t>(free.size() - 1)};
+  store.insert_or_assign(name, captured);
+  return captured;
+}
+//</editor-fold>
+
+Compiler::Compiler() {
+  units.emplace_back();
+}
+
+Bytecode Compiler::compile(const Program& program) {
+  units.resize(1);
+  units[0] = Unit{};
+  // Functions may call globals bound after them.
+  for (auto* stmt : program.statements) {
+    if (stmt->kind == Node::Kind::LET) {
+      globals.define(static_cast<const LetStatement&>(*stmt).name->value);
+    }
+  }
+  for (auto* stmt : program.statements) compile(*stmt);
+  // The VM stops at the top level's return, with the program's value.
+  return_last();
+  return {units[0].instructions, constants, globals.names};
+}
+
+void Compiler::compile_block(span<Statement* const> statements) {
+  for (auto* stmt : statements) compile(*stmt);
+}
+
+void Compiler::compile(const Node& node) {
+  using Kind = Node::Kind;
+  if (depth == MAX_NESTING) {
+    errors.push_back("nesting too deep");
+    return;
+  }
+  ++depth;
+  switch (node.kind) {
+  case Kind::PROGRAM:
+    compile_block(static_cast<const Program&>(node).statements);
+    break;
+  case Kind::EXPRESSION:
+    compile(*static_cast<const ExpressionStatement&>(node).expression);
+    emit(Opcode::POP);
+    break;
+  case Kind::BLOCK:
+    compile_block(static_cast<const BlockStatement&>(node).statements);
+    break;
+  case Kind::LET: {
+    auto& let = static_cast<const LetStatement&>(node);
+    if (let.value->kind == Kind::FUNCTION) {
+      compile_function(static_cast<const FunctionLiteral&>(*let.value),
+                       let.name->value);
+    } else {
+      compile(*let.value);
+    }
+    // Bound after the value is compiled: a let cannot see its own name.
+    auto b = names().define(let.name->value);
+    if (b.scope == Scope::GLOBAL) {
+      if (names().definitions > CompileScope::MAX_GLOBALS) {
+        errors.push_back("too many globals");
+      }
+      emit(Opcode::SET_GLOBAL, {b.index});
+    } else {
+      if (b.index > std::numeric_limits<uint8_t>::max()) {
+        errors.push_back("too many local bindings");
+      }
+      emit(Opcode::SET_LOCAL, {b.index});
+    }
+    break;
+  }
+  case Kind::RETURN:
+    compile(*static_cast<const ReturnStatement&>(node).return_value);
+    emit(Opcode::RETURN_VALUE);
+    break;
+  case Kind::IDENTIFIER: {
+    auto& ident = static_cast<const Identifier&>(node);
+    if (auto b = names().resolve(ident.value)) {
+      load(*b);
+    } else {
+      errors.push_back("identifier not found: {}"_format(ident.value.name()));
+    }
+    break;
+  }
+  case Kind::INTEGER:
+    emit(Opcode::CONSTANT,
+         {static_cast<int>(add_constant(Value::integer(
+             static_cast<const IntegerLiteral&>(node).value)))});
+    break;
+  case Kind::BOOLEAN:
+    emit(static_cast<const Boolean&>(node).value ? Opcode::TRUE
+                                                 : Opcode::FALSE);
+    break;
+  case Kind::PREFIX: {
+    auto& prefix = static_cast<const PrefixExpression&>(node);
+    compile(*prefix.right);
+    emit(prefix.token.type == Token::Type::BANG ? Opcode::BANG
+                                                : Opcode::MINUS);
+    break;
+  }
+  case Kind::INFIX: {
+    auto& infix = static_cast<const InfixExpression&>(node);
+    compile(*infix.left);
+    compile(*infix.right);
+    switch (infix.token.type) {
+    case Token::Type::PLUS: emit(Opcode::ADD); break;
+    case Token::Type::MINUS: emit(Opcode::SUB); break;
+    case Token::Type::ASTERISK: emit(Opcode::MUL); break;
+    case Token::Type::SLASH: emit(Opcode::DIV); break;
+    case Token::Type::LT: emit(Opcode::LESS_THAN); break;
+    case Token::Type::GT: emit(Opcode::GREATER_THAN); break;
+    case Token::Type::EQ: emit(Opcode::EQUAL); break;
+    case Token::Type::NOT_EQ: emit(Opcode::NOT_EQUAL); break;
+    default: errors.push_back("unknown operator {}"_format(infix.op));
+    }
+    break;
+  }
+  case Kind::IF: {
+    auto& ife = static_cast<const IfExpression&>(node);
+    compile(*ife.condition);
+    auto jump_not_truthy = emit(Opcode::JUMP_NOT_TRUTHY, {0});
+
+    // Each branch leaves exactly one value: that of its last expression,
+    // or null.
+    auto branch = [this](const BlockStatement* block) {
+      if (block) compile(*block);
+      if (last_is(Opcode::POP)) {
+        remove_last();
+      } else {
+        emit(Opcode::NULL_);
+      }
+    };
+    branch(ife.consequence);
+    auto jump = emit(Opcode::JUMP, {0});
+    patch(jump_not_truthy, static_cast<int>(unit().instructions.size()));
+    branch(ife.alternative);
+    patch(jump, static_cast<int>(unit().instructions.size()));
+    break;
+  }
+  case Kind::FUNCTION:
+    compile_function(static_cast<const FunctionLiteral&>(node), Symbol{});
+    break;
+  case Kind::CALL: {
+    auto& call = static_cast<const CallExpression&>(node);
+    compile(*call.function);
+    for (auto* arg : call.arguments) compile(*arg);
+    emit(Opcode::CALL, {static_cast<int>(call.arguments.size())});
+    break;
+  }
+  }
+  --depth;
+}
+
+void Compiler::compile_function(const FunctionLiteral& fn, Symbol name) {
+  enter_scope();
+  if (name != Symbol{}) names().define_function_name(name);
+  for (auto& param : fn.parameters) names().define(param.value);
+
+  compile(*fn.body);
+  return_last();
+
+  auto body = leave_scope();
+  for (auto& b : body.names->free) load(b);
+  auto* compiled = new object::CompiledFunction{std::move(body.instructions),
+                                                body.names->definitions,
+                                                fn.parameters.size(),
+                                                "{}"_format(fn)};
+  auto index     = add_constant({Value::Type::COMPILED_FUNCTION, compiled});
+  emit(Opcode::CLOSURE,
+       {static_cast<int>(index), static_cast<int>(body.names->free.size())});
+}
+
+void Compiler::return_last() {
+  if (last_is(Opcode::POP)) {
+    unit().instructions[unit().last] =
+        static_cast<uint8_t>(Opcode::RETURN_VALUE);
+    unit().last_op = Opcode::RETURN_VALUE;
+  }
+  if (!last_is(Opcode::RETURN_VALUE)) emit(Opcode::RETURN);
+}
+
+void Compiler::load(Binding b) {
+  switch (b.scope) {
+  case Scope::GLOBAL: emit(Opcode::GET_GLOBAL, {b.index}); break;
+  case Scope::LOCAL: emit(Opcode::GET_LOCAL, {b.index}); break;
+  case Scope::FREE: emit(Opcode::GET_FREE, {b.index}); break;
+  case Scope::FUNCTION: emit(Opcode::CURRENT_CLOSURE); break;
+  }
+}
+
+size_t Compiler::emit(Opcode op, std::initializer_list<int> operands) {
+  auto& u  = unit();
+  auto ins = code::make(op, operands);
+  u.last   = u.instructions.size();
+  u.last_op = op;
+  u.instructions.insert(u.instructions.end(), ins.begin(), ins.end());
+  return u.last;
+}
+
+size_t Compiler::add_constant(Value value) {
+  if (constants.size() > std::numeric_limits<uint16_t>::max()) {
+    errors.push_back("too many constants");
+  }
+  constants.push_back(std::move(value));
+  return constants.size() - 1;
+}
+
+bool Compiler::last_is(Opcode op) const {
+  return units.back().last_op == op;
+}
+
+void Compiler::remove_last() {
+  auto& u = unit();
+  u.instructions.resize(u.last);
+  u.last_op.reset();
+}
+
+void Compiler::patch(size_t at, int operand) {
+  // Jump targets are 16-bit offsets into the unit.
+  if (operand > std::numeric_limits<uint16_t>::max()) {
+    errors.push_back("too much code");
+  }
+  auto op  = static_cast<Opcode>(unit().instructions[at]);
+  auto ins = code::make(op, {operand});
+  std::copy(ins.begin(), ins.end(), unit().instructions.begin() + at);
+}
+
+Compiler::Unit& Compiler::unit() {
+  return units.back();
+}
+
+CompileScope& Compiler::names() {
+  auto& scope = units.back().names;
+  return scope ? *scope : globals;
+}
+
+void Compiler::enter_scope() {
+  auto scope   = std::make_unique<CompileScope>();
+  scope->outer = &names();
+  units.push_back(Unit{{}, std::move(scope)});
+}
+
+Compiler::Unit Compiler::leave_scope() {
+  auto u = std::move(units.back());
+  units.pop_back();
+  return u;
+}
+
+} // namespace monkey
@@ -0,0 +1,34 @@
+#pragma once
+
+/// Instruction dispatch shared by the VMs' run loops, which are written as
+///
+///   for (;;) {
+///     FETCH();
+///     switch (OPCODE) {
+///     TARGET(ADD): ...; NEXT();
+///     }
+///   }
+///
+/// with FETCH and OPCODE defined by the loop. Built with
+/// MONKEY_COMPUTED_GOTO on a compiler with labels as values, NEXT fetches and
+/// jumps straight to the next handler through `targets`, a table of label
+/// addresses in Opcode order, so every handler ends in an indirect branch of
+/// its own that the predictor can learn. Otherwise NEXT goes back round the
+/// loop to the switch's single shared branch.
+
+#if defined(MONKEY_COMPUTED_GOTO) && defined(__GNUC__)
+#define MONKEY_THREADED 1
+#define TARGET(op)                                                             \
+  case Opcode::op:                                                             \
+  target_##op
+#define TARGET_ADDRESS(op) &&target_##op
+#define NEXT()                                                                 \
+  do {                                                                         \
+    FETCH();                                                                   \
+    goto* targets[static_cast<size_t>(OPCODE)];                                \
+  } while (0)
+#else
+#define MONKEY_THREADED 0
+#define TARGET(op) case Opcode::op
+#define NEXT()     continue
+#endif
@@ -1,126 +1,786 @@
 #include "monkey/evaluator.h"
 
-#include <fmt/ostream.h>
+#include <fmt/format.h>
+#include <monkey/jit.h>
 
-#include <exception>
-#include <iostream>
-#include <typeindex>
-#include <typeinfo>
-#include <unordered_map>
-#include <variant>
+#include <array>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <utility>
+#include <vector>
 
 namespace monkey {
 
-using std::function;
-using std::make_unique;
-using std::type_index;
-using std::unique_ptr;
-using std::unordered_map;
-using std::vector;
-using ObjPtr = unique_ptr<object::Object>;
+using namespace fmt::literals;
+using object::Environment;
+using std::span;
+using Scope = Identifier::Scope;
+using Type  = Value::Type;
 
-ObjPtr intobj(int val) {
-  return make_unique<object::Integer>(val);
+//<editor-fold desc="operators">
+namespace {
+
+/// Operators are the token types from PLUS to NOT_EQ, a dense run; tables
+/// have one more row, for a token that is no operator.
+constexpr auto FIRST_OPERATOR = static_cast<size_t>(Token::Type::PLUS);
+constexpr size_t OPERATORS =
+    static_cast<size_t>(Token::Type::NOT_EQ) - FIRST_OPERATOR + 1;
+constexpr size_t TYPES = static_cast<size_t>(Type::ERROR) + 1;
+
+constexpr size_t row(Token::Type op) {
+  auto index = static_cast<size_t>(op) - FIRST_OPERATOR;
+  return index < OPERATORS ? index : OPERATORS;
+}
+
+constexpr size_t column(Type type) {
+  return static_cast<size_t>(type);
+}
+
+using Prefix = Value (*)(Token::Type op, const Value& right);
+using Infix  = Value (*)(Token::Type op, const Value& left, const Value& right);
+
+Value pass_right(Token::Type, const Value& right) {
+  return right;
+}
+
+Value negate(Token::Type, const Value& right) {
+  return Value::integer(wrapping_negate(right.as_integer()));
+}
+
+Value logical_not(Token::Type, const Value& right) {
+  return Value::boolean(!right.truthy());
+}
+
+Value unknown_prefix(Token::Type op, const Value& right) {
+  return Value::error("unknown operator: {}{}"_format(
+      operator_str(op), type_name(right.type())));
+}
+
+/// By operator and operand type.
+constexpr auto PREFIX = [] {
+  std::array<std::array<Prefix, TYPES>, OPERATORS + 1> table{};
+  for (auto& types : table) types.fill(unknown_prefix);
+  table[row(Token::Type::BANG)].fill(logical_not);
+  table[row(Token::Type::MINUS)][column(Type::INTEGER)] = negate;
+  for (auto& types : table) types[column(Type::ERROR)] = pass_right;
+  return table;
+}();
+
+Value pass_left(Token::Type, const Value& left, const Value&) {
+  return left;
+}
+
+Value pass_right(Token::Type, const Value&, const Value& right) {
+  return right;
+}
+
+Value add(int64_t l, int64_t r) {
+  return Value::integer(wrapping_add(l, r));
+}
+
+Value subtract(int64_t l, int64_t r) {
+  return Value::integer(wrapping_subtract(l, r));
+}
+
+Value multiply(int64_t l, int64_t r) {
+  return Value::integer(wrapping_multiply(l, r));
+}
+
+Value divide(int64_t l, int64_t r) {
+  if (r == 0) return Value::error("division by zero");
+  return Value::integer(wrapping_divide(l, r));
+}
+
+Value less(int64_t l, int64_t r) {
+  return Value::boolean(l < r);
+}
+
+Value greater(int64_t l, int64_t r) {
+  return Value::boolean(l > r);
+}
+
+template <class T>
+Value equal(T l, T r) {
+  return Value::boolean(l == r);
 }
 
-ObjPtr nullobj() {
-  return unique_ptr<object::Null>();
+template <class T>
+Value not_equal(T l, T r) {
+  return Value::boolean(l != r);
+}
+
+/// `fn` on two integers or two booleans, as a table entry.
+template <Value (*fn)(int64_t, int64_t)>
+Value integers(Token::Type, const Value& left, const Value& right) {
+  return fn(left.as_integer(), right.as_integer());
+}
+
+template <Value (*fn)(bool, bool)>
+Value booleans(Token::Type, const Value& left, const Value& right) {
+  return fn(left.as_boolean(), right.as_boolean());
+}
+
+Value operand_error(Token::Type op, const Value& left, const Value& right) {
+  auto message = "{} {} {}"_format(
+      type_name(left.type()), operator_str(op), type_name(right.type()));
+  if (left.type() != right.type()) {
+    return Value::error("type mismatch: " + message);
+  }
+  return Value::error("unknown operator: " + message);
+}
+
+/// By operator, left operand type and right operand type. Errors pass
+/// through, the left one first; integers take every operator and booleans
+/// the equalities, and any other pair of operands is an error.
+constexpr auto INFIX = [] {
+  using T = Token::Type;
+  std::array<std::array<std::array<Infix, TYPES>, TYPES>, OPERATORS + 1>
+      table{};
+  for (auto& lefts : table) {
+    for (auto& rights : lefts) {
+      rights.fill(operand_error);
+      rights[column(Type::ERROR)] = pass_right;
+    }
+    lefts[column(Type::ERROR)].fill(pass_left);
+  }
+  auto ints = [&](T op) -> auto& {
+    return table[row(op)][column(Type::INTEGER)][column(Type::INTEGER)];
+  };
+  ints(T::PLUS)     = integers<add>;
+  ints(T::MINUS)    = integers<subtract>;
+  ints(T::ASTERISK) = integers<multiply>;
+  ints(T::SLASH)    = integers<divide>;
+  ints(T::LT)       = integers<less>;
+  ints(T::GT)       = integers<greater>;
+  ints(T::EQ)       = integers<equal<int64_t>>;
+  ints(T::NOT_EQ)   = integers<not_equal<int64_t>>;
+  auto bools = [&](T op) -> auto& {
+    return table[row(op)][column(Type::BOOLEAN)][column(Type::BOOLEAN)];
+  };
+  bools(T::EQ)     = booleans<equal<bool>>;
+  bools(T::NOT_EQ) = booleans<not_equal<bool>>;
+  return table;
+}();
+
+} // namespace
+
+Value eval_prefix(Token::Type op, const Value& right) {
+  return PREFIX[row(op)][column(right.type())](op, right);
+}
+
+Value eval_infix(Token::Type op, const Value& left, const Value& right) {
+  return INFIX[row(op)][column(left.type())][column(right.type())](
+      op, left, right);
+}
+//</editor-fold>
+
+//<editor-fold desc="specialization">
+using Spec = Specialization;
+
+Spec specialize(Token::Type op, Type left, Type right) {
+  if (left == Type::INTEGER && right == Type::INTEGER) {
+    switch (op) {
+    case Token::Type::PLUS: return Spec::INT_ADD;
+    case Token::Type::MINUS: return Spec::INT_SUBTRACT;
+    case Token::Type::ASTERISK: return Spec::INT_MULTIPLY;
+    case Token::Type::SLASH: return Spec::INT_DIVIDE;
+    case Token::Type::LT: return Spec::INT_LT;
+    case Token::Type::GT: return Spec::INT_GT;
+    case Token::Type::EQ: return Spec::INT_EQ;
+    case Token::Type::NOT_EQ: return Spec::INT_NOT_EQ;
+    default: break;
+    }
+  }
+  if (left == Type::BOOLEAN && right == Type::BOOLEAN) {
+    if (op == Token::Type::EQ) return Spec::BOOL_EQ;
+    if (op == Token::Type::NOT_EQ) return Spec::BOOL_NOT_EQ;
+  }
+  return Spec::GENERIC;
+}
+
+/// Evaluates `prefix` as it has specialized, rewriting it on its first run
+/// or once its guard fails.
+Value eval_prefix(const PrefixExpression& prefix, const Value& right) {
+  auto& spec = prefix.specialization;
+  auto op    = prefix.token.type;
+  switch (spec) {
+  case Spec::INT_NEGATE:
+    if (right.type() == Type::INTEGER) {
+      return Value::integer(wrapping_negate(right.as_integer()));
+    }
+    break;
+  case Spec::UNSEEN:
+    if (!right.is_error()) {
+      spec = op == Token::Type::MINUS && right.type() == Type::INTEGER
+                 ? Spec::INT_NEGATE
+                 : Spec::GENERIC;
+    }
+    return eval_prefix(op, right);
+  default: return eval_prefix(op, right);
+  }
+  spec = Spec::GENERIC;
+  return eval_prefix(op, right);
+}
+
+/// Evaluates `infix` as it has specialized, rewriting it on its first run
+/// or once its guard fails.
+Value eval_infix(const InfixExpression& infix,
+                 const Value& left,
+                 const Value& right) {
+  auto& spec = infix.specialization;
+  auto op    = infix.token.type;
+  if (left.type() == Type::INTEGER && right.type() == Type::INTEGER) {
+    auto l = left.as_integer();
+    auto r = right.as_integer();
+    switch (spec) {
+    case Spec::INT_ADD: return add(l, r);
+    case Spec::INT_SUBTRACT: return subtract(l, r);
+    case Spec::INT_MULTIPLY: return multiply(l, r);
+    // Division by zero is an error, not a reason to give up on integers.
+    case Spec::INT_DIVIDE: return divide(l, r);
+    case Spec::INT_LT: return Value::boolean(l < r);
+    case Spec::INT_GT: return Value::boolean(l > r);
+    case Spec::INT_EQ: return Value::boolean(l == r);
+    case Spec::INT_NOT_EQ: return Value::boolean(l != r);
+    default: break;
+    }
+  } else if (left.type() == Type::BOOLEAN && right.type() == Type::BOOLEAN) {
+    auto l = left.as_boolean();
+    auto r = right.as_boolean();
+    switch (spec) {
+    case Spec::BOOL_EQ: return Value::boolean(l == r);
+    case Spec::BOOL_NOT_EQ: return Value::boolean(l != r);
+    default: break;
+    }
+  }
+  if (spec == Spec::UNSEEN) {
+    if (!left.is_error() && !right.is_error()) {
+      spec = specialize(op, left.type(), right.type());
+    }
+  } else {
+    spec = Spec::GENERIC;
+  }
+  return eval_infix(op, left, right);
+}
+//</editor-fold>
+
+/// Where the call `env` keeps `name`, which is not a global.
+Value& variable(Environment& env, const Identifier& name) {
+  switch (name.scope) {
+  case Scope::LOCAL: return env.slots[name.index];
+  case Scope::CELL: return *env.cells[name.index];
+  default: return *env.function->captures[name.index];
+  }
 }
 
-ObjPtr eval_statements(const vector<unique_ptr<Statement>>& stmts) {
-  ObjPtr result{};
-  for (auto& stmt : stmts) { result = eval(*stmt); }
+void assign(Environment& env, const Identifier& name, Value value) {
+  if (name.scope == Scope::GLOBAL) {
+    env.set_global(name.value, std::move(value));
+  } else {
+    variable(env, name) = std::move(value);
+  }
+}
+
+/// Closes `literal` over the cells it captures from the call `env`, in the
+/// program whose globals are `globals`.
+Value make_function(const FunctionLiteral& literal,
+                    Environment& env,
+                    const Env& globals) {
+  std::vector<object::Cell> captures{};
+  captures.reserve(literal.captures.size());
+  for (auto& capture : literal.captures) {
+    captures.push_back(capture.scope == Scope::CELL
+                           ? env.cells[capture.index]
+                           : env.function->captures[capture.index]);
+  }
+  return Value::function(literal, std::move(captures), globals);
+}
+
+//<editor-fold desc="machine">
+/// Evaluates a tree with explicit stacks in place of recursion, so programs
+/// may nest and recurse as deeply as memory allows. Evaluating a node leaves
+/// its value on `values`. A node with children pushes a task to finish it,
+/// then tasks to evaluate the children, which run first.
+struct Machine {
+  struct Task {
+    enum class Kind : uint8_t {
+      EVAL,
+      /// Statement `index` of a block or program has left its value.
+      BLOCK,
+      PROGRAM,
+      LET,
+      RETURN,
+      IF,
+      PREFIX,
+      INFIX,
+      /// The function of a call has been evaluated, and argument `index - 1`
+      /// after it.
+      ARGUMENTS,
+      /// The body of the innermost call has left its value; `index` is
+      /// where its callee is on the stack.
+      CALL_END,
+    };
+    Kind kind;
+    uint32_t index{0};
+    const Node* node{nullptr};
+  };
+
+  Env globals;
+  /// Tried first for every call, if set.
+  jit::Jit* jit{nullptr};
+  std::vector<Value> values{};
+  std::vector<Task> tasks{};
+  /// Calls in progress, innermost last.
+  std::deque<Environment> frames{};
+
+  Environment& env() { return frames.empty() ? *globals : frames.back(); }
+
+  Value run(const Node& node) {
+    values.reserve(64);
+    tasks.reserve(64);
+    eval(node);
+    while (!tasks.empty()) {
+      auto task = tasks.back();
+      tasks.pop_back();
+      step(task);
+    }
+    return std::move(values.back());
+  }
+
+  /// Evaluates `node` now if it can be done in a few native frames, or
+  /// schedules it.
+  void visit(const Node& node) {
+    if (node.operator_depth <= MAX_OPERATOR_DEPTH) {
+      values.push_back(operators(node));
+    } else {
+      tasks.push_back({Task::Kind::EVAL, 0, &node});
+    }
+  }
+
+  /// How deep operators() may recurse on the native stack.
+  static constexpr int MAX_OPERATOR_DEPTH = 16;
+
+  /// Evaluates `node`, which resolve() found is made of operators and
+  /// leaves alone, nested no deeper than MAX_OPERATOR_DEPTH.
+  Value operators(const Node& node) {
+    switch (node.kind) {
+    case Node::Kind::IDENTIFIER:
+      return identifier(static_cast<const Identifier&>(node));
+    case Node::Kind::INTEGER:
+      return Value::integer(static_cast<const IntegerLiteral&>(node).value);
+    case Node::Kind::BOOLEAN:
+      return Value::boolean(static_cast<const Boolean&>(node).value);
+    case Node::Kind::PREFIX: {
+      auto& prefix = static_cast<const PrefixExpression&>(node);
+      return eval_prefix(prefix, operators(*prefix.right));
+    }
+    default: {
+      auto& infix = static_cast<const InfixExpression&>(node);
+      auto left   = operators(*infix.left);
+      auto right  = operators(*infix.right);
+      return eval_infix(infix, left, right);
+    }
+    }
+  }
+
+  void eval(const Node& node) {
+    using Kind = Node::Kind;
+    switch (node.kind) {
+    case Kind::PROGRAM:
+      tasks.push_back({Task::Kind::PROGRAM});
+      return block(node, static_cast<const Program&>(node).statements);
+    case Kind::LET:
+      tasks.push_back({Task::Kind::LET, 0, &node});
+      return visit(*static_cast<const LetStatement&>(node).value);
+    case Kind::RETURN:
+      tasks.push_back({Task::Kind::RETURN});
+      return visit(*static_cast<const ReturnStatement&>(node).return_value);
+    case Kind::EXPRESSION:
+      return visit(*static_cast<const ExpressionStatement&>(node).expression);
+    case Kind::BLOCK:
+      return block(node, static_cast<const BlockStatement&>(node).statements);
+    case Kind::IDENTIFIER:
+    case Kind::INTEGER:
+    case Kind::BOOLEAN: values.push_back(operators(node)); return;
+    case Kind::PREFIX:
+      tasks.push_back({Task::Kind::PREFIX, 0, &node});
+      return visit(*static_cast<const PrefixExpression&>(node).right);
+    case Kind::INFIX: {
+      auto& infix = static_cast<const InfixExpression&>(node);
+      tasks.push_back({Task::Kind::INFIX, 0, &node});
+      tasks.push_back({Task::Kind::EVAL, 0, infix.right});
+      return visit(*infix.left);
+    }
+    case Kind::IF:
+      tasks.push_back({Task::Kind::IF, 0, &node});
+      return visit(*static_cast<const IfExpression&>(node).condition);
+    case Kind::FUNCTION:
+      values.push_back(make_function(
+          static_cast<const FunctionLiteral&>(node), env(), globals));
+      return;
+    case Kind::CALL:
+      tasks.push_back({Task::Kind::ARGUMENTS, 0, &node});
+      return visit(*static_cast<const CallExpression&>(node).function);
+    }
+  }
+
+  Value identifier(const Identifier& ident) {
+    if (ident.scope != Scope::GLOBAL) return variable(env(), ident);
+    if (auto* value = env().global(ident.value)) return *value;
+    return Value::error(
+        "identifier not found: {}"_format(ident.value.name()));
+  }
+
+  /// Runs `stmts` in order, stopping early at a return or an error; the
+  /// last value is the block's.
+  void block(const Node& node, span<Statement* const> stmts) {
+    if (stmts.empty()) {
+      values.emplace_back();
+      return;
+    }
+    tasks.push_back({Task::Kind::BLOCK, 0, &node});
+    visit(*stmts[0]);
+  }
+
+  static span<Statement* const> statements(const Node& node) {
+    if (node.kind == Node::Kind::PROGRAM) {
+      return static_cast<const Program&>(node).statements;
+    }
+    return static_cast<const BlockStatement&>(node).statements;
+  }
+
+  Value pop() {
+    auto value = std::move(values.back());
+    values.pop_back();
+    return value;
+  }
+
+  void step(const Task& task) {
+    using Kind = Task::Kind;
+    switch (task.kind) {
+    case Kind::EVAL: return eval(*task.node);
+    case Kind::BLOCK: {
+      auto stmts  = statements(*task.node);
+      auto& value = values.back();
+      auto next   = task.index + 1;
+      if (value.returning || value.is_error() || next == stmts.size()) return;
+      values.pop_back();
+      tasks.push_back({Kind::BLOCK, next, task.node});
+      return visit(*stmts[next]);
+    }
+    case Kind::PROGRAM: values.back().returning = false; return;
+    case Kind::LET: {
+      if (values.back().is_error()) return;
+      assign(env(), *static_cast<const LetStatement&>(*task.node).name, pop());
+      values.emplace_back();
+      return;
+    }
+    case Kind::RETURN:
+      if (!values.back().is_error()) values.back().returning = true;
+      return;
+    case Kind::IF: {
+      auto& ife      = static_cast<const IfExpression&>(*task.node);
+      auto condition = pop();
+      if (condition.is_error()) {
+        values.push_back(std::move(condition));
+      } else if (condition.truthy()) {
+        block(*ife.consequence, ife.consequence->statements);
+      } else if (ife.alternative) {
+        block(*ife.alternative, ife.alternative->statements);
+      } else {
+        values.emplace_back();
+      }
+      return;
+    }
+    case Kind::PREFIX: {
+      auto right = pop();
+      values.push_back(
+          eval_prefix(static_cast<const PrefixExpression&>(*task.node), right));
+      return;
+    }
+    case Kind::INFIX: {
+      auto right = pop();
+      auto& left = values.back();
+      left       = eval_infix(
+          static_cast<const InfixExpression&>(*task.node), left, right);
+      return;
+    }
+    case Kind::ARGUMENTS: return arguments(task);
+    case Kind::CALL_END: return call_end();
+    }
+  }
+
+  /// Evaluates a call's arguments one at a time, then makes the call.
+  void arguments(const Task& task) {
+    auto& call = static_cast<const CallExpression&>(*task.node);
+    if (values.back().is_error()) {
+      // The callee and the arguments before give way to the error.
+      auto error = pop();
+      values.resize(values.size() - task.index);
+      values.push_back(std::move(error));
+      return;
+    }
+    if (task.index < call.arguments.size()) {
+      tasks.push_back({Task::Kind::ARGUMENTS, task.index + 1, task.node});
+      return visit(*call.arguments[task.index]);
+    }
+    if (call.tail) return tail_call(task.index);
+    apply(task.index);
+  }
+
+  /// Replaces the innermost call with the call in its tail position, whose
+  /// callee and `count` arguments are on top of the stack. The tasks and
+  /// values above the call's callee, left by whatever the tail call is
+  /// nested in, go with its frame, so a tail-recursive loop runs in constant
+  /// space.
+  void tail_call(size_t count) {
+    while (tasks.back().kind != Task::Kind::CALL_END) tasks.pop_back();
+    auto callee = values.begin() + tasks.back().index;
+    tasks.pop_back();
+    frames.pop_back();
+    values.erase(callee, values.end() - static_cast<ptrdiff_t>(count) - 1);
+    apply(count);
+  }
+
+  /// Calls the function below the top `count` values, which are its
+  /// arguments. Only the callee stays on the stack, to keep it alive until
+  /// the call's value replaces it.
+  void apply(size_t count) {
+    auto args    = values.end() - static_cast<ptrdiff_t>(count);
+    auto& callee = args[-1];
+    if (callee.type() != Type::FUNCTION) {
+      auto error = Value::error(
+          "not a function: {}"_format(type_name(callee.type())));
+      values.erase(args - 1, values.end());
+      values.push_back(std::move(error));
+      return;
+    }
+    auto& fn     = callee.as<object::Function>();
+    auto& params = fn.literal.parameters;
+    if (params.size() != count) {
+      auto error =
+          Value::error("wrong number of arguments: want={}, got={}"_format(
+              params.size(), count));
+      values.erase(args - 1, values.end());
+      values.push_back(std::move(error));
+      return;
+    }
+    Value result{};
+    if (jit && jit->call(fn, {std::to_address(args), count}, result)) {
+      values.erase(args, values.end());
+      values.back() = std::move(result);
+      return;
+    }
+
+    auto& frame = frames.emplace_back(fn);
+    for (size_t i{0}; i < count; ++i) {
+      assign(frame, params[i], std::move(args[i]));
+    }
+    values.erase(args, values.end());
+    tasks.push_back(
+        {Task::Kind::CALL_END, static_cast<uint32_t>(values.size() - 1)});
+    block(*fn.literal.body, fn.literal.body->statements);
+  }
+
+  void call_end() {
+    auto result      = pop();
+    result.returning = false;
+    frames.pop_back();
+    values.back() = std::move(result);
+  }
+};
+//</editor-fold>
+
+Value eval(const Node& node, const Env& env, jit::Jit* jit) {
+  return Machine{env, jit}.run(node);
+}
+
+Value eval(const Node& node) {
+  auto env    = std::make_shared<Environment>();
+  auto result = eval(node, env);
+  env->clear_globals();
   return result;
 }
 
-ObjPtr eval_bang_operator_expression(const ObjPtr& right) {
-  const auto& r = *right;
-  if (typeid(r) == typeid(object::Boolean)) {
-    auto& b = dynamic_cast<const object::Boolean&>(r);
-    return make_unique<object::Boolean>(!b.value);
-  }
-  return make_unique<object::Boolean>(false);
-}
-
-ObjPtr eval_minus_operator_expression(const ObjPtr& right) {
-  const auto& r = *right;
-  if (typeid(r) != typeid(object::Integer)) {
-    return make_unique<object::Null>();
-  }
-  auto& i = dynamic_cast<const object::Integer&>(r);
-  return make_unique<object::Integer>(-i.value);
-}
-
-ObjPtr eval(const Program& program) {
-  // fmt::print("evalprog.\n");
-  return eval_statements(program.statements);
-}
-
-ObjPtr eval(const ExpressionStatement& estmt) {
-  // fmt::print("evalexp.\n");
-  return eval(*estmt.expression);
-}
-
-ObjPtr eval(const IntegerLiteral& lit) {
-  // fmt::print("evallit.\n");
-  return make_unique<object::Integer>(lit.value);
-}
-
-ObjPtr eval(const Boolean& b) {
-  // fmt::print("evalb.\n");
-  return make_unique<object::Boolean>(b.value);
-}
-
-ObjPtr eval(const PrefixExpression& b) {
-  auto right = eval(*b.right);
-  if (b.op == "!") return eval_bang_operator_expression(right);
-  if (b.op == "-") return eval_minus_operator_expression(right);
-  return nullobj();
-}
-
-ObjPtr eval(const InfixExpression& b) {
-  const auto& left  = eval(*b.left);
-  const auto& right = eval(*b.right);
-  if (typeid(left) != typeid(IntegerLiteral)
-      || typeid(right) != typeid(IntegerLiteral))
-    return nullobj();
-  const auto& l = dynamic_cast<const IntegerLiteral&>(*left);
-  const auto& r = dynamic_cast<const IntegerLiteral&>(*right);
-  if (b.op == "+") return intobj(l.value + r.value);
-  if (b.op == "-") return intobj(l.value - r.value);
-  return unique_ptr<object::Null>();
-}
-
-ObjPtr eval(const Node& node) {
-  // fmt::print("eval.\n");
-
-  static unordered_map<type_index, function<ObjPtr(const Node&)>> lookup{
-      {typeid(Program),
-       [](const Node& node) {
-         return eval(dynamic_cast<const Program&>(node));
-       }},
-      {typeid(ExpressionStatement),
-       [](const Node& node) {
-         return eval(dynamic_cast<const ExpressionStatement&>(node));
-       }},
-      {typeid(IntegerLiteral),
-       [](const Node& node) {
-         return eval(dynamic_cast<const IntegerLiteral&>(node));
-       }},
-      {typeid(Boolean),
-       [](const Node& node) {
-         return eval(dynamic_cast<const Boolean&>(node));
-       }},
-      {typeid(PrefixExpression),
-       [](const Node& node) {
-         return eval(dynamic_cast<const PrefixExpression&>(node));
-       }},
-      {typeid(InfixExpression),
-       [](const Node& node) {
-         return eval(dynamic_cast<const InfixExpression&>(node));
-       }},
+//<editor-fold desc="flat">
+namespace {
+
+/// A function of a FlatAst, closed over the cells its body uses. The tree
+/// must outlive calls of the function.
+struct FlatFunction : object::Object {
+  const FlatAst& ast;
+  FlatAst::Ref node;
+  /// In the order of the function's captures.
+  std::vector<object::Cell> captures;
+
+  FlatFunction(const FlatAst& ast,
+               FlatAst::Ref node,
+               std::vector<object::Cell> captures)
+      : ast{ast}
+      , node{node}
+      , captures{std::move(captures)} { }
+
+  std::string inspect() const override {
+    std::ostringstream out{};
+    ast.print(out, node);
+    return out.str();
+  }
+};
+
+/// Walks a FlatAst, recursing on the native stack for nesting and calls,
+/// with the variables laid out as resolve() did for the tree it came from.
+struct FlatMachine {
+  /// A call in progress.
+  struct Frame {
+    std::vector<Value> slots;
+    std::vector<object::Cell> cells;
+    const FlatFunction* function;
   };
-  return lookup[typeid(node)](node);
+
+  /// How deeply calls may nest before giving a stack overflow.
+  static constexpr size_t MAX_CALLS = 1024;
+
+  const FlatAst& ast;
+  Environment& globals;
+  /// The innermost call, or null at the top level.
+  Frame* frame{nullptr};
+  size_t calls{0};
+
+  /// Where the running call keeps the IDENT `ident`, which is not a global.
+  Value& variable(const FlatAst::Node& ident) {
+    switch (static_cast<Scope>(ident.b)) {
+    case Scope::LOCAL: return frame->slots[ident.c];
+    case Scope::CELL: return *frame->cells[ident.c];
+    default: return *frame->function->captures[ident.c];
+    }
+  }
+
+  void assign(const FlatAst::Node& ident, Value value) {
+    if (static_cast<Scope>(ident.b) == Scope::GLOBAL) {
+      globals.set_global(Symbol{ident.a}, std::move(value));
+    } else {
+      variable(ident) = std::move(value);
+    }
+  }
+
+  Value eval(FlatAst::Ref ref) {
+    using Kind = FlatAst::Kind;
+    if (ref == FlatAst::NONE) return Value{};
+
+    auto& n = ast[ref];
+    switch (n.kind) {
+    case Kind::BLOCK: {
+      Value result{};
+      for (auto s : ast.list(n.a, n.b)) {
+        result = eval(s);
+        if (result.returning || result.is_error()) break;
+      }
+      return result;
+    }
+    case Kind::LET: {
+      auto value = eval(n.b);
+      if (value.is_error()) return value;
+      assign(ast[n.a], std::move(value));
+      return Value{};
+    }
+    case Kind::RETURN: {
+      auto value = eval(n.a);
+      if (!value.is_error()) value.returning = true;
+      return value;
+    }
+    case Kind::EXPRESSION: return eval(n.a);
+    case Kind::IDENT: {
+      if (static_cast<Scope>(n.b) != Scope::GLOBAL) return variable(n);
+      if (auto* value = globals.global(Symbol{n.a})) return *value;
+      return Value::error(
+          "identifier not found: {}"_format(Symbol{n.a}.name()));
+    }
+    case Kind::INT: return Value::integer(ast.ints[n.a]);
+    case Kind::BOOL: return Value::boolean(n.a != 0);
+    case Kind::PREFIX: return eval_prefix(n.op, eval(n.a));
+    case Kind::INFIX: {
+      auto left = eval(n.a);
+      return eval_infix(n.op, left, eval(n.b));
+    }
+    case Kind::IF: {
+      auto condition = eval(n.a);
+      if (condition.is_error()) return condition;
+      return eval(condition.truthy() ? n.b : n.c);
+    }
+    case Kind::FUNCTION: return function(ref);
+    case Kind::CALL: return call(n);
+    }
+    return Value{};
+  }
+
+  /// Closes the FUNCTION `ref` over the cells it captures from the running
+  /// call.
+  Value function(FlatAst::Ref ref) {
+    auto& fn = ast.functions[ast[ref].c];
+    std::vector<object::Cell> captures{};
+    captures.reserve(fn.captures_count);
+    for (auto& capture :
+         span{ast.captures}.subspan(fn.captures, fn.captures_count)) {
+      captures.push_back(capture.scope == Scope::CELL
+                             ? frame->cells[capture.index]
+                             : frame->function->captures[capture.index]);
+    }
+    return {Type::FLAT_FUNCTION,
+            new FlatFunction{ast, ref, std::move(captures)}};
+  }
+
+  Value call(const FlatAst::Node& n) {
+    auto callee = eval(n.a);
+    if (callee.is_error()) return callee;
+    std::vector<Value> args{};
+    args.reserve(n.c);
+    for (auto arg : ast.list(n.b, n.c)) {
+      args.push_back(eval(arg));
+      if (args.back().is_error()) return std::move(args.back());
+    }
+    if (callee.type() != Type::FLAT_FUNCTION) {
+      return Value::error(
+          "not a function: {}"_format(type_name(callee.type())));
+    }
+    auto& fn      = callee.as<FlatFunction>();
+    auto& literal = ast[fn.node];
+    if (literal.b != args.size()) {
+      return Value::error(
+          "wrong number of arguments: want={}, got={}"_format(literal.b,
+                                                              args.size()));
+    }
+    if (calls == MAX_CALLS) return Value::error("stack overflow");
+
+    auto& layout = ast.functions[literal.c];
+    Frame callee_frame{std::vector<Value>(layout.slots),
+                       std::vector<object::Cell>(layout.cells),
+                       &fn};
+    for (auto& cell : callee_frame.cells) cell = std::make_shared<Value>();
+    auto* caller = std::exchange(frame, &callee_frame);
+    ++calls;
+    auto params = ast.list(literal.a, literal.b);
+    for (size_t i{0}; i < args.size(); ++i) {
+      assign(ast[params[i]], std::move(args[i]));
+    }
+    auto result = eval(layout.body);
+    --calls;
+    frame            = caller;
+    result.returning = false;
+    return result;
+  }
+};
+
+} // namespace
+
+Value eval(const FlatAst& ast) {
+  Environment globals{};
+  auto result      = FlatMachine{ast, globals}.eval(ast.root);
+  result.returning = false;
+  return result;
 }
+//</editor-fold>
 
 } // namespace monkey
@@ -0,0 +1,219 @@
+#include "monkey/flat_ast.h"
+
+#include <stdexcept>
+
+using std::ostream;
+using std::span;
+
+namespace monkey {
+
+using Ref  = FlatAst::Ref;
+using Kind     = FlatAst::Kind;
+using TreeKind = monkey::Node::Kind;
+
+FlatAst::FlatAst(const Program& program) {
+  root = lower_block(program.statements);
+}
+
+const FlatAst::Node& FlatAst::operator[](Ref ref) const {
+  return nodes[ref];
+}
+
+span<const Ref> FlatAst::list(Ref start, Ref count) const {
+  return span<const Ref>{lists}.subspan(start, count);
+}
+
+size_t FlatAst::memory() const {
+  return nodes.capacity() * sizeof(Node) + lists.capacity() * sizeof(Ref)
+         + ints.capacity() * sizeof(int64_t)
+         + functions.capacity() * sizeof(Function)
+         + captures.capacity() * sizeof(Capture);
+}
+
+Ref FlatAst::push(Node node) {
+  nodes.push_back(node);
+  return static_cast<Ref>(nodes.size() - 1);
+}
+
+Ref FlatAst::lower_block(span<Statement* const> statements) {
+  // Children are lowered before their run is written, so nested lists
+  // never interleave with this one.
+  std::vector<Ref> children{};
+  children.reserve(statements.size());
+  for (auto* s : statements) {
+    if (s) children.push_back(lower(s));
+  }
+  auto start = static_cast<Ref>(lists.size());
+  lists.insert(lists.end(), children.begin(), children.end());
+  return push({Kind::BLOCK, {}, start, static_cast<Ref>(children.size())});
+}
+
+Ref FlatAst::lower(const monkey::Node* node) {
+  if (!node) return NONE;
+
+  switch (node->kind) {
+  case TreeKind::LET: {
+    auto* n   = static_cast<const LetStatement*>(node);
+    auto name = lower(n->name);
+    return push({Kind::LET, {}, name, lower(n->value)});
+  }
+  case TreeKind::RETURN: {
+    auto* n = static_cast<const ReturnStatement*>(node);
+    return push({Kind::RETURN, {}, lower(n->return_value)});
+  }
+  case TreeKind::EXPRESSION: {
+    auto* n = static_cast<const ExpressionStatement*>(node);
+    return push({Kind::EXPRESSION, {}, lower(n->expression)});
+  }
+  case TreeKind::BLOCK: {
+    auto* n = static_cast<const BlockStatement*>(node);
+    return lower_block(n->statements);
+  }
+  case TreeKind::IDENTIFIER: {
+    auto* n = static_cast<const Identifier*>(node);
+    return push({Kind::IDENT,
+                 {},
+                 n->value.id,
+                 static_cast<Ref>(n->scope),
+                 n->index});
+  }
+  case TreeKind::INTEGER: {
+    auto* n = static_cast<const IntegerLiteral*>(node);
+    ints.push_back(n->value);
+    return push({Kind::INT, {}, static_cast<Ref>(ints.size() - 1)});
+  }
+  case TreeKind::BOOLEAN: {
+    auto* n = static_cast<const Boolean*>(node);
+    return push({Kind::BOOL, {}, n->value});
+  }
+  case TreeKind::PREFIX: {
+    auto* n = static_cast<const PrefixExpression*>(node);
+    return push({Kind::PREFIX, n->token.type, lower(n->right)});
+  }
+  case TreeKind::INFIX: {
+    auto* n = static_cast<const InfixExpression*>(node);
+    auto left = lower(n->left);
+    return push({Kind::INFIX, n->token.type, left, lower(n->right)});
+  }
+  case TreeKind::IF: {
+    auto* n = static_cast<const IfExpression*>(node);
+    auto condition   = lower(n->condition);
+    auto consequence = lower(n->consequence);
+    return push(
+        {Kind::IF, {}, condition, consequence, lower(n->alternative)});
+  }
+  case TreeKind::FUNCTION: {
+    auto* n = static_cast<const FunctionLiteral*>(node);
+    std::vector<Ref> params{};
+    for (auto& p : n->parameters) params.push_back(lower(&p));
+    auto body  = lower(n->body);
+    auto start = static_cast<Ref>(lists.size());
+    lists.insert(lists.end(), params.begin(), params.end());
+    functions.push_back({body,
+                         n->slots,
+                         n->cells,
+                         static_cast<Ref>(captures.size()),
+                         static_cast<Ref>(n->captures.size())});
+    captures.insert(captures.end(), n->captures.begin(), n->captures.end());
+    return push({Kind::FUNCTION,
+                 {},
+                 start,
+                 static_cast<Ref>(params.size()),
+                 static_cast<Ref>(functions.size() - 1)});
+  }
+  case TreeKind::CALL: {
+    auto* n = static_cast<const CallExpression*>(node);
+    auto function = lower(n->function);
+    std::vector<Ref> args{};
+    for (auto* arg : n->arguments) args.push_back(lower(arg));
+    auto start = static_cast<Ref>(lists.size());
+    lists.insert(lists.end(), args.begin(), args.end());
+    return push(
+        {Kind::CALL, {}, function, start, static_cast<Ref>(args.size())});
+  }
+  case TreeKind::PROGRAM: break;
+  }
+  throw std::logic_error{"a program cannot be nested"};
+}
+
+void FlatAst::print(ostream& out, Ref ref) const {
+  if (ref == NONE) return;
+  auto& n         = nodes[ref];
+  auto print_list = [&](Ref start, Ref count, const char* separator) {
+    bool first{true};
+    for (auto child : list(start, count)) {
+      if (!first) out << separator;
+      print(out, child);
+      first = false;
+    }
+  };
+
+  switch (n.kind) {
+  case Kind::LET:
+    out << "let ";
+    print(out, n.a);
+    out << " = ";
+    print(out, n.b);
+    out << ";";
+    break;
+  case Kind::RETURN:
+    out << "return ";
+    print(out, n.a);
+    out << ";";
+    break;
+  case Kind::EXPRESSION: print(out, n.a); break;
+  case Kind::BLOCK:
+    out << "{";
+    for (auto child : list(n.a, n.b)) {
+      out << " ";
+      print(out, child);
+    }
+    out << " }";
+    break;
+  case Kind::IDENT: out << Symbol{n.a}; break;
+  case Kind::INT: out << ints[n.a]; break;
+  case Kind::BOOL: out << (n.a ? "true" : "false"); break;
+  case Kind::PREFIX:
+    out << "(" << operator_str(n.op);
+    print(out, n.a);
+    out << ")";
+    break;
+  case Kind::INFIX:
+    out << "(";
+    print(out, n.a);
+    out << " " << operator_str(n.op) << " ";
+    print(out, n.b);
+    out << ")";
+    break;
+  case Kind::IF:
+    out << "if ";
+    print(out, n.a);
+    out << " ";
+    print(out, n.b);
+    if (n.c != NONE) {
+      out << " else ";
+      print(out, n.c);
+    }
+    break;
+  case Kind::FUNCTION:
+    out << "fn(";
+    print_list(n.a, n.b, ", ");
+    out << ") ";
+    print(out, functions[n.c].body);
+    break;
+  case Kind::CALL:
+    print(out, n.a);
+    out << "(";
+    print_list(n.b, n.c, ", ");
+    out << ")";
+    break;
+  }
+}
+
+ostream& operator<<(ostream& out, const FlatAst& ast) {
+  // The program itself prints without braces.
+  for (auto s : ast.list(ast[ast.root].a, ast[ast.root].b)) ast.print(out, s);
+  return out;
+}
+
+} // namespace monkey
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+/// Bump allocator that owns everything built in it. Objects are never
+/// destroyed one by one: the memory all goes back at once with the arena,
+/// so only types whose destructors free nothing outside the arena may live
+/// here. Also usable as the resource of std::pmr containers.
+struct Arena : std::pmr::memory_resource {
+  Arena();
+
+  template <class T, class... Args>
+  T* make(Args&&... args) {
+    void* at = allocate(sizeof(T), alignof(T));
+    return new (at) T(std::forward<Args>(args)...);
+  }
+
+  /// Copies `text` into the arena.
+  std::string_view copy(std::string_view text);
+
+  /// Copies `items` into the arena, tightly packed.
+  template <class T>
+  std::span<T> copy(const std::vector<T>& items) {
+    if (items.empty()) return {};
+    auto* at = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+    std::uninitialized_copy(items.begin(), items.end(), at);
+    return {at, items.size()};
+  }
+
+  /// Keeps `other` and everything in it alive as long as this arena.
+  void adopt(std::unique_ptr<Arena> other);
+
+  /// Bytes handed out so far, including by adopted arenas.
+  size_t used() const;
+
+private:
+  std::pmr::monotonic_buffer_resource pool;
+  std::vector<std::unique_ptr<Arena>> adopted{};
+  size_t bytes{0};
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override;
+  bool do_is_equal(const memory_resource& other) const noexcept override;
+};
+
+} // namespace monkey
@@ -1,18 +1,49 @@
 #pragma once
 
-#include <string>
+#include <memory>
+#include <span>
+#include <string_view>
 #include <vector>
 
+#include "monkey/arena.h"
+#include "monkey/symbol.h"
 #include "monkey/token.h"
 
 namespace monkey {
 
+/// Nodes live in their Program's arena and are never destroyed one by one,
+/// so they hold plain pointers to their children, spans for lists and
+/// literals copied into the same arena.
 struct Node {
-  Token token;
-  explicit Node(Token&& token);
+  /// The concrete node type, so passes can switch instead of using RTTI.
+  enum class Kind : uint8_t {
+    PROGRAM,
+    LET,
+    RETURN,
+    EXPRESSION,
+    BLOCK,
+    IDENTIFIER,
+    INTEGER,
+    BOOLEAN,
+    PREFIX,
+    INFIX,
+    IF,
+    FUNCTION,
+    CALL,
+  };
+
+  Kind kind;
+  /// For an expression made of prefix and infix operators over identifiers
+  /// and literals alone, how deeply its operators nest; OPAQUE for anything
+  /// else, or deeper than that. Set by resolve().
+  uint8_t operator_depth{OPAQUE};
+  TokenView token;
+  Node(Kind kind, TokenView token);
+
+  static constexpr uint8_t OPAQUE = 255;
   virtual ~Node() = default;
 
-  const std::string& token_literal() const;
+  std::string_view token_literal() const;
 
   friend std::ostream& operator<<(std::ostream&, const Node&);
 
@@ -21,115 +52,172 @@ protected:
 };
 
 struct Statement : Node {
-  explicit Statement(Token&& token);
+  Statement(Kind kind, TokenView token);
 };
 
 struct Expression : Node {
-  explicit Expression(Token&& token);
+  Expression(Kind kind, TokenView token);
 };
 
 struct Program : Node {
-  std::vector<std::unique_ptr<Statement>> statements{};
+  /// Holds every node of the tree; dropping it frees them all at once.
+  std::unique_ptr<Arena> arena;
+  std::vector<Statement*> statements{};
   Program();
   std::ostream& print(std::ostream&) const override;
+
+  /// Moves `other`'s statements to the end of this program. Its nodes stay
+  /// where they are; this program takes over their arena.
+  void append(Program&& other);
 };
 
 struct BlockStatement : Statement {
-  explicit BlockStatement(Token&& token);
+  explicit BlockStatement(TokenView token);
 
-  std::vector<std::unique_ptr<Statement>> statements{};
+  std::span<Statement*> statements{};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct Identifier : Expression {
-  explicit Identifier(Token token);
-
-  std::string value;
+  explicit Identifier(TokenView token);
+
+  /// Where a variable's value is kept.
+  enum class Scope : uint8_t {
+    GLOBAL,  ///< Bound outside every function; found by name.
+    LOCAL,   ///< A slot of the current call.
+    CELL,    ///< A cell of the current call, shared with closures.
+    CAPTURE, ///< A cell the running closure captured.
+  };
+
+  Symbol value;
+  /// Where resolve() found the binding, and its index among the current
+  /// call's slots or cells or the closure's captures.
+  Scope scope{Scope::GLOBAL};
+  uint32_t index{0};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct LetStatement : Statement {
-  explicit LetStatement(Token token);
+  explicit LetStatement(TokenView token);
 
-  std::unique_ptr<Identifier> name{};
-  std::unique_ptr<Expression> value{};
+  Identifier* name{nullptr};
+  Expression* value{nullptr};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct ReturnStatement : Statement {
-  explicit ReturnStatement(Token token);
+  explicit ReturnStatement(TokenView token);
 
-  std::unique_ptr<Expression> return_value;
+  Expression* return_value{nullptr};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct ExpressionStatement : Statement {
-  explicit ExpressionStatement(Token token);
+  explicit ExpressionStatement(TokenView token);
 
-  std::unique_ptr<Expression> expression;
+  Expression* expression{nullptr};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct IntegerLiteral : Expression {
-  explicit IntegerLiteral(Token token);
-
-  int value;
+  explicit IntegerLiteral(TokenView token);
+
+  int64_t value;
+};
+
+/// What the evaluator has rewritten an operator node to. The first time the
+/// node runs it specializes on its operator and the operand types it sees;
+/// from then on it only checks those types, and if they ever differ it
+/// falls back to GENERIC for good.
+enum class Specialization : uint8_t {
+  UNSEEN,
+  GENERIC,
+  INT_NEGATE,
+  INT_ADD,
+  INT_SUBTRACT,
+  INT_MULTIPLY,
+  INT_DIVIDE,
+  INT_LT,
+  INT_GT,
+  INT_EQ,
+  INT_NOT_EQ,
+  BOOL_EQ,
+  BOOL_NOT_EQ,
 };
 
 struct PrefixExpression : Expression {
-  explicit PrefixExpression(Token token);
+  explicit PrefixExpression(TokenView token);
 
-  std::string op;
-  std::unique_ptr<Expression> right;
+  std::string_view op;
+  Expression* right{nullptr};
+  /// Rewritten as the node is evaluated, so a tree must not be evaluated
+  /// on two threads at once.
+  mutable Specialization specialization{Specialization::UNSEEN};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct InfixExpression : Expression {
-  explicit InfixExpression(Token token, std::unique_ptr<Expression>&& left);
+  explicit InfixExpression(TokenView token, Expression* left);
 
-  std::string op;
-  std::unique_ptr<Expression> left;
-  std::unique_ptr<Expression> right;
+  std::string_view op;
+  Expression* left{nullptr};
+  Expression* right{nullptr};
+  mutable Specialization specialization{Specialization::UNSEEN};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct Boolean : Expression {
-  explicit Boolean(Token&& token);
+  explicit Boolean(TokenView token);
 
   bool value;
 };
 
 struct IfExpression : Expression {
-  explicit IfExpression(Token&& token);
+  explicit IfExpression(TokenView token);
 
-  std::unique_ptr<Expression> condition;
-  std::unique_ptr<BlockStatement> consequence;
-  std::unique_ptr<BlockStatement> alternative;
+  Expression* condition{nullptr};
+  BlockStatement* consequence{nullptr};
+  BlockStatement* alternative{nullptr};
 
   std::ostream& print(std::ostream&) const override;
 };
 
+/// A free variable of a function: the CELL or CAPTURE its closure copies
+/// from the call that makes it.
+struct Capture {
+  Identifier::Scope scope;
+  uint32_t index;
+};
+
 struct FunctionLiteral : Expression {
-  explicit FunctionLiteral(Token&& token);
+  explicit FunctionLiteral(TokenView token);
 
-  std::vector<Identifier> parameters{};
-  std::unique_ptr<BlockStatement> body;
+  std::span<Identifier> parameters{};
+  BlockStatement* body{nullptr};
+  /// Set by resolve(): the variables the body uses from enclosing functions,
+  /// and how many slots and cells a call needs for its own.
+  std::span<Capture> captures{};
+  uint32_t slots{0};
+  uint32_t cells{0};
 
   std::ostream& print(std::ostream&) const override;
 };
 
 struct CallExpression : Expression {
-  explicit CallExpression(Token&& token, std::unique_ptr<Expression> expression);
+  explicit CallExpression(TokenView token, Expression* function);
 
-  std::vector<std::unique_ptr<Expression>> arguments;
-  std::unique_ptr<Expression> function;
+  std::span<Expression*> arguments{};
+  Expression* function{nullptr};
+  /// Whether the call's value is the enclosing function's, so the call can
+  /// replace it; set by resolve().
+  bool tail{false};
 
   std::ostream& print(std::ostream&) const override;
 };
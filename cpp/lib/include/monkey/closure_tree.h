@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "ast.h"
+#include "evaluator.h"
+#include "object.h"
+#include "value.h"
+
+namespace monkey::closure {
+
+struct Frame;
+
+/// A node lowered to a closure: the function that evaluates this kind of
+/// node, with this operator or this kind of variable, bound to its operands.
+/// Running one never looks at the node it came from to decide what to do.
+struct Code {
+  using Run = Value (*)(const Code& code, Frame& frame);
+
+  Run run;
+  /// Children, by what `run` expects: operands, a condition and branches, a
+  /// let's value, a callee.
+  const Code* a{nullptr};
+  const Code* b{nullptr};
+  const Code* c{nullptr};
+  /// Statements of a block, or arguments of a call.
+  std::span<const Code* const> list{};
+  /// A literal's value.
+  Value value{};
+  /// The identifier or function literal the code needs at run time.
+  const Node* node{nullptr};
+  /// A variable's slot, cell or capture, or an operator.
+  uint32_t index{0};
+
+  Value operator()(Frame& frame) const { return run(*this, frame); }
+};
+
+/// A program lowered once to a tree of Code, which runs it as eval would.
+///
+/// Lowering and evaluation recurse on the native stack: a program nested
+/// deeper than MAX_NESTING runs to a "nesting too deep" error, and a call
+/// that would take the run past MAX_STACK bytes of it gives a "stack
+/// overflow" error, as the VM's calls do past its frame limit. Calls in
+/// tail position return to the caller's frame, so tail-recursive loops run
+/// in constant space. A tree can only call functions it or another tree
+/// made, and must outlive the calls.
+class Tree {
+public:
+  /// Half the usual main thread's stack.
+  static constexpr size_t MAX_STACK = 4 << 20;
+  /// How deeply nodes may nest, leaving the other half room to lower and
+  /// evaluate them.
+  static constexpr uint32_t MAX_NESTING = 4096;
+
+  /// Lowers `program`, which must have parsed without errors.
+  explicit Tree(const Program& program);
+  Tree(Tree&&)            = default;
+  Tree& operator=(Tree&&) = default;
+
+  /// Runs the program in `env`, which keeps the top-level bindings it makes.
+  Value run(const Env& env) const;
+  /// Runs the program in a fresh environment, unbinding its globals after.
+  Value run() const;
+
+private:
+  std::deque<Code> codes{};
+  std::deque<std::vector<const Code*>> lists{};
+  const Code* root{nullptr};
+  /// Nodes being lowered, the innermost included, and whether any were
+  /// nested too deeply to.
+  uint32_t depth{0};
+  bool too_deep{false};
+
+  const Code& lower(const Node& node);
+  const Code& lower_block(std::span<Statement* const> statements,
+                          Code::Run run);
+  Code& add(Code::Run run);
+};
+
+} // namespace monkey::closure
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monkey::code {
+
+/// Bytecode of one function: an opcode byte followed by its operands,
+/// big-endian.
+using Instructions = std::vector<uint8_t>;
+
+enum class Opcode : uint8_t {
+  CONSTANT,        ///< u16 constant index
+  POP,             ///< discard the top of the stack
+  ADD,             ///< pop b, pop a, push a + b
+  SUB,             ///< a - b
+  MUL,             ///< a * b
+  DIV,             ///< a / b
+  TRUE,            ///< push true
+  FALSE,           ///< push false
+  NULL_,           ///< push null
+  EQUAL,           ///< a == b
+  NOT_EQUAL,       ///< a != b
+  LESS_THAN,       ///< a < b
+  GREATER_THAN,    ///< a > b
+  MINUS,           ///< -a
+  BANG,            ///< !a
+  JUMP,            ///< u16 absolute target
+  JUMP_NOT_TRUTHY, ///< u16 target; pops the condition
+  GET_GLOBAL,      ///< u16 global index
+  SET_GLOBAL,      ///< u16 global index; pops the value
+  GET_LOCAL,       ///< u8 slot in the current frame
+  SET_LOCAL,       ///< u8 slot; pops the value
+  GET_FREE,        ///< u8 index into the current closure's captures
+  CURRENT_CLOSURE, ///< push the closure being executed
+  CLOSURE,         ///< u16 function constant, u8 number of captures
+  CALL,            ///< u8 argument count
+  RETURN_VALUE,    ///< return the top of the stack
+  RETURN,          ///< return null
+};
+
+struct Definition {
+  std::string_view name;
+  /// Bytes per operand.
+  std::array<uint8_t, 2> widths{};
+  uint8_t operands{0};
+};
+
+constexpr Definition lookup(Opcode op) {
+  using O = Opcode;
+  switch (op) {
+  case O::CONSTANT: return {"OpConstant", {2}, 1};
+  case O::POP: return {"OpPop"};
+  case O::ADD: return {"OpAdd"};
+  case O::SUB: return {"OpSub"};
+  case O::MUL: return {"OpMul"};
+  case O::DIV: return {"OpDiv"};
+  case O::TRUE: return {"OpTrue"};
+  case O::FALSE: return {"OpFalse"};
+  case O::NULL_: return {"OpNull"};
+  case O::EQUAL: return {"OpEqual"};
+  case O::NOT_EQUAL: return {"OpNotEqual"};
+  case O::LESS_THAN: return {"OpLessThan"};
+  case O::GREATER_THAN: return {"OpGreaterThan"};
+  case O::MINUS: return {"OpMinus"};
+  case O::BANG: return {"OpBang"};
+  case O::JUMP: return {"OpJump", {2}, 1};
+  case O::JUMP_NOT_TRUTHY: return {"OpJumpNotTruthy", {2}, 1};
+  case O::GET_GLOBAL: return {"OpGetGlobal", {2}, 1};
+  case O::SET_GLOBAL: return {"OpSetGlobal", {2}, 1};
+  case O::GET_LOCAL: return {"OpGetLocal", {1}, 1};
+  case O::SET_LOCAL: return {"OpSetLocal", {1}, 1};
+  case O::GET_FREE: return {"OpGetFree", {1}, 1};
+  case O::CURRENT_CLOSURE: return {"OpCurrentClosure"};
+  case O::CLOSURE: return {"OpClosure", {2, 1}, 2};
+  case O::CALL: return {"OpCall", {1}, 1};
+  case O::RETURN_VALUE: return {"OpReturnValue"};
+  case O::RETURN: return {"OpReturn"};
+  }
+  return {"OpUnknown"};
+}
+
+/// Size in bytes of an `op` instruction including its operands.
+constexpr size_t width(Opcode op) {
+  auto def = lookup(op);
+  return 1 + def.widths[0] + def.widths[1];
+}
+
+static_assert(width(Opcode::CLOSURE) == 4);
+static_assert(width(Opcode::ADD) == 1);
+
+inline uint16_t read_u16(const uint8_t* at) {
+  return static_cast<uint16_t>(at[0] << 8 | at[1]);
+}
+
+/// Encodes one instruction.
+Instructions make(Opcode op, std::initializer_list<int> operands = {});
+
+/// One instruction per line, e.g. "0003 OpConstant 1".
+std::string disassemble(const Instructions& ins);
+
+} // namespace monkey::code
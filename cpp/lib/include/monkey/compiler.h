@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "code.h"
+#include "symbol.h"
+#include "value.h"
+
+namespace monkey {
+
+/// A compiled program: the top-level instructions and the constant pool
+/// they index into.
+struct Bytecode {
+  code::Instructions instructions{};
+  std::vector<Value> constants{};
+  /// Names of the global slots, by index, for reading one before it is set.
+  std::vector<Symbol> globals{};
+};
+
+/// Where a name lives at run time.
+struct Binding {
+  enum class Scope : uint8_t {
+    GLOBAL,   ///< index into the VM's globals
+    LOCAL,    ///< slot in the current frame
+    FREE,     ///< index into the current closure's captures
+    FUNCTION, ///< the closure being executed, for self-recursion
+  };
+  Scope scope;
+  uint16_t index{0};
+};
+
+/// Names bound in one function body, or at the top level when `outer` is
+/// null.
+struct CompileScope {
+  CompileScope* outer{nullptr};
+  std::unordered_map<Symbol, Binding> store{};
+  /// Bindings in enclosing scopes that this function captures, in capture
+  /// order.
+  std::vector<Binding> free{};
+  /// Bindings defined so far. It may pass what a Binding's index can hold,
+  /// and the compiler reports an error when it does.
+  uint32_t definitions{0};
+  /// At the top level, the name of each global, by index.
+  std::vector<Symbol> names{};
+
+  /// Globals a program can bind: as many as a 16-bit operand can index,
+  /// and as many as the VMs have.
+  static constexpr uint32_t MAX_GLOBALS =
+      std::numeric_limits<uint16_t>::max() + 1;
+
+  /// Binds `name` to a new slot, or at the top level to the global slot it
+  /// already has.
+  Binding define(Symbol name);
+  Binding define_function_name(Symbol name);
+  /// Resolves `name`, turning locals of enclosing functions into captures.
+  std::optional<Binding> resolve(Symbol name);
+};
+
+/// Lowers the AST to stack-machine bytecode for the VM. One compiler can
+/// compile several programs in turn, as the REPL does; later ones see the
+/// globals and constants of earlier ones.
+///
+/// Every top-level let is declared before the program is compiled, so
+/// functions can use globals bound after them, and reading one before it is
+/// set is an "identifier not found" error at run time. Locals are resolved
+/// where they are compiled, so a function can only use the locals of
+/// enclosing functions bound before it; eval and the closure tree, which
+/// look names up as the code runs, also see later ones.
+struct Compiler {
+  /// How deeply nodes may nest. Compiling recurses on the native stack, and
+  /// deeper programs give a "nesting too deep" error instead.
+  static constexpr size_t MAX_NESTING = 4096;
+
+  std::vector<std::string> errors{};
+
+  Compiler();
+  Bytecode compile(const Program& program);
+
+private:
+  /// A function being compiled; the first unit is the top level.
+  struct Unit {
+    code::Instructions instructions{};
+    /// Null at the top level, which binds in `globals`.
+    std::unique_ptr<CompileScope> names{};
+    /// Position and opcode of the last emitted instruction.
+    size_t last{0};
+    std::optional<code::Opcode> last_op{};
+  };
+
+  CompileScope globals{};
+  std::vector<Value> constants{};
+  std::vector<Unit> units{};
+  /// Nodes being compiled, the innermost included.
+  size_t depth{0};
+
+  void compile(const Node& node);
+  void compile_block(std::span<Statement* const> statements);
+  void compile_function(const FunctionLiteral& fn, Symbol name);
+  void load(Binding binding);
+  /// Ends the unit: turns a trailing POP into RETURN_VALUE, so the last
+  /// expression statement's value is returned, and otherwise emits RETURN
+  /// unless the unit already ends in RETURN_VALUE.
+  void return_last();
+
+  size_t emit(code::Opcode op, std::initializer_list<int> operands = {});
+  size_t add_constant(Value value);
+  bool last_is(code::Opcode op) const;
+  void remove_last();
+  void patch(size_t at, int operand);
+
+  Unit& unit();
+  CompileScope& names();
+  void enter_scope();
+  Unit leave_scope();
+};
+
+} // namespace monkey
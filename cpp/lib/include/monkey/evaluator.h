@@ -1,9 +1,56 @@
 #pragma once
 #include "ast.h"
+#include "flat_ast.h"
 #include "object.h"
+#include "value.h"
 
 namespace monkey {
 
-std::unique_ptr<object::Object> eval(const Node& node);
+namespace jit {
+struct Jit;
+}
+
+using Env = std::shared_ptr<object::Environment>;
+
+/// Evaluates `node` in `env`, which keeps the top-level bindings it makes.
+/// Nesting and recursion are kept on heap-allocated stacks, so their depth
+/// is limited by memory rather than the native stack. Given a `jit`, calls
+/// it takes on run as native code. The functions it makes share `env`.
+Value eval(const Node& node, const Env& env, jit::Jit* jit = nullptr);
+/// Evaluates `node` in a fresh environment, whose globals are unbound once
+/// it returns, so a function it gives finds none when called.
+Value eval(const Node& node);
+/// Evaluates a lowered program by walking its node array, in a fresh
+/// environment. Calls recurse on the native stack, so they nest at most
+/// 1024 deep; the functions it gives point into `ast`.
+Value eval(const FlatAst& ast);
 
+/// Operator semantics, shared with the VM so every engine computes the same
+/// results and reports the same errors.
+Value eval_prefix(Token::Type op, const Value& right);
+Value eval_infix(Token::Type op, const Value& left, const Value& right);
+
+/// Integer arithmetic as every engine does it: wrapping around in two's
+/// complement on overflow instead of the undefined behavior of int64_t, so
+/// the smallest integer divided by -1 is itself rather than a trap. The
+/// divisor must not be zero.
+inline int64_t wrapping_add(int64_t l, int64_t r) {
+  return static_cast<int64_t>(static_cast<uint64_t>(l)
+                              + static_cast<uint64_t>(r));
+}
+inline int64_t wrapping_subtract(int64_t l, int64_t r) {
+  return static_cast<int64_t>(static_cast<uint64_t>(l)
+                              - static_cast<uint64_t>(r));
 }
+inline int64_t wrapping_multiply(int64_t l, int64_t r) {
+  return static_cast<int64_t>(static_cast<uint64_t>(l)
+                              * static_cast<uint64_t>(r));
+}
+inline int64_t wrapping_negate(int64_t value) {
+  return static_cast<int64_t>(0 - static_cast<uint64_t>(value));
+}
+inline int64_t wrapping_divide(int64_t l, int64_t r) {
+  return r == -1 ? wrapping_negate(l) : l / r;
+}
+
+} // namespace monkey
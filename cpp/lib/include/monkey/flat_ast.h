@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "ast.h"
+#include "token.h"
+
+namespace monkey {
+
+/// The same tree as a Program, stored as one array of fixed-size records
+/// that refer to each other by 32-bit index. Lists of children (statements,
+/// parameters, arguments) are runs in `lists`; integer values live in
+/// `ints`, and what resolve() worked out for functions in `functions`.
+/// Nodes are appended children first, so walking the array in order is a
+/// post-order traversal.
+struct FlatAst {
+  using Ref = uint32_t;
+  /// A missing child, e.g. an if without else or an expression that failed
+  /// to parse.
+  static constexpr Ref NONE = UINT32_MAX;
+
+  enum class Kind : uint8_t {
+    LET,        ///< a: name IDENT node, b: value
+    RETURN,     ///< a: value
+    EXPRESSION, ///< a: expression
+    BLOCK,      ///< a, b: statements list
+    IDENT,      ///< a: symbol, b: Identifier::Scope, c: index
+    INT,        ///< a: index into ints
+    BOOL,       ///< a: 0 or 1
+    PREFIX,     ///< op, a: right
+    INFIX,      ///< op, a: left, b: right
+    IF,         ///< a: condition, b: consequence, c: alternative or NONE
+    FUNCTION,   ///< a, b: parameter list of IDENT nodes, c: functions index
+    CALL,       ///< a: function, b, c: argument list
+  };
+
+  struct Node {
+    Kind kind;
+    /// Operator of PREFIX and INFIX nodes.
+    Token::Type op{Token::Type::ILLEGAL};
+    Ref a{NONE};
+    Ref b{NONE};
+    Ref c{NONE};
+  };
+  static_assert(sizeof(Node) == 16);
+
+  std::vector<Node> nodes{};
+  /// Child runs referenced as (start, count) by BLOCK, FUNCTION and CALL.
+  std::vector<Ref> lists{};
+  std::vector<int64_t> ints{};
+
+  /// A FUNCTION's body, and the slots, cells and captures resolve() laid
+  /// out for its calls.
+  struct Function {
+    Ref body;
+    uint32_t slots;
+    uint32_t cells;
+    /// A run of `captures`.
+    Ref captures;
+    Ref captures_count;
+  };
+  std::vector<Function> functions{};
+  std::vector<Capture> captures{};
+  /// The top-level statements; a BLOCK node.
+  Ref root{NONE};
+
+  /// Lowers `program`, which must have been resolved, into a flat tree.
+  explicit FlatAst(const Program& program);
+
+  const Node& operator[](Ref ref) const;
+  std::span<const Ref> list(Ref start, Ref count) const;
+
+  /// Bytes reserved by the arrays.
+  size_t memory() const;
+
+  /// Prints the same text as printing the Program it was lowered from.
+  friend std::ostream& operator<<(std::ostream& out, const FlatAst& ast);
+  /// Prints `ref` as the node it was lowered from prints.
+  void print(std::ostream& out, Ref ref) const;
+
+private:
+  Ref lower(const monkey::Node* node);
+  Ref lower_block(std::span<Statement* const> statements);
+  Ref push(Node node);
+};
+
+} // namespace monkey
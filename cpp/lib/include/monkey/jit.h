@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "object.h"
+#include "value.h"
+
+namespace monkey::jit {
+
+/// Whether this build can run native code: x86-64 Linux only. Elsewhere a
+/// Jit compiles nothing and every call is interpreted.
+bool available();
+
+struct State;
+struct CallSite;
+
+/// Compiles hot functions the evaluator calls to x86-64, a template of
+/// machine code per node stitched together in one pass.
+///
+/// Only functions over integers are compiled: parameters and lets outside
+/// nested blocks, integer and boolean literals, arithmetic, comparisons,
+/// if/else, returns, and calls of global functions that are themselves
+/// compilable. Anything else, such as closures or a call with an argument
+/// that is not an integer, stays with the interpreter. So does any call the
+/// code bails out of, on division by zero or recursion deeper than
+/// MAX_DEPTH: the functions have no side effects, so the interpreter runs
+/// the call again from the start and reports what went wrong.
+struct Jit {
+  /// Calls from the interpreter before a function is compiled.
+  static constexpr uint32_t HOT_CALLS = 8;
+  /// Native calls deep compiled code may go before it bails out.
+  static constexpr uint32_t MAX_DEPTH = 10000;
+
+  /// Entry point of a compiled function: its arguments in order, and the
+  /// state of the call from the interpreter.
+  using Code = int64_t (*)(const int64_t* args, State* state);
+
+  Jit();
+  ~Jit();
+  Jit(const Jit&)            = delete;
+  Jit& operator=(const Jit&) = delete;
+
+  /// Calls `fn` natively if it is hot and compiles, leaving its value in
+  /// `result`. False if the interpreter should make the call instead.
+  bool call(const object::Function& fn,
+            std::span<const Value> args,
+            Value& result);
+  /// Functions compiled so far.
+  size_t compiled() const { return pages.size(); }
+
+  /// `literal`'s code, compiling it if it has none yet; null if it can't
+  /// be compiled or was given up on.
+  Code code(const FunctionLiteral& literal);
+
+private:
+  struct Entry {
+    enum class Status : uint8_t { COLD, COMPILED, UNSUPPORTED, DISABLED };
+    Status status{Status::COLD};
+    uint32_t calls{0};
+    Code code{nullptr};
+  };
+
+  /// Executable mappings, one per compiled function, with their sizes.
+  struct Pages {
+    void* address;
+    size_t size;
+  };
+
+  std::unordered_map<const FunctionLiteral*, Entry> entries{};
+  std::vector<Pages> pages{};
+  /// The calls of global functions compiled code makes; their addresses
+  /// are embedded in it.
+  std::vector<std::unique_ptr<CallSite>> sites{};
+
+  Code compile(const FunctionLiteral& literal);
+};
+
+} // namespace monkey::jit
@@ -1,27 +1,44 @@
 #pragma once
 
-#include <optional>
-#include <sstream>
+#include <istream>
 #include <string>
-#include <vector>
+#include <string_view>
 
 #include "token.h"
 
 namespace monkey {
 
+bool is_letter(const char& ch);
+bool is_digit(const char& ch);
+
 struct Lexer {
+  /// Reads the whole stream into a buffer owned by the lexer.
   explicit Lexer(std::istream& in);
+  /// Takes ownership of the source.
+  explicit Lexer(std::string&& in);
+  /// Copies the source, so a string is only ever borrowed through an
+  /// explicit string_view.
   explicit Lexer(const std::string& in);
+  /// Lexes in place; `in` must outlive the lexer and every token view it
+  /// hands out.
+  explicit Lexer(std::string_view in);
+  explicit Lexer(const char* in);
   ~Lexer();
   Lexer(Lexer&&) noexcept;
 
   Token next_token();
+  /// Like next_token(), but the literal is a view into source(), so no
+  /// allocation happens.
+  TokenView next_view();
+
+  std::string_view source() const;
 
 private:
-  std::istringstream in_str;
-  std::istream& in{in_str};
-  std::vector<char> literal{};
+  std::string owned{};
+  std::string_view src{};
+  size_t pos{0};
 
+  const char* end() const;
   void skip_whitespace();
 };
 
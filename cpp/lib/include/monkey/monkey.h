@@ -1,3 +1,4 @@
 #pragma once
 
-#include "repl.h"
\ No newline at end of file
+#include "repl.h"
+#include "source.h"
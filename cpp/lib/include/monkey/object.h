@@ -1,43 +1,130 @@
 #pragma once
+#include <memory>
 #include <ostream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-namespace monkey::object {
-
-typedef std::string Type;
+#include "ast.h"
+#include "code.h"
+#include "symbol.h"
+#include "value.h"
 
-namespace types {
-  const Type NULL_   = "NULL";
-  const Type INTEGER = "INTEGER";
-  const Type BOOLEAN = "BOOLEAN";
-} // namespace types
+namespace monkey::object {
 
+/// Base of everything a Value keeps on the heap. Values share objects and
+/// count their references; the last one to let go deletes it.
 struct Object {
+  uint32_t refs{0};
+
   virtual ~Object()                   = default;
-  virtual const Type& type()          = 0;
   virtual std::string inspect() const = 0;
+};
+
+struct Function;
+
+/// A variable shared by the call that binds it and the closures that
+/// capture it.
+using Cell = std::shared_ptr<Value>;
+
+/// The variables of one function call, or the globals.
+struct Environment {
+  /// Parameters and lets, at the slots and cells resolve() gave them.
+  std::vector<Value> slots;
+  std::vector<Cell> cells{};
+  /// The function being called, whose captures the body reads; null for
+  /// the globals.
+  const Function* function{nullptr};
+
+  /// A root, for globals.
+  Environment() = default;
+  /// A call of `function`.
+  explicit Environment(const Function& function);
+  /// A root points at itself, so environments stay where they are made.
+  Environment(const Environment&)            = delete;
+  Environment& operator=(const Environment&) = delete;
+
+  /// The global `name`, or null if it is unbound.
+  const Value* global(Symbol name) const;
+  void set_global(Symbol name, Value value);
+  /// Unbinds every global. Functions keep the environment they were made
+  /// in alive, so one bound to a global is a cycle until this breaks it.
+  void clear_globals();
 
-  friend std::ostream& operator<<(std::ostream& out, const Object&);
+private:
+  /// Globals, by Symbol id, and which of them are bound. Only the root's
+  /// are used.
+  Environment* root{this};
+  std::vector<bool> bound{};
 };
 
-struct Integer : Object {
-  int value;
+/// A function literal closed over the free variables its body uses. The
+/// literal lives in its Program's arena, which must outlive calls of the
+/// function; `globals`, the environment the program runs in, is shared.
+struct Function : Object {
+  const FunctionLiteral& literal;
+  /// In the order of `literal.captures`.
+  std::vector<Cell> captures;
+  std::shared_ptr<Environment> globals;
 
-  explicit Integer(int value);
-  const Type& type() override;
+  Function(const FunctionLiteral& literal,
+           std::vector<Cell> captures,
+           std::shared_ptr<Environment> globals);
   std::string inspect() const override;
 };
 
-struct Boolean : Object {
-  bool value;
+/// A function body compiled to bytecode, as stored in a constant pool.
+struct CompiledFunction : Object {
+  code::Instructions instructions;
+  /// Stack slots the body needs, parameters included.
+  size_t locals;
+  size_t parameters;
+  /// The literal as printed, so values print the same under every engine.
+  std::string source;
 
-  explicit Boolean(bool value);
-  const Type& type() override;
+  CompiledFunction(code::Instructions instructions,
+                   size_t locals,
+                   size_t parameters,
+                   std::string source);
   std::string inspect() const override;
 };
 
-struct Null : Object {
-  const Type& type() override;
+/// A compiled function plus the values of the free variables it captured.
+/// `function` is a CompiledFunction, or a reg::Prototype under the register
+/// VM.
+struct Closure : Object {
+  Value function;
+  std::vector<Value> free;
+
+  Closure(Value function, std::vector<Value> free);
+  /// The stack VM's function.
+  const CompiledFunction& compiled() const;
+  std::string inspect() const override;
+};
+
+/// A function literal transpiled to C++, closed over the cells it captures.
+struct NativeFunction : Object {
+  /// Runs the body with the arguments, as many as `parameters`.
+  using Code = Value (*)(const NativeFunction& self, Value* args);
+
+  Code code;
+  size_t parameters;
+  /// The literal as printed, so values print as they do under eval.
+  const char* source;
+  /// In the order of the literal's captures.
+  std::vector<Cell> captures;
+
+  NativeFunction(Code code,
+                 size_t parameters,
+                 const char* source,
+                 std::vector<Cell> captures);
+  std::string inspect() const override;
+};
+
+struct Error : Object {
+  std::string message;
+
+  explicit Error(std::string message);
   std::string inspect() const override;
 };
 
@@ -1,26 +1,41 @@
 #pragma once
 
-#include <unordered_map>
+#include <array>
 
 #include "ast.h"
+#include "flat_ast.h"
 #include "lexer.h"
 #include "token.h"
+#include "token_stream.h"
 
 namespace monkey {
 
+/// 1-based line and column of a byte in a source.
+struct Position {
+  uint32_t line{1};
+  uint32_t column{1};
+};
+
 struct Parser {
-  Lexer& lexer;
-  Token cur_token;
-  Token peek_token;
   std::vector<std::string> errors{};
 
+  /// Tokenizes everything `lexer` has left; the lexer's source must outlive
+  /// the parser.
   explicit Parser(Lexer& lexer);
+  /// `origin` is where the stream's source starts within the whole document,
+  /// so errors point at the right place when parsing a piece of it.
+  explicit Parser(const TokenStream& tokens, Position origin = {});
   Program parse_program();
+  /// Parses into the compact index-based representation instead; the tree
+  /// is freed as soon as it is lowered.
+  FlatAst parse_flat_program();
 
 private:
-  using ExpressionPtr = std::unique_ptr<Expression>;
-  using PrefixParseFn = std::function<ExpressionPtr()>;
-  using InfixParseFn  = std::function<ExpressionPtr(ExpressionPtr&&)>;
+  /// Parse functions build the node for the construct at the current token.
+  /// One with nothing nested returns it; otherwise it pushes the tasks that
+  /// will parse what is nested and finish the node, and returns null.
+  using PrefixParseFn = Expression* (Parser::*)();
+  using InfixParseFn  = Expression* (Parser::*)(Expression*);
   enum class Precedence {
     LOWEST,
     EQUALS,      ///< ==
@@ -31,38 +46,109 @@ private:
     CALL,        ///< myFunction(X)
   };
 
-  std::unordered_map<Token::Type, PrefixParseFn> prefix_parse_fns{};
-  std::unordered_map<Token::Type, InfixParseFn> infix_parse_fns{};
+  /// A step of parsing kept on `tasks` rather than the native stack, so
+  /// input may nest as deeply as memory allows. The first three start a
+  /// construct at the current token; the rest finish `node` with `result`,
+  /// the construct parsed last.
+  struct Task {
+    enum class Kind : uint8_t {
+      STATEMENT,
+      EXPRESSION,
+      BLOCK,
+      LET_VALUE,
+      RETURN_VALUE,
+      EXPRESSION_VALUE,
+      BLOCK_STATEMENT,
+      /// The loop taking infix operators that bind tighter than `precedence`.
+      OPERAND,
+      PREFIX_RIGHT,
+      INFIX_RIGHT,
+      GROUP,
+      IF_CONDITION,
+      IF_CONSEQUENCE,
+      IF_ALTERNATIVE,
+      FUNCTION_BODY,
+      CALL_ARGUMENT,
+    };
+    Kind kind;
+    Precedence precedence{Precedence::LOWEST};
+    Node* node{nullptr};
+    /// Where the node's statements or arguments start in `items`.
+    size_t items{0};
+  };
+
+  std::unique_ptr<TokenStream> owned_tokens{};
+  const TokenStream& tokens;
+  Position origin;
+  size_t pos{0};
+  /// The arena of the program being parsed.
+  Arena* arena{nullptr};
+  std::vector<Task> tasks{};
+  /// Statements and arguments parsed so far for unfinished lists.
+  std::vector<Node*> items{};
+  Node* result{nullptr};
 
-  std::unique_ptr<Statement> parse_statement();
-  std::unique_ptr<LetStatement> parse_let_statement();
-  std::unique_ptr<ReturnStatement> parse_return_statement();
-  std::unique_ptr<ExpressionStatement> parse_expression_statement();
-  std::unique_ptr<Expression> parse_expression(Precedence precedence);
-  std::unique_ptr<IntegerLiteral> parse_integer_literal();
-  ExpressionPtr parse_identifier();
-  ExpressionPtr parse_prefix_expression();
-  ExpressionPtr parse_infix_expression(ExpressionPtr&& left);
-  ExpressionPtr parse_boolean();
-  ExpressionPtr parse_grouped_expression();
-  ExpressionPtr parse_if_expression();
-  ExpressionPtr parse_function_literal();
-  ExpressionPtr parse_call_expression(ExpressionPtr func);
-  std::unique_ptr<BlockStatement> parse_block_statement();
-  std::vector<Identifier> parse_function_parameters();
-  std::vector<ExpressionPtr> parse_call_arguments();
+  /// How a token type parses in prefix and infix position, and how tightly
+  /// it binds as an infix operator.
+  struct ParseRule {
+    PrefixParseFn prefix{nullptr};
+    InfixParseFn infix{nullptr};
+    Precedence precedence{Precedence::LOWEST};
+  };
+  using Rules = std::array<ParseRule, Token::TYPE_COUNT>;
+  /// Indexed by Token::Type; built at compile time.
+  static const Rules rules;
+  static const ParseRule& rule(Token::Type type);
+
+  /// Runs tasks, starting with `first`, until none are left; returns the
+  /// construct `first` parsed.
+  Node* run(Task first);
+  void step(const Task& task);
+  Statement* parse_statement();
+  void parse_let_statement();
+  void parse_return_statement();
+  void parse_expression_statement();
+  void parse_expression(Precedence precedence);
+  void parse_operand(Precedence precedence);
+  Expression* parse_integer_literal();
+  Expression* parse_identifier();
+  Expression* parse_prefix_expression();
+  Expression* parse_infix_expression(Expression* left);
+  Expression* parse_boolean();
+  Expression* parse_grouped_expression();
+  Expression* parse_if_expression();
+  Expression* parse_function_literal();
+  Expression* parse_call_expression(Expression* func);
+  void parse_block_statement();
+  void parse_block_rest(BlockStatement& block, size_t start);
+  void parse_call_argument(CallExpression& call, size_t start);
+  std::span<Identifier> parse_function_parameters();
+  /// Moves `items` from `start` on into the arena.
+  template <class T>
+  std::span<T*> take_items(size_t start);
 
   void next_token();
+  /// The current token, its literal copied into the arena.
+  TokenView cur_token();
+  Token::Type peek_type() const;
   bool cur_token_is(Token::Type type) const;
   bool peek_token_is(Token::Type type) const;
   bool expect_peek(Token::Type type);
+  Position position(size_t token) const;
+  void error(size_t token, std::string message);
   void peek_error(Token::Type type);
   void no_prefix_parse_fn_error(Token::Type type);
 
-  static std::unordered_map<Token::Type, Precedence> precedences;
-
   Precedence peek_precedence();
   Precedence cur_precedence();
 };
 
+/// Parses `source` by cutting it at top-level semicolons into chunks that are
+/// lexed and parsed on `threads` workers (0: one per hardware thread). The
+/// statements and errors come back in source order, as parse_program() would
+/// produce them.
+Program parse_program_parallel(std::string_view source,
+                               std::vector<std::string>& errors,
+                               unsigned threads = 0);
+
 } // namespace monkey
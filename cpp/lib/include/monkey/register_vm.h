@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "compiler.h"
+#include "object.h"
+#include "value.h"
+
+/// A register machine alongside the stack VM. Each frame owns a window of
+/// registers: parameters first, then one register per let in the body, then
+/// temporaries. Operators read their operands straight out of those
+/// registers, so `a + b` on two locals is one instruction instead of three.
+namespace monkey::reg {
+
+enum class Opcode : uint8_t {
+  LOAD_CONSTANT,   ///< r[a] = constants[bx]
+  LOAD_NULL,       ///< r[a] = null
+  LOAD_TRUE,       ///< r[a] = true
+  LOAD_FALSE,      ///< r[a] = false
+  MOVE,            ///< r[a] = r[b]
+  GET_GLOBAL,      ///< r[a] = globals[bx]
+  SET_GLOBAL,      ///< globals[bx] = r[a]
+  GET_FREE,        ///< r[a] = the current closure's capture b
+  CURRENT_CLOSURE, ///< r[a] = the closure being executed
+  ADD,             ///< r[a] = r[b] + r[c]
+  SUB,             ///< r[a] = r[b] - r[c]
+  MUL,             ///< r[a] = r[b] * r[c]
+  DIV,             ///< r[a] = r[b] / r[c]
+  EQUAL,           ///< r[a] = r[b] == r[c]
+  NOT_EQUAL,       ///< r[a] = r[b] != r[c]
+  LESS_THAN,       ///< r[a] = r[b] < r[c]
+  GREATER_THAN,    ///< r[a] = r[b] > r[c]
+  MINUS,           ///< r[a] = -r[b]
+  BANG,            ///< r[a] = !r[b]
+  JUMP,            ///< continue at instruction bx
+  JUMP_NOT_TRUTHY, ///< continue at instruction bx unless r[a] is truthy
+  CLOSURE,         ///< r[a] = a closure of the Prototype constants[bx]
+  CALL,            ///< r[a] = r[b](r[b + 1], ..., r[b + c])
+  RETURN,          ///< return r[a]
+};
+
+/// One fixed-width instruction. A 16-bit operand `bx` takes the place of
+/// `b` and `c`.
+struct Instruction {
+  Opcode op;
+  uint8_t a{0};
+  uint8_t b{0};
+  uint8_t c{0};
+
+  uint16_t bx() const { return static_cast<uint16_t>(b << 8 | c); }
+};
+
+static_assert(sizeof(Instruction) == 4);
+
+/// A compiled function body, stored in the constant pool.
+struct Prototype : object::Object {
+  std::vector<Instruction> code{};
+  uint8_t parameters{0};
+  /// Size of the register window a call needs.
+  size_t registers{0};
+  /// Where each free variable comes from in the enclosing frame when a
+  /// closure is made.
+  std::vector<Binding> captures{};
+  std::string source{};
+
+  std::string inspect() const override;
+};
+
+/// One instruction per line, e.g. "0002 OpAdd 2 0 1".
+std::string disassemble(const std::vector<Instruction>& code);
+
+/// A compiled program: the top level as a Prototype and the constants its
+/// functions share.
+struct Bytecode {
+  Value main{};
+  std::vector<Value> constants{};
+  /// Names of the global slots, by index, for reading one before it is set.
+  std::vector<Symbol> globals{};
+
+  const Prototype& prototype() const { return main.as<Prototype>(); }
+};
+
+/// Lowers the AST to register bytecode. Like the stack compiler, it can
+/// compile several programs in turn and later ones see earlier globals, and
+/// it declares every top-level let before compiling.
+struct Compiler {
+  /// How deeply expressions may nest. Compiling recurses on the native
+  /// stack, and deeper programs give a "nesting too deep" error instead.
+  static constexpr size_t MAX_NESTING = 4096;
+
+  std::vector<std::string> errors{};
+
+  Compiler();
+  Bytecode compile(const Program& program);
+
+private:
+  /// A function being compiled; the first unit is the top level.
+  struct Unit {
+    std::vector<Instruction> code{};
+    /// Null at the top level, which binds in `globals`.
+    std::unique_ptr<CompileScope> names{};
+    /// The lowest free temporary, and the most registers in use at once.
+    size_t top{0};
+    size_t registers{0};
+  };
+
+  CompileScope globals{};
+  std::vector<Value> constants{};
+  std::vector<Unit> units{};
+  /// Expressions being compiled, the innermost included.
+  size_t depth{0};
+
+  void block(std::span<Statement* const> statements, uint8_t target);
+  void statement(const Statement& stmt, uint8_t target);
+  /// Compiles `e` and returns the register holding its value: `target`, or
+  /// the register of the local `e` names.
+  uint8_t expression(const Expression& e, uint8_t target);
+  void expression_into(const Expression& e, uint8_t target);
+  /// Compiles `e` into a fresh temporary unless it names a local.
+  uint8_t operand(const Expression& e);
+  void function(const FunctionLiteral& fn, Symbol name, uint8_t target);
+
+  size_t emit(Opcode op, int a = 0, int b = 0, int c = 0);
+  size_t emit_bx(Opcode op, int a, int bx);
+  void patch(size_t at, size_t target);
+  uint16_t add_constant(Value value);
+  uint8_t temp();
+
+  Unit& unit();
+  CompileScope& names();
+};
+
+/// Runs register bytecode. Globals persist across runs.
+struct VM {
+  static constexpr size_t STACK_SIZE   = 1 << 16;
+  static constexpr size_t MAX_FRAMES   = 1024;
+  static constexpr size_t GLOBALS_SIZE = 65536;
+
+  /// Instructions executed by the last run.
+  size_t dispatched{0};
+
+  VM();
+  Value run(const Bytecode& bytecode);
+
+private:
+  /// A suspended caller. The callee sits just below the callee's `base`.
+  struct Frame {
+    const object::Closure* closure;
+    const Instruction* code;
+    const Instruction* ip;
+    Value* base;
+    /// The caller's register that receives the result.
+    Value* result;
+  };
+
+  std::vector<Value> stack;
+  std::vector<Value> globals;
+  /// Which globals have been set; the others are null.
+  std::vector<bool> bound;
+  std::vector<Frame> frames{};
+};
+
+} // namespace monkey::reg
@@ -1,9 +1,21 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 namespace monkey::repl {
 
-void start(std::istream& in, std::ostream& out);
+/// What runs the programs the REPL reads.
+enum class Engine {
+  EVAL,        ///< the tree-walking evaluator
+  VM,          ///< the bytecode compiler and stack virtual machine
+  REGISTER_VM, ///< the register bytecode compiler and virtual machine
+  CLOSURES,    ///< the tree lowered to closures, see closure::Tree
+};
+
+void start(std::istream& in, std::ostream& out, Engine engine = Engine::EVAL);
+void print_parser_errors(std::ostream& out,
+                         const std::vector<std::string>& errors);
 
 } // namespace monkey::repl
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ast.h"
+
+namespace monkey {
+
+/// Gives every variable in `program` a lexical address, so the evaluator
+/// reads and writes environments by index instead of looking names up.
+///
+/// Each function's parameters and lets get one variable per distinct name.
+/// Within a function's own body a name refers to its local binding only
+/// after the let that makes it, as it would when evaluated in order. From
+/// a nested function, any let in an enclosing function counts, since the
+/// nested function usually runs after those lets have. Names bound by no
+/// function are globals.
+///
+/// A variable that no nested function uses gets a plain slot. One that is
+/// used gets a cell, and every function between its binding and the use
+/// lists it among its captures, so a closure copies just the cells it needs
+/// rather than keeping the calls it was made in alive.
+///
+/// Calls whose value is their function's, from a return or as the last
+/// statement of the body or of a branch that is, are marked as tail calls.
+///
+/// Expressions of operators over identifiers and literals alone get their
+/// operator depth, so the evaluator can tell which it can finish in one go.
+void resolve(Program& program);
+
+} // namespace monkey
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "evaluator.h"
+#include "object.h"
+#include "token.h"
+#include "value.h"
+
+/// What the C++ that transpile() emits runs on. Values and operators are the
+/// evaluator's, so a transpiled program computes what eval would; only the
+/// common integer cases are inlined here.
+namespace monkey::runtime {
+
+using object::Cell;
+using object::NativeFunction;
+
+/// A top-level binding, which functions look up when they run.
+struct Global {
+  const char* name;
+  Value value{};
+  bool bound{false};
+};
+
+/// The error reading `global` gives before it is bound.
+Value unbound(const Global& global);
+
+/// The value of `global`, or an error if it is not bound yet.
+inline Value get(const Global& global) {
+  if (global.bound) return global.value;
+  return unbound(global);
+}
+
+inline void set(Global& global, Value value) {
+  global.value = std::move(value);
+  global.bound = true;
+}
+
+inline Cell cell() {
+  return std::make_shared<Value>();
+}
+
+Value function(NativeFunction::Code code,
+               size_t parameters,
+               const char* source,
+               std::vector<Cell> captures);
+
+/// Calls `callee` with `count` arguments, or reports why it can't be.
+Value call(const Value& callee, Value* args, size_t count);
+
+/// Whether `callee` is `self`, taking `count` arguments, so a tail call of
+/// it can restart the current call instead.
+inline bool is_self(const Value& callee,
+                    const NativeFunction& self,
+                    size_t count) {
+  return callee.type() == Value::Type::NATIVE
+         && &callee.as<NativeFunction>() == &self
+         && self.parameters == count;
+}
+
+template <Token::Type op>
+Value prefix(const Value& right) {
+  if constexpr (op == Token::Type::MINUS) {
+    if (right.type() == Value::Type::INTEGER) {
+      return Value::integer(wrapping_negate(right.as_integer()));
+    }
+  } else if constexpr (op == Token::Type::BANG) {
+    if (!right.is_error()) return Value::boolean(!right.truthy());
+  }
+  return eval_prefix(op, right);
+}
+
+template <Token::Type op>
+Value infix(const Value& left, const Value& right) {
+  using Type = Value::Type;
+  if (left.type() == Type::INTEGER && right.type() == Type::INTEGER) {
+    auto l = left.as_integer();
+    auto r = right.as_integer();
+    if constexpr (op == Token::Type::PLUS) {
+      return Value::integer(wrapping_add(l, r));
+    }
+    if constexpr (op == Token::Type::MINUS) {
+      return Value::integer(wrapping_subtract(l, r));
+    }
+    if constexpr (op == Token::Type::ASTERISK) {
+      return Value::integer(wrapping_multiply(l, r));
+    }
+    if constexpr (op == Token::Type::SLASH) {
+      if (r != 0) return Value::integer(wrapping_divide(l, r));
+    }
+    if constexpr (op == Token::Type::LT) return Value::boolean(l < r);
+    if constexpr (op == Token::Type::GT) return Value::boolean(l > r);
+    if constexpr (op == Token::Type::EQ) return Value::boolean(l == r);
+    if constexpr (op == Token::Type::NOT_EQ) return Value::boolean(l != r);
+  }
+  return eval_infix(op, left, right);
+}
+
+/// Runs `program` on a thread with a stack deep enough for recursion that
+/// eval would manage, and prints its value as `monkey run` does. Returns
+/// the process exit code.
+int main(Value (*program)());
+
+} // namespace monkey::runtime
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace monkey::scan {
+
+// Each scanner returns the first position in [p, end) whose byte is not in
+// the scanned class, or `end`. With SSE2 (or AVX2 when the compiler targets
+// it) 16 (32) bytes are classified per step; the last partial block and
+// other targets use the scalar versions.
+
+const char* skip_whitespace(const char* p, const char* end);
+const char* skip_letters(const char* p, const char* end);
+const char* skip_digits(const char* p, const char* end);
+
+namespace scalar {
+  const char* skip_whitespace(const char* p, const char* end);
+  const char* skip_letters(const char* p, const char* end);
+  const char* skip_digits(const char* p, const char* end);
+} // namespace scalar
+
+} // namespace monkey::scan
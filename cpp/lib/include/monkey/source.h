@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace monkey {
+
+/// A script mapped read-only into memory. Pages are only faulted in as the
+/// lexer touches them, so opening a file costs the same at any size.
+struct MappedFile {
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+  MappedFile(MappedFile&&) noexcept;
+  MappedFile& operator=(MappedFile&&) noexcept;
+
+  std::string_view view() const;
+
+private:
+  const char* data{nullptr};
+  size_t size{0};
+};
+
+} // namespace monkey
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "token.h"
+
+namespace monkey {
+
+/// A push-style lexer for input that arrives in pieces, e.g. from a pipe or
+/// a socket. Chunks may split a token anywhere: a token that touches the end
+/// of the input so far and could still grow ("le", "12", "=") is held back
+/// until the next chunk or close() settles it. Only that unfinished tail is
+/// buffered, never the whole input.
+struct StreamLexer {
+  void push(std::string_view chunk);
+  /// Marks the end of input, flushing any held-back token followed by EOF.
+  void close();
+  /// The next complete token, if one is ready.
+  std::optional<Token> poll();
+
+private:
+  std::string pending{};
+  std::deque<Token> ready{};
+  bool closed{false};
+
+  void drain();
+};
+
+} // namespace monkey
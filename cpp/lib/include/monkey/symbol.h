@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string_view>
+
+namespace monkey {
+
+/// An interned identifier. Every distinct name maps to one small id for the
+/// life of the process, so comparing or hashing names is an integer
+/// operation. The default Symbol is the empty name. Interning may take a
+/// lock, but reading a name never does.
+struct Symbol {
+  uint32_t id{0};
+
+  static Symbol intern(std::string_view name);
+  std::string_view name() const;
+
+  bool operator==(const Symbol&) const = default;
+  friend bool operator==(Symbol symbol, std::string_view name) {
+    return symbol.name() == name;
+  }
+
+  friend std::ostream& operator<<(std::ostream& out, Symbol symbol);
+};
+
+} // namespace monkey
+
+template <>
+struct std::hash<monkey::Symbol> {
+  size_t operator()(monkey::Symbol symbol) const noexcept {
+    return symbol.id;
+  }
+};
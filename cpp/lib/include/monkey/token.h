@@ -1,12 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 using std::ostream;
 
 namespace monkey {
+struct TokenView;
+
 struct Token {
-  enum class Type {
+  enum class Type : uint8_t {
     ILLEGAL, ///< Example: "ILLEGAL"
     EOF_,    ///< Example: "EOF"
 
@@ -45,15 +49,18 @@ struct Token {
     ELSE,     ///< Example: "else"
     RETURN,   ///< Example: "return"
   };
+  /// Number of token types, for tables indexed by Type.
+  static constexpr size_t TYPE_COUNT = static_cast<size_t>(Type::RETURN) + 1;
   friend ostream& operator<<(ostream& os, Type t);
 
   Type type{};
   std::string literal{};
 
-  static Type lookup_ident(const std::string& ident);
+  static constexpr Type lookup_ident(std::string_view ident);
 
   Token();
   Token(Type type, std::string literal);
+  explicit Token(const TokenView& view);
   Token(const Token&);
   Token(Token&&) noexcept;
   Token& operator=(Token&&) noexcept;
@@ -62,4 +69,107 @@ struct Token {
 
   friend ostream& operator<<(ostream& os, const Token& t);
 };
+
+/// A token whose literal borrows from the lexer's source instead of owning a
+/// copy of it.
+struct TokenView {
+  Token::Type type{};
+  std::string_view literal{};
+
+  bool operator==(const TokenView&) const = default;
+
+  friend ostream& operator<<(ostream& os, const TokenView& t);
+};
+
+/// Keywords are told apart by length and first character, so an identifier
+/// costs at most one short compare and never a hash.
+constexpr Token::Type Token::lookup_ident(std::string_view ident) {
+  auto is = [&](std::string_view kw, Type type) {
+    return ident == kw ? type : Type::IDENT;
+  };
+  switch (ident.size()) {
+  case 2:
+    switch (ident[0]) {
+    case 'f': return is("fn", Type::FUNCTION);
+    case 'i': return is("if", Type::IF);
+    }
+    break;
+  case 3:
+    if (ident[0] == 'l') return is("let", Type::LET);
+    break;
+  case 4:
+    switch (ident[0]) {
+    case 't': return is("true", Type::TRUE);
+    case 'e': return is("else", Type::ELSE);
+    }
+    break;
+  case 5:
+    if (ident[0] == 'f') return is("false", Type::FALSE);
+    break;
+  case 6:
+    if (ident[0] == 'r') return is("return", Type::RETURN);
+    break;
+  }
+  return Type::IDENT;
+}
+
+/// Compiles to a table lookup indexed by the enum value.
+constexpr std::string_view type_to_str(Token::Type type) {
+  using T = Token::Type;
+  switch (type) {
+  case T::ILLEGAL: return "ILLEGAL";
+  case T::EOF_: return "EOF";
+  case T::IDENT: return "IDENT";
+  case T::INT: return "INT";
+  case T::ASSIGN: return "ASSIGN";
+  case T::PLUS: return "PLUS";
+  case T::MINUS: return "MINUS";
+  case T::BANG: return "BANG";
+  case T::ASTERISK: return "ASTERISK";
+  case T::SLASH: return "SLASH";
+  case T::LT: return "LT";
+  case T::GT: return "GT";
+  case T::EQ: return "EQ";
+  case T::NOT_EQ: return "NOT_EQ";
+  case T::COMMA: return "COMMA";
+  case T::SEMICOLON: return "SEMICOLON";
+  case T::LPAREN: return "LPAREN";
+  case T::RPAREN: return "RPAREN";
+  case T::LBRACE: return "LBRACE";
+  case T::RBRACE: return "RBRACE";
+  case T::FUNCTION: return "FUNCTION";
+  case T::LET: return "LET";
+  case T::TRUE: return "TRUE";
+  case T::FALSE: return "FALSE";
+  case T::IF: return "IF";
+  case T::ELSE: return "ELSE";
+  case T::RETURN: return "RETURN";
+  }
+  return "ILLEGAL";
+}
+
+/// Source text of an operator token; empty for any other type.
+constexpr std::string_view operator_str(Token::Type type) {
+  using T = Token::Type;
+  switch (type) {
+  case T::PLUS: return "+";
+  case T::MINUS: return "-";
+  case T::BANG: return "!";
+  case T::ASTERISK: return "*";
+  case T::SLASH: return "/";
+  case T::LT: return "<";
+  case T::GT: return ">";
+  case T::EQ: return "==";
+  case T::NOT_EQ: return "!=";
+  default: return "";
+  }
+}
+
+static_assert(type_to_str(Token::Type::EOF_) == "EOF");
+static_assert(type_to_str(Token::Type::NOT_EQ) == "NOT_EQ");
+static_assert(type_to_str(Token::Type::RETURN) == "RETURN");
+static_assert(Token::lookup_ident("fn") == Token::Type::FUNCTION);
+static_assert(Token::lookup_ident("return") == Token::Type::RETURN);
+static_assert(Token::lookup_ident("lets") == Token::Type::IDENT);
+static_assert(Token::lookup_ident("iff") == Token::Type::IDENT);
 } // namespace monkey
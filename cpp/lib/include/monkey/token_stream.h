@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lexer.h"
+#include "token.h"
+
+namespace monkey {
+
+/// A whole source tokenized up front into parallel arrays: one byte of type
+/// plus a 32-bit offset and length into the source per token. The last token
+/// is EOF and indexing past it keeps yielding EOF, so a parser can look
+/// ahead any distance without bounds checks.
+struct TokenStream {
+  std::vector<uint8_t> types{};
+  std::vector<uint32_t> offsets{};
+  std::vector<uint32_t> lengths{};
+
+  /// `source` must outlive the stream.
+  explicit TokenStream(std::string_view source);
+  /// Drains `lexer`; its source must outlive the stream.
+  explicit TokenStream(Lexer& lexer);
+  /// Copies the literals of already lexed tokens, e.g. from a StreamLexer,
+  /// into text owned by the stream. EOF is appended if missing.
+  explicit TokenStream(const std::vector<Token>& tokens);
+
+  size_t size() const;
+  Token::Type type(size_t i) const;
+  std::string_view literal(size_t i) const;
+  TokenView operator[](size_t i) const;
+
+  std::string_view source() const;
+  /// Bytes reserved by the three arrays.
+  size_t memory() const;
+
+private:
+  std::unique_ptr<std::string> text{};
+  std::string_view src;
+
+  void tokenize(Lexer& lexer);
+  void push(const TokenView& token);
+};
+
+} // namespace monkey
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include "ast.h"
+
+namespace monkey {
+
+/// C++ for a program that runs `program`, which must have parsed without
+/// errors, and prints its value as `monkey run` would. The source includes
+/// <monkey/runtime.h> and links against lib.
+///
+/// Each function literal becomes a C++ function with its variables in C++
+/// locals, at the slots and cells resolve() gave them, and expressions are
+/// evaluated into temporaries in the order eval evaluates them, so values
+/// and errors come out the same. A tail call of the function making it
+/// restarts the call in place; other calls recurse on the native stack.
+std::string transpile(const Program& program);
+
+/// Compiles `source`, from transpile(), to the executable `output` with the
+/// C++ compiler lib was built with, or $CXX if it is set. The compiler is run
+/// without a shell, so `output` may hold any character. Returns its exit
+/// status, or -1 if it could not be run.
+int build(const std::string& source, const std::string& output);
+
+} // namespace monkey
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monkey {
+
+struct FunctionLiteral;
+
+namespace object {
+  struct Object;
+  struct Environment;
+} // namespace object
+
+/// What evaluating an expression produces. Sixteen bytes, passed by value:
+/// integers, booleans and null are stored inline so arithmetic never touches
+/// the heap, and only functions and errors point at a reference-counted
+/// object::Object.
+struct Value {
+  enum class Type : uint8_t {
+    NULL_,
+    INTEGER,
+    BOOLEAN,
+    FUNCTION,
+    CLOSURE,           ///< A function compiled for the VM.
+    COMPILED_FUNCTION, ///< Bytecode in a constant pool; never on the stack.
+    NATIVE,            ///< A function transpiled to C++.
+    FLAT_FUNCTION,     ///< A function of a FlatAst.
+    ERROR,
+  };
+
+  /// Null.
+  Value() = default;
+  static Value integer(int64_t value) {
+    Value v{Type::INTEGER};
+    v.i = value;
+    return v;
+  }
+  static Value boolean(bool value) {
+    Value v{Type::BOOLEAN};
+    v.b = value;
+    return v;
+  }
+  static Value function(const FunctionLiteral& literal,
+                        std::vector<std::shared_ptr<Value>> captures,
+                        std::shared_ptr<object::Environment> globals);
+  static Value error(std::string message);
+  /// Takes a reference to `object`, whose kind `type` names.
+  Value(Type type, object::Object* object);
+
+  Value(const Value& other)
+      : returning{other.returning}
+      , tag{other.tag}
+      , i{other.i} {
+    if (is_object()) retain();
+  }
+  Value(Value&& other) noexcept
+      : returning{other.returning}
+      , tag{other.tag}
+      , i{other.i} {
+    other.tag = Type::NULL_;
+  }
+  Value& operator=(Value other) noexcept {
+    std::swap(returning, other.returning);
+    std::swap(tag, other.tag);
+    std::swap(i, other.i);
+    return *this;
+  }
+  ~Value() {
+    if (is_object()) release();
+  }
+
+  Type type() const { return tag; }
+  bool is_error() const { return tag == Type::ERROR; }
+  int64_t as_integer() const { return i; }
+  bool as_boolean() const { return b; }
+  /// The heap object of a FUNCTION or ERROR value.
+  template <class T>
+  const T& as() const {
+    return static_cast<const T&>(*object);
+  }
+
+  /// Whether `if` takes its consequence: anything but null and false.
+  bool truthy() const {
+    return !(tag == Type::NULL_ || (tag == Type::BOOLEAN && !b));
+  }
+
+  std::string inspect() const;
+  friend std::ostream& operator<<(std::ostream& out, const Value& value);
+
+  /// Set while the value of a `return` unwinds to the enclosing call.
+  bool returning{false};
+
+private:
+  Type tag{Type::NULL_};
+  union {
+    int64_t i{0};
+    bool b;
+    object::Object* object;
+  };
+
+  explicit Value(Type type)
+      : tag{type} { }
+
+  bool is_object() const { return tag >= Type::FUNCTION; }
+  void retain() const;
+  void release();
+};
+
+static_assert(sizeof(Value) == 16);
+
+/// Name of a value type as used in error messages, e.g. "INTEGER".
+std::string_view type_name(Value::Type type);
+
+} // namespace monkey
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "compiler.h"
+#include "object.h"
+#include "value.h"
+
+namespace monkey {
+
+/// Runs compiled bytecode on a stack of Values. Globals persist across runs,
+/// so a REPL can compile and run one line at a time with one VM.
+struct VM {
+  static constexpr size_t STACK_SIZE = 2048;
+  static constexpr size_t MAX_FRAMES = 1024;
+  /// One slot per index a GET_GLOBAL operand can hold.
+  static constexpr size_t GLOBALS_SIZE = 65536;
+
+  /// Instructions executed by the last run.
+  size_t dispatched{0};
+
+  VM();
+  /// The value of the program's last expression statement, or the error
+  /// that stopped it.
+  Value run(const Bytecode& bytecode);
+
+private:
+  /// A call in progress. The callee sits just below `base`, followed by its
+  /// arguments and locals.
+  struct Frame {
+    const object::Closure* closure;
+    const uint8_t* code;
+    const uint8_t* ip;
+    Value* base;
+  };
+
+  std::vector<Value> stack;
+  std::vector<Value> globals;
+  /// Which globals have been set; the others are null.
+  std::vector<bool> bound;
+  std::vector<Frame> frames{};
+
+  /// Ends a run that dispatched `count` instructions, nulling the stack up
+  /// to `sp` so it holds no references between runs.
+  void unwind(Value* sp, size_t count);
+};
+
+/// Whether the VMs were built to dispatch with computed goto; see the
+/// MONKEY_COMPUTED_GOTO option.
+bool threaded_dispatch();
+
+} // namespace monkey
@@ -0,0 +1,524 @@
+#include "monkey/jit.h"
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define MONKEY_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define MONKEY_JIT 0
+#endif
+
+using std::span;
+using std::unique_ptr;
+using std::vector;
+
+namespace monkey::jit {
+
+using Kind  = Node::Kind;
+using Scope = Identifier::Scope;
+using Type  = Value::Type;
+
+/// Why compiled code bailed out.
+enum class Failure : uint8_t {
+  NONE,
+  DIVISION_BY_ZERO,
+  /// Something the code can't handle, like a callee that won't compile or
+  /// recursion past MAX_DEPTH; the function is left to the interpreter.
+  GIVE_UP,
+};
+
+/// Shared by the native calls under one call from the interpreter.
+/// Compiled code keeps a pointer to it in rbx.
+struct State {
+  Jit* jit;
+  object::Environment* globals;
+  uint32_t depth{0};
+  Failure failure{Failure::NONE};
+};
+
+/// A call of the global `name` with `arity` arguments.
+struct CallSite {
+  Symbol name;
+  size_t arity;
+};
+
+bool available() { return MONKEY_JIT; }
+
+Jit::Jit() = default;
+
+Jit::~Jit() {
+#if MONKEY_JIT
+  for (auto& mapping : pages) munmap(mapping.address, mapping.size);
+#endif
+}
+
+#if MONKEY_JIT
+namespace {
+
+/// Called by compiled code to call the global function of `site`, with
+/// its arguments in order at `args`.
+int64_t call_global(State* state, const CallSite* site, const int64_t* args) {
+  auto* callee = state->globals->global(site->name);
+  Jit::Code code{nullptr};
+  if (callee && callee->type() == Type::FUNCTION
+      && state->depth < Jit::MAX_DEPTH) {
+    auto& literal = callee->as<object::Function>().literal;
+    if (literal.parameters.size() == site->arity) {
+      code = state->jit->code(literal);
+    }
+  }
+  if (!code) {
+    state->failure = Failure::GIVE_UP;
+    return 0;
+  }
+  ++state->depth;
+  auto result = code(args, state);
+  --state->depth;
+  return result;
+}
+
+/// Appends x86-64 machine code: the few instructions the templates need,
+/// on fixed registers, so they are written out as bytes.
+struct Assembler {
+  vector<uint8_t> code{};
+
+  void emit(std::initializer_list<uint8_t> bytes) {
+    code.insert(code.end(), bytes);
+  }
+  void imm32(int32_t value) { raw(&value, sizeof value); }
+  void imm64(int64_t value) { raw(&value, sizeof value); }
+  void raw(const void* bytes, size_t size) {
+    auto* at = static_cast<const uint8_t*>(bytes);
+    code.insert(code.end(), at, at + size);
+  }
+
+  size_t here() const { return code.size(); }
+  /// Emits a jump with a 32-bit offset, returning where the offset goes.
+  size_t jump(std::initializer_list<uint8_t> opcode) {
+    emit(opcode);
+    auto at = here();
+    imm32(0);
+    return at;
+  }
+  void patch(size_t at, size_t target) {
+    auto offset = static_cast<int32_t>(target - (at + 4));
+    std::memcpy(code.data() + at, &offset, sizeof offset);
+  }
+
+  /// rax = value
+  void load_constant(int64_t value) {
+    emit({0x48, 0xB8}); // mov rax, imm64
+    imm64(value);
+  }
+  /// rax = [rbp + offset]
+  void load_local(int32_t offset) {
+    emit({0x48, 0x8B, 0x85});
+    imm32(offset);
+  }
+  /// [rbp + offset] = rax
+  void store_local(int32_t offset) {
+    emit({0x48, 0x89, 0x85});
+    imm32(offset);
+  }
+};
+
+/// The static type of the value an expression leaves in rax. Booleans are
+/// 0 or 1.
+enum class Shape : uint8_t { NONE, INTEGER, BOOLEAN };
+
+/// What a block's or expression's value is for.
+enum class Use : uint8_t {
+  /// It is the function's; the code returns it.
+  RESULT,
+  DISCARD,
+  /// Something else needs it, so the code must fall through with it.
+  VALUE,
+};
+
+/// Generates a function's code in one walk over its body.
+///
+/// The frame is rbp, rbx, then a slot per local. Expressions leave their
+/// value in rax and keep operands on the native stack, `depth` words below
+/// the locals; calls pad it so rsp is 16-byte aligned at the call.
+struct Codegen {
+  /// How deeply expressions may nest, as the walk is recursive.
+  static constexpr int MAX_NESTING = 256;
+
+  Assembler a{};
+  vector<unique_ptr<CallSite>> sites{};
+  /// What each local holds at this point of the body; lets only appear at
+  /// its top level, so code generated in order always knows.
+  vector<Shape> slots{};
+  int depth{0};
+  bool ok{true};
+  /// Jumps to the epilogue, which returns rax.
+  vector<size_t> exits{};
+  /// Jumps to where the code bails on division by zero.
+  vector<size_t> divisions{};
+
+  static int32_t local(uint32_t index) {
+    return -16 - 8 * static_cast<int32_t>(index);
+  }
+
+  Shape fail() {
+    ok = false;
+    return Shape::NONE;
+  }
+
+  bool function(const FunctionLiteral& literal) {
+    if (!literal.body || literal.cells > 0 || !literal.captures.empty()) {
+      return false;
+    }
+    slots.assign(literal.slots, Shape::NONE);
+    // Keeps rsp 16-byte aligned below the locals.
+    auto frame = 8 * literal.slots + (literal.slots % 2 == 0 ? 8 : 0);
+    a.emit({0x55});             // push rbp
+    a.emit({0x48, 0x89, 0xE5}); // mov rbp, rsp
+    a.emit({0x53});             // push rbx
+    a.emit({0x48, 0x81, 0xEC}); // sub rsp, frame
+    a.imm32(static_cast<int32_t>(frame));
+    a.emit({0x48, 0x89, 0xF3}); // mov rbx, rsi
+
+    for (size_t i{0}; i < literal.parameters.size(); ++i) {
+      auto& param = literal.parameters[i];
+      if (param.scope != Scope::LOCAL) return false;
+      a.emit({0x48, 0x8B, 0x87}); // mov rax, [rdi + 8 * i]
+      a.imm32(static_cast<int32_t>(8 * i));
+      a.store_local(local(param.index));
+      slots[param.index] = Shape::INTEGER;
+    }
+
+    block(*literal.body, Use::RESULT, true, true, 0);
+    if (!ok) return false;
+
+    for (auto at : divisions) a.patch(at, a.here());
+    a.emit({0xC6, 0x43, offsetof(State, failure)}); // mov byte [rbx + ...]
+    a.emit({static_cast<uint8_t>(Failure::DIVISION_BY_ZERO)});
+    for (auto at : exits) a.patch(at, a.here());
+    a.emit({0x48, 0x8D, 0x65, 0xF8}); // lea rsp, [rbp - 8]
+    a.emit({0x5B});                   // pop rbx
+    a.emit({0x5D});                   // pop rbp
+    a.emit({0xC3});                   // ret
+    return true;
+  }
+
+  Shape block(const BlockStatement& body,
+              Use use,
+              bool can_return,
+              bool top,
+              int nesting) {
+    auto& stmts = body.statements;
+    if (stmts.empty()) return use == Use::DISCARD ? Shape::NONE : fail();
+    auto shape = Shape::NONE;
+    for (size_t i{0}; i < stmts.size() && ok; ++i) {
+      auto last = i + 1 == stmts.size();
+      shape     = statement(
+          *stmts[i], last ? use : Use::DISCARD, can_return, top, nesting);
+    }
+    return shape;
+  }
+
+  Shape statement(const Statement& stmt,
+                  Use use,
+                  bool can_return,
+                  bool top,
+                  int nesting) {
+    switch (stmt.kind) {
+    case Kind::LET: {
+      auto& let = static_cast<const LetStatement&>(stmt);
+      if (!top || use != Use::DISCARD || !let.name || !let.value
+          || let.name->scope != Scope::LOCAL) {
+        return fail();
+      }
+      auto shape = expression(*let.value, nesting);
+      a.store_local(local(let.name->index));
+      slots[let.name->index] = shape;
+      return Shape::NONE;
+    }
+    case Kind::RETURN: {
+      auto* value = static_cast<const ReturnStatement&>(stmt).return_value;
+      if (!can_return || !value) return fail();
+      if (expression(*value, nesting) != Shape::INTEGER) return fail();
+      exits.push_back(a.jump({0xE9})); // jmp
+      return Shape::NONE;
+    }
+    case Kind::EXPRESSION: {
+      auto* expr = static_cast<const ExpressionStatement&>(stmt).expression;
+      if (!expr) return fail();
+      if (expr->kind == Kind::IF) {
+        return if_expression(static_cast<const IfExpression&>(*expr),
+                             use,
+                             can_return && use != Use::VALUE,
+                             nesting);
+      }
+      auto shape = expression(*expr, nesting);
+      if (use == Use::RESULT) {
+        if (shape != Shape::INTEGER) return fail();
+        exits.push_back(a.jump({0xE9})); // jmp
+      }
+      return shape;
+    }
+    default: return fail();
+    }
+  }
+
+  Shape if_expression(const IfExpression& ife,
+                      Use use,
+                      bool can_return,
+                      int nesting) {
+    if (!ife.condition || !ife.consequence
+        || expression(*ife.condition, nesting) != Shape::BOOLEAN) {
+      return fail();
+    }
+    a.emit({0x85, 0xC0});                  // test eax, eax
+    auto otherwise = a.jump({0x0F, 0x84}); // jz
+    auto shape     = block(*ife.consequence, use, can_return, false, nesting);
+    if (!ife.alternative) {
+      a.patch(otherwise, a.here());
+      return use == Use::DISCARD ? Shape::NONE : fail();
+    }
+    auto end = a.jump({0xE9}); // jmp
+    a.patch(otherwise, a.here());
+    auto other = block(*ife.alternative, use, can_return, false, nesting);
+    a.patch(end, a.here());
+    if (use == Use::VALUE && (shape != other || shape == Shape::NONE)) {
+      return fail();
+    }
+    return shape;
+  }
+
+  Shape expression(const Expression& expr, int nesting) {
+    if (!ok || ++nesting > MAX_NESTING) return fail();
+    switch (expr.kind) {
+    case Kind::INTEGER:
+      a.load_constant(static_cast<const IntegerLiteral&>(expr).value);
+      return Shape::INTEGER;
+    case Kind::BOOLEAN:
+      a.emit({0xB8}); // mov eax, imm32
+      a.imm32(static_cast<const Boolean&>(expr).value);
+      return Shape::BOOLEAN;
+    case Kind::IDENTIFIER: {
+      auto& ident = static_cast<const Identifier&>(expr);
+      if (ident.scope != Scope::LOCAL || slots[ident.index] == Shape::NONE) {
+        return fail();
+      }
+      a.load_local(local(ident.index));
+      return slots[ident.index];
+    }
+    case Kind::PREFIX:
+      return prefix(static_cast<const PrefixExpression&>(expr), nesting);
+    case Kind::INFIX:
+      return infix(static_cast<const InfixExpression&>(expr), nesting);
+    case Kind::IF:
+      return if_expression(
+          static_cast<const IfExpression&>(expr), Use::VALUE, false, nesting);
+    case Kind::CALL:
+      return call(static_cast<const CallExpression&>(expr), nesting);
+    default: return fail();
+    }
+  }
+
+  Shape prefix(const PrefixExpression& prefix, int nesting) {
+    auto shape = expression(*prefix.right, nesting);
+    switch (prefix.token.type) {
+    case Token::Type::MINUS:
+      if (shape != Shape::INTEGER) return fail();
+      a.emit({0x48, 0xF7, 0xD8}); // neg rax
+      return Shape::INTEGER;
+    case Token::Type::BANG:
+      if (shape == Shape::BOOLEAN) {
+        a.emit({0x83, 0xF0, 0x01}); // xor eax, 1
+      } else if (shape == Shape::INTEGER) {
+        a.emit({0x31, 0xC0}); // xor eax, eax; integers are truthy
+      } else {
+        return fail();
+      }
+      return Shape::BOOLEAN;
+    default: return fail();
+    }
+  }
+
+  Shape infix(const InfixExpression& infix, int nesting) {
+    auto left = expression(*infix.left, nesting);
+    a.emit({0x50}); // push rax
+    ++depth;
+    auto right = expression(*infix.right, nesting);
+    a.emit({0x48, 0x89, 0xC1}); // mov rcx, rax
+    a.emit({0x58});             // pop rax
+    --depth;
+    if (!ok || left != right) return fail();
+
+    auto op = infix.token.type;
+    if (op == Token::Type::EQ || op == Token::Type::NOT_EQ) {
+      compare(op == Token::Type::EQ ? 0x94 : 0x95); // sete, setne
+      return Shape::BOOLEAN;
+    }
+    if (left != Shape::INTEGER) return fail();
+    switch (op) {
+    case Token::Type::PLUS:
+      a.emit({0x48, 0x01, 0xC8}); // add rax, rcx
+      break;
+    case Token::Type::MINUS:
+      a.emit({0x48, 0x29, 0xC8}); // sub rax, rcx
+      break;
+    case Token::Type::ASTERISK:
+      a.emit({0x48, 0x0F, 0xAF, 0xC1}); // imul rax, rcx
+      break;
+    case Token::Type::SLASH: divide(); break;
+    case Token::Type::LT: compare(0x9C); return Shape::BOOLEAN; // setl
+    case Token::Type::GT: compare(0x9F); return Shape::BOOLEAN; // setg
+    default: return fail();
+    }
+    return Shape::INTEGER;
+  }
+
+  /// rax = rax <condition> rcx, for the setcc opcode `set`.
+  void compare(uint8_t set) {
+    a.emit({0x48, 0x39, 0xC8}); // cmp rax, rcx
+    a.emit({0x0F, set, 0xC0});  // setcc al
+    a.emit({0x0F, 0xB6, 0xC0}); // movzx eax, al
+  }
+
+  /// rax = rax / rcx, bailing on division by zero. Dividing by -1 negates
+  /// instead, as idiv would trap on the smallest integer.
+  void divide() {
+    a.emit({0x48, 0x85, 0xC9}); // test rcx, rcx
+    divisions.push_back(a.jump({0x0F, 0x84})); // jz
+    a.emit({0x48, 0x83, 0xF9, 0xFF});          // cmp rcx, -1
+    auto divisor = a.jump({0x0F, 0x85});       // jne
+    a.emit({0x48, 0xF7, 0xD8});                // neg rax
+    auto end = a.jump({0xE9});                 // jmp
+    a.patch(divisor, a.here());
+    a.emit({0x48, 0x99});       // cqo
+    a.emit({0x48, 0xF7, 0xF9}); // idiv rcx
+    a.patch(end, a.here());
+  }
+
+  /// Calls a global function through call_global(), with the arguments
+  /// stored in order at rsp.
+  Shape call(const CallExpression& call, int nesting) {
+    if (!call.function || call.function->kind != Kind::IDENTIFIER) {
+      return fail();
+    }
+    auto& callee = static_cast<const Identifier&>(*call.function);
+    if (callee.scope != Scope::GLOBAL) return fail();
+
+    auto count = static_cast<int>(call.arguments.size());
+    auto words = count + (depth + count) % 2;
+    if (words > 0) {
+      a.emit({0x48, 0x81, 0xEC}); // sub rsp, 8 * words
+      a.imm32(8 * words);
+    }
+    depth += words;
+    for (int i{0}; i < count && ok; ++i) {
+      if (expression(*call.arguments[i], nesting) != Shape::INTEGER) {
+        return fail();
+      }
+      a.emit({0x48, 0x89, 0x84, 0x24}); // mov [rsp + 8 * i], rax
+      a.imm32(8 * i);
+    }
+
+    auto& site = sites.emplace_back(new CallSite{
+        callee.value, call.arguments.size()});
+    a.emit({0x48, 0x89, 0xDF}); // mov rdi, rbx
+    a.emit({0x48, 0xBE});       // mov rsi, site
+    a.imm64(reinterpret_cast<int64_t>(site.get()));
+    a.emit({0x48, 0x89, 0xE2}); // mov rdx, rsp
+    a.load_constant(reinterpret_cast<int64_t>(&call_global));
+    a.emit({0xFF, 0xD0}); // call rax
+    if (words > 0) {
+      a.emit({0x48, 0x81, 0xC4}); // add rsp, 8 * words
+      a.imm32(8 * words);
+    }
+    depth -= words;
+    a.emit({0x80, 0x7B, offsetof(State, failure), 0x00}); // cmp byte [rbx+]
+    exits.push_back(a.jump({0x0F, 0x85}));                // jne
+    return Shape::INTEGER;
+  }
+};
+
+} // namespace
+#endif
+
+Jit::Code Jit::compile(const FunctionLiteral& literal) {
+#if MONKEY_JIT
+  Codegen gen{};
+  if (!gen.function(literal)) return nullptr;
+
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto size = (gen.a.code.size() + page - 1) / page * page;
+  auto* address =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+           -1, 0);
+  if (address == MAP_FAILED) return nullptr;
+  std::memcpy(address, gen.a.code.data(), gen.a.code.size());
+  if (mprotect(address, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(address, size);
+    return nullptr;
+  }
+  pages.push_back({address, size});
+  for (auto& site : gen.sites) sites.push_back(std::move(site));
+  return reinterpret_cast<Code>(address);
+#else
+  (void)literal;
+  return nullptr;
+#endif
+}
+
+Jit::Code Jit::code(const FunctionLiteral& literal) {
+  auto& entry = entries[&literal];
+  if (entry.status == Entry::Status::COLD) {
+    entry.code   = compile(literal);
+    entry.status = entry.code ? Entry::Status::COMPILED
+                              : Entry::Status::UNSUPPORTED;
+  }
+  return entry.code;
+}
+
+bool Jit::call(const object::Function& fn,
+               span<const Value> args,
+               Value& result) {
+#if MONKEY_JIT
+  for (auto& arg : args) {
+    if (arg.type() != Type::INTEGER) return false;
+  }
+  auto& entry = entries[&fn.literal];
+  if (entry.status == Entry::Status::COLD && ++entry.calls < HOT_CALLS) {
+    return false;
+  }
+  // A function given up on keeps its code for calls from compiled code,
+  // which bail out on their own if they go wrong.
+  if (entry.status == Entry::Status::DISABLED || !code(fn.literal)) {
+    return false;
+  }
+
+  int64_t small[8];
+  vector<int64_t> large{};
+  auto* native = small;
+  if (args.size() > std::size(small)) {
+    large.resize(args.size());
+    native = large.data();
+  }
+  for (size_t i{0}; i < args.size(); ++i) native[i] = args[i].as_integer();
+
+  State state{this, fn.globals.get()};
+  auto value = entry.code(native, &state);
+  switch (state.failure) {
+  case Failure::NONE: result = Value::integer(value); return true;
+  case Failure::GIVE_UP: entry.status = Entry::Status::DISABLED; break;
+  case Failure::DIVISION_BY_ZERO: break;
+  }
+  return false;
+#else
+  (void)fn;
+  (void)args;
+  (void)result;
+  return false;
+#endif
+}
+
+} // namespace monkey::jit
@@ -1,17 +1,17 @@
 #include "monkey/lexer.h"
 
+#include <monkey/scan.h>
+
+#include <iterator>
 #include <string>
 
 using std::istream;
-using std::make_unique;
+using std::move;
 using std::string;
+using std::string_view;
 
 namespace monkey {
 
-bool is_whitespace(const char& ch) {
-  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
-}
-
 bool is_letter(const char& ch) {
   return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z') || ch == '_';
 }
@@ -21,122 +21,100 @@ bool is_digit(const char& ch) {
 }
 
 Lexer::Lexer(istream& in)
-    : in{in} { }
+    : owned{std::istreambuf_iterator<char>{in}, {}}
+    , src{owned} { }
+Lexer::Lexer(string&& in)
+    : owned{move(in)}
+    , src{owned} { }
 Lexer::Lexer(const string& in)
-    : in_str{in} { }
-Lexer::~Lexer()                = default;
-Lexer::Lexer(Lexer&&) noexcept = default;
+    : owned{in}
+    , src{owned} { }
+Lexer::Lexer(string_view in)
+    : src{in} { }
+Lexer::Lexer(const char* in)
+    : src{in} { }
+Lexer::~Lexer() = default;
+Lexer::Lexer(Lexer&& other) noexcept
+    : owned{move(other.owned)}
+    , src{other.src}
+    , pos{other.pos} {
+  if (!owned.empty()) src = owned;
+}
+
+const char* Lexer::end() const {
+  return src.data() + src.size();
+}
+
+string_view Lexer::source() const {
+  return src;
+}
 
 Token Lexer::next_token() {
+  return Token{next_view()};
+}
+
+TokenView Lexer::next_view() {
   skip_whitespace();
 
-  Token token{};
-  char c;
-  if (in >> c) {
-    token.literal = {c};
-  } else {
-    token.literal = {};
-    token.type    = Token::Type::EOF_;
-    return token;
-  }
+  if (pos >= src.size()) return {Token::Type::EOF_, src.substr(pos, 0)};
 
-  switch (c) {
+  size_t start = pos;
+  Token::Type type;
+  switch (src[pos++]) {
     //<editor-fold desc="single-char">
-  case '+': {
-    token.type = Token::Type::PLUS;
-    break;
-  }
-  case '-': {
-    token.type = Token::Type::MINUS;
-    break;
-  }
-  case '/': {
-    token.type = Token::Type::SLASH;
-    break;
-  }
-  case '*': {
-    token.type = Token::Type::ASTERISK;
-    break;
-  }
-  case '<': {
-    token.type = Token::Type::LT;
-    break;
-  }
-  case '>': {
-    token.type = Token::Type::GT;
-    break;
-  }
-  case ';': {
-    token.type = Token::Type::SEMICOLON;
-    break;
-  };
-  case ',': {
-    token.type = Token::Type::COMMA;
-    break;
-  }
-  case '(': {
-    token.type = Token::Type::LPAREN;
-    break;
-  }
-  case ')': {
-    token.type = Token::Type::RPAREN;
-    break;
-  }
-  case '{': {
-    token.type = Token::Type::LBRACE;
-    break;
-  }
-  case '}': {
-    token.type = Token::Type::RBRACE;
-    break;
-  }
+  case '+': type = Token::Type::PLUS; break;
+  case '-': type = Token::Type::MINUS; break;
+  case '/': type = Token::Type::SLASH; break;
+  case '*': type = Token::Type::ASTERISK; break;
+  case '<': type = Token::Type::LT; break;
+  case '>': type = Token::Type::GT; break;
+  case ';': type = Token::Type::SEMICOLON; break;
+  case ',': type = Token::Type::COMMA; break;
+  case '(': type = Token::Type::LPAREN; break;
+  case ')': type = Token::Type::RPAREN; break;
+  case '{': type = Token::Type::LBRACE; break;
+  case '}': type = Token::Type::RBRACE; break;
     //</editor-fold>
     //<editor-fold desc="equality">
   case '=': {
-    if (in.peek() == '=') {
-      in >> c;
-      token.literal += c;
-      token.type = Token::Type::EQ;
+    if (pos < src.size() && src[pos] == '=') {
+      ++pos;
+      type = Token::Type::EQ;
     } else {
-      token.type = Token::Type::ASSIGN;
+      type = Token::Type::ASSIGN;
     }
     break;
   };
   case '!': {
-    if (in.peek() == '=') {
-      in >> c;
-      token.literal += c;
-      token.type = Token::Type::NOT_EQ;
+    if (pos < src.size() && src[pos] == '=') {
+      ++pos;
+      type = Token::Type::NOT_EQ;
     } else {
-      token.type = Token::Type::BANG;
+      type = Token::Type::BANG;
     }
     break;
   }
     //</editor-fold>
   default: {
+    char c = src[start];
     if (is_letter(c)) {
-      while (is_letter(in.peek())) {
-        in >> c;
-        token.literal += c;
-      }
-      token.type = Token::lookup_ident(token.literal);
+      pos        = scan::skip_letters(src.data() + pos, end()) - src.data();
+      auto ident = src.substr(start, pos - start);
+      return {Token::lookup_ident(ident), ident};
     } else if (is_digit(c)) {
-      while (is_digit(in.peek())) {
-        in >> c;
-        token.literal += c;
-      }
-      token.type = Token::Type::INT;
+      pos  = scan::skip_digits(src.data() + pos, end()) - src.data();
+      type = Token::Type::INT;
     } else {
-      token.type = Token::Type::ILLEGAL;
+      type = Token::Type::ILLEGAL;
     }
   }
   }
 
-  return token;
+  return {type, src.substr(start, pos - start)};
 }
 
 void Lexer::skip_whitespace() {
-  while (is_whitespace(in.peek())) in.get();
+  pos = scan::skip_whitespace(src.data() + pos, end()) - src.data();
 }
 
 } // namespace monkey
@@ -1,45 +1,168 @@
 #include "monkey/object.h"
 
-#include <string>
-#include <unordered_map>
+#include <fmt/ostream.h>
 
-namespace monkey::object {
+#include <string>
 
-using std::unordered_map;
 using std::ostream;
+using std::shared_ptr;
+using std::string;
+using std::string_view;
+using std::vector;
 
-ostream& operator<<(ostream& out, const Object& obj) {
-  return out << obj.inspect();
+namespace monkey {
+
+//<editor-fold desc="Value">
+Value::Value(Type type, object::Object* object)
+    : tag{type}
+    , object{object} {
+  retain();
 }
 
-Integer::Integer(int val)
-    : value{val} { }
+Value Value::function(const FunctionLiteral& literal,
+                      vector<shared_ptr<Value>> captures,
+                      shared_ptr<object::Environment> globals) {
+  return {Type::FUNCTION,
+          new object::Function{
+              literal, std::move(captures), std::move(globals)}};
+}
 
-const Type& Integer::type() {
-  return types::INTEGER;
+Value Value::error(string message) {
+  return {Type::ERROR, new object::Error{std::move(message)}};
 }
 
-std::string Integer::inspect() const {
-  return std::to_string(value);
+void Value::retain() const {
+  ++object->refs;
 }
 
-Boolean::Boolean(bool value)
-    : value{value} { }
+void Value::release() {
+  if (--object->refs == 0) delete object;
+}
 
-const Type& Boolean::type() {
-  return types::BOOLEAN;
+string Value::inspect() const {
+  switch (tag) {
+  case Type::NULL_: return "null";
+  case Type::INTEGER: return std::to_string(i);
+  case Type::BOOLEAN: return b ? "true" : "false";
+  case Type::FUNCTION:
+  case Type::CLOSURE:
+  case Type::COMPILED_FUNCTION:
+  case Type::NATIVE:
+  case Type::FLAT_FUNCTION:
+  case Type::ERROR: return object->inspect();
+  }
+  return "null";
 }
 
-std::string Boolean::inspect() const {
-  return value ? "true" : "false";
+ostream& operator<<(ostream& out, const Value& value) {
+  return out << value.inspect();
 }
 
-const Type& Null::type() {
-  return types::NULL_;
+string_view type_name(Value::Type type) {
+  switch (type) {
+  case Value::Type::NULL_: return "NULL";
+  case Value::Type::INTEGER: return "INTEGER";
+  case Value::Type::BOOLEAN: return "BOOLEAN";
+  case Value::Type::FUNCTION:
+  // Users see one kind of function whichever engine runs it.
+  case Value::Type::CLOSURE:
+  case Value::Type::NATIVE:
+  case Value::Type::FLAT_FUNCTION: return "FUNCTION";
+  case Value::Type::COMPILED_FUNCTION: return "COMPILED_FUNCTION";
+  case Value::Type::ERROR: return "ERROR";
+  }
+  return "NULL";
 }
+//</editor-fold>
 
-std::string Null::inspect() const {
-  return "null";
+namespace object {
+
+Environment::Environment(const Function& function)
+    : slots(function.literal.slots)
+    , cells(function.literal.cells)
+    , function{&function}
+    , root{function.globals.get()} {
+  for (auto& cell : cells) cell = std::make_shared<Value>();
+}
+
+const Value* Environment::global(Symbol name) const {
+  auto& globals = *root;
+  if (name.id >= globals.bound.size() || !globals.bound[name.id]) {
+    return nullptr;
+  }
+  return &globals.slots[name.id];
+}
+
+void Environment::set_global(Symbol name, Value value) {
+  auto& globals = *root;
+  if (name.id >= globals.slots.size()) {
+    globals.slots.resize(name.id + 1);
+    globals.bound.resize(name.id + 1);
+  }
+  globals.slots[name.id] = std::move(value);
+  globals.bound[name.id] = true;
+}
+
+void Environment::clear_globals() {
+  root->slots.clear();
+  root->bound.clear();
+}
+
+Function::Function(const FunctionLiteral& literal,
+                   vector<Cell> captures,
+                   shared_ptr<Environment> globals)
+    : literal{literal}
+    , captures{std::move(captures)}
+    , globals{std::move(globals)} { }
+
+string Function::inspect() const {
+  return fmt::format("{}", literal);
+}
+
+CompiledFunction::CompiledFunction(code::Instructions instructions,
+                                   size_t locals,
+                                   size_t parameters,
+                                   string source)
+    : instructions{std::move(instructions)}
+    , locals{locals}
+    , parameters{parameters}
+    , source{std::move(source)} { }
+
+string CompiledFunction::inspect() const {
+  return source;
+}
+
+Closure::Closure(Value function, std::vector<Value> free)
+    : function{std::move(function)}
+    , free{std::move(free)} { }
+
+const CompiledFunction& Closure::compiled() const {
+  return function.as<CompiledFunction>();
+}
+
+string Closure::inspect() const {
+  return function.inspect();
+}
+
+NativeFunction::NativeFunction(Code code,
+                               size_t parameters,
+                               const char* source,
+                               vector<Cell> captures)
+    : code{code}
+    , parameters{parameters}
+    , source{source}
+    , captures{std::move(captures)} { }
+
+string NativeFunction::inspect() const {
+  return source;
+}
+
+Error::Error(string message)
+    : message{std::move(message)} { }
+
+string Error::inspect() const {
+  return "ERROR: " + message;
 }
 
-} // namespace monkey::object
+} // namespace object
+} // namespace monkey
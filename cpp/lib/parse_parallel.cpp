@@ -0,0 +1,91 @@
+#include "monkey/parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace monkey {
+
+/// Chunks smaller than this cost more in handoff than they save.
+constexpr size_t MIN_CHUNK = 4096;
+
+struct Chunk {
+  string_view text;
+  Position origin;
+};
+
+/// Cuts `source` after top-level semicolons into chunks of at least `target`
+/// bytes, noting where each starts. Monkey has no string literals or
+/// comments, so bracket depth over raw bytes is exact.
+vector<Chunk> split_statements(string_view source, size_t target) {
+  vector<Chunk> chunks{};
+  size_t start{0};
+  Position origin{};
+  uint32_t line{1};
+  size_t bol{0};
+  int depth{0};
+
+  for (size_t i{0}; i < source.size(); ++i) {
+    switch (source[i]) {
+    case '(':
+    case '{': ++depth; break;
+    case ')':
+    case '}': depth = std::max(depth - 1, 0); break;
+    case '\n':
+      ++line;
+      bol = i + 1;
+      break;
+    case ';':
+      if (depth == 0 && i + 1 - start >= target) {
+        chunks.push_back({source.substr(start, i + 1 - start), origin});
+        start  = i + 1;
+        origin = {line, static_cast<uint32_t>(start - bol + 1)};
+      }
+      break;
+    }
+  }
+  if (start < source.size() || chunks.empty()) {
+    chunks.push_back({source.substr(start), origin});
+  }
+  return chunks;
+}
+
+Program parse_program_parallel(string_view source,
+                               vector<string>& errors,
+                               unsigned threads) {
+  if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+  auto chunks = split_statements(
+      source, std::max(MIN_CHUNK, source.size() / (threads * 4)));
+
+  vector<Program> programs(chunks.size());
+  vector<vector<string>> chunk_errors(chunks.size());
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t i; (i = next++) < chunks.size();) {
+      TokenStream tokens{chunks[i].text};
+      Parser parser{tokens, chunks[i].origin};
+      programs[i].append(parser.parse_program());
+      chunk_errors[i] = std::move(parser.errors);
+    }
+  };
+
+  vector<std::thread> pool{};
+  for (size_t t{1}; t < std::min<size_t>(threads, chunks.size()); ++t) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (auto& t : pool) t.join();
+
+  Program program{};
+  for (size_t i{0}; i < chunks.size(); ++i) {
+    program.append(std::move(programs[i]));
+    for (auto& err : chunk_errors[i]) errors.push_back(move(err));
+  }
+  return program;
+}
+
+} // namespace monkey
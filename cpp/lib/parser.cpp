@@ -1,132 +1,254 @@
 #include "monkey/parser.h"
 
 #include "fmt/ostream.h"
+#include "monkey/resolver.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
 
 using namespace fmt::literals;
-using std::make_unique;
-using std::move;
-using std::unique_ptr;
+using std::span;
 using std::vector;
 
 namespace monkey {
-using TT            = Token::Type;
-using ExpressionPtr = unique_ptr<Expression>;
+using TT = Token::Type;
 
 Parser::Parser(Lexer& lexer)
-    : lexer{lexer}
-    , cur_token{lexer.next_token()}
-    , peek_token{lexer.next_token()} {
-  using namespace std::placeholders;
-
-  prefix_parse_fns[TT::IDENT] = std::bind(&Parser::parse_identifier, this);
-  prefix_parse_fns[TT::INT]   = std::bind(&Parser::parse_integer_literal, this);
-  prefix_parse_fns[TT::BANG] =
-      std::bind(&Parser::parse_prefix_expression, this);
-  prefix_parse_fns[TT::MINUS] =
-      std::bind(&Parser::parse_prefix_expression, this);
-  prefix_parse_fns[TT::TRUE]  = std::bind(&Parser::parse_boolean, this);
-  prefix_parse_fns[TT::FALSE] = std::bind(&Parser::parse_boolean, this);
-  prefix_parse_fns[TT::LPAREN] =
-      std::bind(&Parser::parse_grouped_expression, this);
-  prefix_parse_fns[TT::IF] = std::bind(&Parser::parse_if_expression, this);
-  prefix_parse_fns[TT::FUNCTION] =
-      std::bind(&Parser::parse_function_literal, this);
-
-  infix_parse_fns[TT::PLUS] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::MINUS] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::SLASH] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::ASTERISK] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::EQ] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::NOT_EQ] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::LT] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::GT] =
-      std::bind(&Parser::parse_infix_expression, this, _1);
-  infix_parse_fns[TT::LPAREN] =
-      std::bind(&Parser::parse_call_expression, this, _1);
+    : owned_tokens{std::make_unique<TokenStream>(lexer)}
+    , tokens{*owned_tokens} { }
+
+Parser::Parser(const TokenStream& tokens, Position origin)
+    : tokens{tokens}
+    , origin{origin} { }
+
+constexpr Parser::Rules Parser::rules = [] {
+  Rules r{};
+  auto at = [&r](TT type) -> ParseRule& {
+    return r[static_cast<size_t>(type)];
+  };
+
+  at(TT::IDENT).prefix    = &Parser::parse_identifier;
+  at(TT::INT).prefix      = &Parser::parse_integer_literal;
+  at(TT::BANG).prefix     = &Parser::parse_prefix_expression;
+  at(TT::MINUS).prefix    = &Parser::parse_prefix_expression;
+  at(TT::TRUE).prefix     = &Parser::parse_boolean;
+  at(TT::FALSE).prefix    = &Parser::parse_boolean;
+  at(TT::LPAREN).prefix   = &Parser::parse_grouped_expression;
+  at(TT::IF).prefix       = &Parser::parse_if_expression;
+  at(TT::FUNCTION).prefix = &Parser::parse_function_literal;
+
+  for (auto [type, precedence] : {std::pair{TT::EQ, Precedence::EQUALS},
+                                  {TT::NOT_EQ, Precedence::EQUALS},
+                                  {TT::LT, Precedence::LESSGREATER},
+                                  {TT::GT, Precedence::LESSGREATER},
+                                  {TT::PLUS, Precedence::SUM},
+                                  {TT::MINUS, Precedence::SUM},
+                                  {TT::SLASH, Precedence::PRODUCT},
+                                  {TT::ASTERISK, Precedence::PRODUCT}}) {
+    at(type).infix      = &Parser::parse_infix_expression;
+    at(type).precedence = precedence;
+  }
+  at(TT::LPAREN).infix      = &Parser::parse_call_expression;
+  at(TT::LPAREN).precedence = Precedence::CALL;
+  return r;
+}();
+
+const Parser::ParseRule& Parser::rule(Token::Type type) {
+  return rules[static_cast<size_t>(type)];
 }
 
 void Parser::next_token() {
-  cur_token  = std::move(peek_token);
-  peek_token = lexer.next_token();
+  ++pos;
+}
+
+TokenView Parser::cur_token() {
+  return {tokens.type(pos), arena->copy(tokens.literal(pos))};
+}
+
+Token::Type Parser::peek_type() const {
+  return tokens.type(pos + 1);
 }
 
 Program Parser::parse_program() {
   Program p{};
-  while (cur_token.type != Token::Type::EOF_) {
+  arena = p.arena.get();
+  while (!cur_token_is(Token::Type::EOF_)) {
     auto stmt = parse_statement();
-    if (stmt) p.statements.push_back(std::move(stmt));
+    if (stmt) p.statements.push_back(stmt);
     next_token();
   }
+  resolve(p);
   return p;
 }
 
-unique_ptr<Statement> Parser::parse_statement() {
-  switch (cur_token.type) {
-  case Token::Type::LET: return parse_let_statement();
-  case Token::Type::RETURN: return parse_return_statement();
-  default: return parse_expression_statement();
+FlatAst Parser::parse_flat_program() {
+  return FlatAst{parse_program()};
+}
+
+Node* Parser::run(Task first) {
+  auto base = tasks.size();
+  tasks.push_back(first);
+  while (tasks.size() > base) {
+    auto task = tasks.back();
+    tasks.pop_back();
+    step(task);
   }
+  return result;
 }
 
-unique_ptr<LetStatement> Parser::parse_let_statement() {
-  auto stmt = make_unique<LetStatement>(cur_token);
-  if (!expect_peek(TT::IDENT)) { return nullptr; }
-  stmt->name = make_unique<Identifier>(cur_token);
-  if (!expect_peek(TT::ASSIGN)) { return nullptr; }
-  next_token();
-  stmt->value = parse_expression(Precedence::LOWEST);
-  if (peek_token_is(TT::SEMICOLON)) next_token();
-  return stmt;
+void Parser::step(const Task& task) {
+  using Kind = Task::Kind;
+  auto value = static_cast<Expression*>(result);
+  switch (task.kind) {
+  case Kind::STATEMENT:
+    switch (tokens.type(pos)) {
+    case TT::LET: return parse_let_statement();
+    case TT::RETURN: return parse_return_statement();
+    default: return parse_expression_statement();
+    }
+  case Kind::EXPRESSION: return parse_expression(task.precedence);
+  case Kind::BLOCK: return parse_block_statement();
+  case Kind::LET_VALUE:
+    static_cast<LetStatement&>(*task.node).value = value;
+    if (peek_token_is(TT::SEMICOLON)) next_token();
+    result = task.node;
+    return;
+  case Kind::RETURN_VALUE:
+    static_cast<ReturnStatement&>(*task.node).return_value = value;
+    if (peek_token_is(TT::SEMICOLON)) next_token();
+    result = task.node;
+    return;
+  case Kind::EXPRESSION_VALUE:
+    static_cast<ExpressionStatement&>(*task.node).expression = value;
+    if (peek_token_is(TT::SEMICOLON)) next_token();
+    result = task.node;
+    return;
+  case Kind::BLOCK_STATEMENT:
+    if (result) items.push_back(result);
+    next_token();
+    return parse_block_rest(static_cast<BlockStatement&>(*task.node),
+                            task.items);
+  case Kind::OPERAND: return parse_operand(task.precedence);
+  case Kind::PREFIX_RIGHT:
+    static_cast<PrefixExpression&>(*task.node).right = value;
+    result                                           = task.node;
+    return;
+  case Kind::INFIX_RIGHT:
+    static_cast<InfixExpression&>(*task.node).right = value;
+    result                                          = task.node;
+    return;
+  case Kind::GROUP:
+    if (!expect_peek(TT::RPAREN)) result = nullptr;
+    return;
+  case Kind::IF_CONDITION:
+    static_cast<IfExpression&>(*task.node).condition = value;
+    if (!expect_peek(TT::RPAREN) || !expect_peek(TT::LBRACE)) {
+      result = nullptr;
+      return;
+    }
+    tasks.push_back({Kind::IF_CONSEQUENCE, {}, task.node});
+    tasks.push_back({Kind::BLOCK});
+    return;
+  case Kind::IF_CONSEQUENCE:
+    static_cast<IfExpression&>(*task.node).consequence =
+        static_cast<BlockStatement*>(result);
+    result = task.node;
+    if (peek_token_is(TT::ELSE)) {
+      next_token();
+      if (!expect_peek(TT::LBRACE)) {
+        result = nullptr;
+        return;
+      }
+      tasks.push_back({Kind::IF_ALTERNATIVE, {}, task.node});
+      tasks.push_back({Kind::BLOCK});
+    }
+    return;
+  case Kind::IF_ALTERNATIVE:
+    static_cast<IfExpression&>(*task.node).alternative =
+        static_cast<BlockStatement*>(result);
+    result = task.node;
+    return;
+  case Kind::FUNCTION_BODY:
+    static_cast<FunctionLiteral&>(*task.node).body =
+        static_cast<BlockStatement*>(result);
+    result = task.node;
+    return;
+  case Kind::CALL_ARGUMENT:
+    items.push_back(result);
+    return parse_call_argument(static_cast<CallExpression&>(*task.node),
+                               task.items);
+  }
+}
+
+Statement* Parser::parse_statement() {
+  return static_cast<Statement*>(run({Task::Kind::STATEMENT}));
 }
 
-unique_ptr<ReturnStatement> Parser::parse_return_statement() {
-  auto stmt = make_unique<ReturnStatement>(cur_token);
+void Parser::parse_let_statement() {
+  auto stmt = arena->make<LetStatement>(cur_token());
+  result    = nullptr;
+  if (!expect_peek(TT::IDENT)) { return; }
+  stmt->name = arena->make<Identifier>(cur_token());
+  if (!expect_peek(TT::ASSIGN)) { return; }
   next_token();
-  stmt->return_value = parse_expression(Precedence::LOWEST);
-  if (peek_token_is(TT::SEMICOLON)) next_token();
-  return stmt;
+  tasks.push_back({Task::Kind::LET_VALUE, {}, stmt});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
 }
 
-unique_ptr<ExpressionStatement> Parser::parse_expression_statement() {
-  auto stmt        = make_unique<ExpressionStatement>(cur_token);
-  stmt->expression = parse_expression(Precedence::LOWEST);
+void Parser::parse_return_statement() {
+  auto stmt = arena->make<ReturnStatement>(cur_token());
+  next_token();
+  tasks.push_back({Task::Kind::RETURN_VALUE, {}, stmt});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
+}
 
-  if (peek_token_is(TT::SEMICOLON)) { next_token(); }
-  return stmt;
+void Parser::parse_expression_statement() {
+  auto stmt = arena->make<ExpressionStatement>(cur_token());
+  tasks.push_back({Task::Kind::EXPRESSION_VALUE, {}, stmt});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
 }
 
-unique_ptr<Expression> Parser::parse_expression(Precedence precedence) {
-  auto fn = prefix_parse_fns.find(cur_token.type);
-  if (fn == prefix_parse_fns.end()) {
-    no_prefix_parse_fn_error(cur_token.type);
-    return nullptr;
+void Parser::parse_expression(Precedence precedence) {
+  auto prefix = rule(tokens.type(pos)).prefix;
+  if (!prefix) {
+    no_prefix_parse_fn_error(tokens.type(pos));
+    result = nullptr;
+    return;
   }
-  auto left_exp = fn->second();
+  tasks.push_back({Task::Kind::OPERAND, precedence});
+  result = (this->*prefix)();
+}
 
-  while (!peek_token_is(Token::Type::SEMICOLON)
-         && precedence < peek_precedence()) {
-    auto s = infix_parse_fns.find(peek_token.type);
-    if (s == infix_parse_fns.end()) break;
-    next_token();
-    left_exp = s->second(move(left_exp));
+void Parser::parse_operand(Precedence precedence) {
+  if (peek_token_is(Token::Type::SEMICOLON)
+      || precedence >= peek_precedence()) {
+    return;
   }
+  auto infix = rule(peek_type()).infix;
+  if (!infix) return;
+  next_token();
+  tasks.push_back({Task::Kind::OPERAND, precedence});
+  result = (this->*infix)(static_cast<Expression*>(result));
+}
 
-  return left_exp;
+template <class T>
+span<T*> Parser::take_items(size_t start) {
+  vector<T*> taken{};
+  taken.reserve(items.size() - start);
+  for (size_t i{start}; i < items.size(); ++i) {
+    taken.push_back(static_cast<T*>(items[i]));
+  }
+  items.resize(start);
+  return arena->copy(taken);
 }
 
 bool Parser::cur_token_is(Token::Type type) const {
-  return cur_token.type == type;
+  return tokens.type(pos) == type;
 }
 
 bool Parser::peek_token_is(Token::Type type) const {
-  return peek_token.type == type;
+  return peek_type() == type;
 }
 
 bool Parser::expect_peek(Token::Type type) {
@@ -138,163 +260,166 @@ bool Parser::expect_peek(Token::Type type) {
   return false;
 }
 
+Position Parser::position(size_t token) const {
+  auto src    = tokens.source();
+  auto before = src.substr(0, tokens.literal(token).data() - src.data());
+  auto lines  = std::count(before.begin(), before.end(), '\n');
+  auto bol    = before.rfind('\n');
+  if (bol == before.npos) {
+    return {origin.line, origin.column + static_cast<uint32_t>(before.size())};
+  }
+  return {origin.line + static_cast<uint32_t>(lines),
+          static_cast<uint32_t>(before.size() - bol)};
+}
+
+void Parser::error(size_t token, std::string message) {
+  auto at = position(token);
+  errors.push_back("{}:{}: {}"_format(at.line, at.column, message));
+}
+
 void Parser::peek_error(TT expected) {
-  errors.push_back("expected next token to be {} but got {}"_format(
-      expected, peek_token.type));
+  error(pos + 1,
+        "expected next token to be {} but got {}"_format(expected,
+                                                          peek_type()));
 }
 
-Parser::ExpressionPtr Parser::parse_identifier() {
-  auto exp = make_unique<Identifier>(cur_token);
+Expression* Parser::parse_identifier() {
+  auto exp = arena->make<Identifier>(cur_token());
   return exp;
 }
 
-unique_ptr<IntegerLiteral> Parser::parse_integer_literal() {
-  auto exp   = make_unique<IntegerLiteral>(cur_token);
-  exp->value = std::stoi(cur_token.literal);
+Expression* Parser::parse_integer_literal() {
+  auto exp     = arena->make<IntegerLiteral>(cur_token());
+  auto literal = tokens.literal(pos);
+  auto result  = std::from_chars(
+      literal.data(), literal.data() + literal.size(), exp->value);
+  if (result.ec != std::errc{}) {
+    error(pos, "could not parse {} as integer"_format(literal));
+    return nullptr;
+  }
   return exp;
 }
 
 void Parser::no_prefix_parse_fn_error(Token::Type type) {
-  errors.emplace_back("no prefix parse function for {} found"_format(type));
+  error(pos, "no prefix parse function for {} found"_format(type));
 }
 
-Parser::ExpressionPtr Parser::parse_prefix_expression() {
-  auto exp = make_unique<PrefixExpression>(cur_token);
+Expression* Parser::parse_prefix_expression() {
+  auto exp = arena->make<PrefixExpression>(cur_token());
   next_token();
-  exp->right = parse_expression(Precedence::PREFIX);
-  return exp;
+  tasks.push_back({Task::Kind::PREFIX_RIGHT, {}, exp});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::PREFIX});
+  return nullptr;
 }
 
-std::unordered_map<TT, Parser::Precedence> Parser::precedences = {
-    {TT::EQ, Precedence::EQUALS},
-    {TT::NOT_EQ, Precedence::EQUALS},
-    {TT::LT, Precedence::LESSGREATER},
-    {TT::GT, Precedence::LESSGREATER},
-    {TT::PLUS, Precedence::SUM},
-    {TT::MINUS, Precedence::SUM},
-    {TT::SLASH, Precedence::PRODUCT},
-    {TT::ASTERISK, Precedence::PRODUCT},
-    {TT::LPAREN, Precedence::CALL},
-};
-
 Parser::Precedence Parser::peek_precedence() {
-  auto p = precedences.find(peek_token.type);
-  if (p == precedences.end()) return Precedence::LOWEST;
-  return p->second;
+  return rule(peek_type()).precedence;
 }
 
 Parser::Precedence Parser::cur_precedence() {
-  auto p = precedences.find(cur_token.type);
-  if (p == precedences.end()) return Precedence::LOWEST;
-  return p->second;
+  return rule(tokens.type(pos)).precedence;
 }
 
-Parser::ExpressionPtr Parser::parse_infix_expression(ExpressionPtr&& left) {
-  auto exp        = make_unique<InfixExpression>(cur_token, move(left));
+Expression* Parser::parse_infix_expression(Expression* left) {
+  auto exp        = arena->make<InfixExpression>(cur_token(), left);
   auto precedence = cur_precedence();
   next_token();
-  exp->right = parse_expression(precedence);
-  return exp;
+  tasks.push_back({Task::Kind::INFIX_RIGHT, {}, exp});
+  tasks.push_back({Task::Kind::EXPRESSION, precedence});
+  return nullptr;
 }
 
-Parser::ExpressionPtr Parser::parse_boolean() {
-  auto exp   = make_unique<Boolean>(std::move(cur_token));
+Expression* Parser::parse_boolean() {
+  auto exp   = arena->make<Boolean>(cur_token());
   exp->value = cur_token_is(TT::TRUE);
   return exp;
 }
 
-Parser::ExpressionPtr Parser::parse_grouped_expression() {
+Expression* Parser::parse_grouped_expression() {
   next_token();
-  auto exp = parse_expression(Precedence::LOWEST);
-
-  if (!expect_peek(TT::RPAREN)) return nullptr;
-
-  return exp;
+  tasks.push_back({Task::Kind::GROUP});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
+  return nullptr;
 }
 
-Parser::ExpressionPtr Parser::parse_if_expression() {
-  auto exp = make_unique<IfExpression>(std::move(cur_token));
+Expression* Parser::parse_if_expression() {
+  auto exp = arena->make<IfExpression>(cur_token());
   if (!expect_peek(Token::Type::LPAREN)) return nullptr;
   next_token();
-  exp->condition = parse_expression(Precedence::LOWEST);
-  if (!expect_peek(Token::Type::RPAREN)) { return nullptr; }
-  if (!expect_peek(Token::Type::LBRACE)) { return nullptr; }
-  exp->consequence = parse_block_statement();
-
-  if (peek_token_is(Token::Type::ELSE)) {
-    next_token();
-    if (!expect_peek(Token::Type::LBRACE)) return nullptr;
-    exp->alternative = parse_block_statement();
-  }
-
-  return exp;
+  tasks.push_back({Task::Kind::IF_CONDITION, {}, exp});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
+  return nullptr;
 }
 
-unique_ptr<BlockStatement> Parser::parse_block_statement() {
-  auto block = make_unique<BlockStatement>(move(cur_token));
+void Parser::parse_block_statement() {
+  auto block = arena->make<BlockStatement>(cur_token());
   next_token();
-  while (!cur_token_is(Token::Type::RBRACE)
-         && !cur_token_is(Token::Type::EOF_)) {
-    auto stmt = parse_statement();
-    if (stmt) { block->statements.push_back(move(stmt)); }
-    next_token();
+  parse_block_rest(*block, items.size());
+}
+
+void Parser::parse_block_rest(BlockStatement& block, size_t start) {
+  if (!cur_token_is(Token::Type::RBRACE)
+      && !cur_token_is(Token::Type::EOF_)) {
+    tasks.push_back({Task::Kind::BLOCK_STATEMENT, {}, &block, start});
+    tasks.push_back({Task::Kind::STATEMENT});
+    return;
   }
-  return block;
+  block.statements = take_items<Statement>(start);
+  result           = &block;
 }
 
-Parser::ExpressionPtr Parser::parse_function_literal() {
-  auto exp = make_unique<FunctionLiteral>(move(cur_token));
+Expression* Parser::parse_function_literal() {
+  auto exp = arena->make<FunctionLiteral>(cur_token());
   if (!expect_peek(Token::Type::LPAREN)) return nullptr;
   exp->parameters = parse_function_parameters();
   if (!expect_peek(Token::Type::LBRACE)) return nullptr;
-  exp->body = parse_block_statement();
-  return exp;
+  tasks.push_back({Task::Kind::FUNCTION_BODY, {}, exp});
+  tasks.push_back({Task::Kind::BLOCK});
+  return nullptr;
 }
 
-std::vector<Identifier> Parser::parse_function_parameters() {
-  std::vector<Identifier> params{};
+span<Identifier> Parser::parse_function_parameters() {
+  vector<Identifier> params{};
   if (peek_token_is(Token::Type::RPAREN)) {
     next_token();
-    return params;
+    return {};
   }
   next_token();
-  params.emplace_back(move(cur_token));
+  params.emplace_back(cur_token());
 
   while (peek_token_is(Token::Type::COMMA)) {
     next_token();
     next_token();
-    params.emplace_back(move(cur_token));
+    params.emplace_back(cur_token());
   }
 
-  if (!expect_peek(Token::Type::RPAREN)) return params;
-
-  return params;
-}
-Parser::ExpressionPtr Parser::parse_call_expression(ExpressionPtr func) {
-  auto exp       = make_unique<CallExpression>(move(cur_token), move(func));
-  exp->arguments = parse_call_arguments();
-  return exp;
+  expect_peek(Token::Type::RPAREN);
+  return arena->copy(params);
 }
 
-vector<ExpressionPtr> Parser::parse_call_arguments() {
-  vector<ExpressionPtr> args{};
+Expression* Parser::parse_call_expression(Expression* func) {
+  auto exp = arena->make<CallExpression>(cur_token(), func);
   if (peek_token_is(Token::Type::RPAREN)) {
     next_token();
-    return args;
+    return exp;
   }
-
   next_token();
-  args.emplace_back(parse_expression(Precedence::LOWEST));
+  tasks.push_back({Task::Kind::CALL_ARGUMENT, {}, exp, items.size()});
+  tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
+  return nullptr;
+}
 
-  while (peek_token_is(Token::Type::COMMA)) {
+void Parser::parse_call_argument(CallExpression& call, size_t start) {
+  if (peek_token_is(Token::Type::COMMA)) {
     next_token();
     next_token();
-    args.emplace_back(parse_expression(Precedence::LOWEST));
+    tasks.push_back({Task::Kind::CALL_ARGUMENT, {}, &call, start});
+    tasks.push_back({Task::Kind::EXPRESSION, Precedence::LOWEST});
+    return;
   }
-
-  if (!expect_peek(Token::Type::RPAREN)) return args;
-
-  return args;
+  expect_peek(Token::Type::RPAREN);
+  call.arguments = take_items<Expression>(start);
+  result         = &call;
 }
 
 } // namespace monkey
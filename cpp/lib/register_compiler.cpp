@@ -0,0 +1,405 @@
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <monkey/register_vm.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+using namespace fmt::literals;
+using std::span;
+using std::string;
+
+namespace monkey::reg {
+
+using Kind  = Node::Kind;
+using Scope = Binding::Scope;
+
+//<editor-fold desc="Prototype">
+string Prototype::inspect() const {
+  return source;
+}
+
+string disassemble(const std::vector<Instruction>& code) {
+  string out{};
+  for (size_t at{0}; at < code.size(); ++at) {
+    auto& ins = code[at];
+    out += "{:04} "_format(at);
+    switch (ins.op) {
+    case Opcode::LOAD_CONSTANT:
+      out += "OpLoadConstant {} {}"_format(ins.a, ins.bx());
+      break;
+    case Opcode::LOAD_NULL: out += "OpLoadNull {}"_format(ins.a); break;
+    case Opcode::LOAD_TRUE: out += "OpLoadTrue {}"_format(ins.a); break;
+    case Opcode::LOAD_FALSE: out += "OpLoadFalse {}"_format(ins.a); break;
+    case Opcode::MOVE: out += "OpMove {} {}"_format(ins.a, ins.b); break;
+    case Opcode::GET_GLOBAL:
+      out += "OpGetGlobal {} {}"_format(ins.a, ins.bx());
+      break;
+    case Opcode::SET_GLOBAL:
+      out += "OpSetGlobal {} {}"_format(ins.a, ins.bx());
+      break;
+    case Opcode::GET_FREE: out += "OpGetFree {} {}"_format(ins.a, ins.b); break;
+    case Opcode::CURRENT_CLOSURE:
+      out += "OpCurrentClosure {}"_format(ins.a);
+      break;
+    case Opcode::ADD: out += "OpAdd"; goto abc;
+    case Opcode::SUB: out += "OpSub"; goto abc;
+    case Opcode::MUL: out += "OpMul"; goto abc;
+    case Opcode::DIV: out += "OpDiv"; goto abc;
+    case Opcode::EQUAL: out += "OpEqual"; goto abc;
+    case Opcode::NOT_EQUAL: out += "OpNotEqual"; goto abc;
+    case Opcode::LESS_THAN: out += "OpLessThan"; goto abc;
+    case Opcode::GREATER_THAN: out += "OpGreaterThan"; goto abc;
+    case Opcode::CALL:
+      out += "OpCall";
+    abc:
+      out += " {} {} {}"_format(ins.a, ins.b, ins.c);
+      break;
+    case Opcode::MINUS: out += "OpMinus {} {}"_format(ins.a, ins.b); break;
+    case Opcode::BANG: out += "OpBang {} {}"_format(ins.a, ins.b); break;
+    case Opcode::JUMP: out += "OpJump {}"_format(ins.bx()); break;
+    case Opcode::JUMP_NOT_TRUTHY:
+      out += "OpJumpNotTruthy {} {}"_format(ins.a, ins.bx());
+      break;
+    case Opcode::CLOSURE:
+      out += "OpClosure {} {}"_format(ins.a, ins.bx());
+      break;
+    case Opcode::RETURN: out += "OpReturn {}"_format(ins.a); break;
+    }
+    out += "\n";
+  }
+  return out;
+}
+//</editor-fold>
+
+/// Lets in `node` outside nested functions: each gets a register of its own
+/// for the life of the frame. Walks an explicit stack, so it is not limited
+/// by the nesting compiling allows.
+static size_t count_lets(const Node* root) {
+  size_t n{0};
+  std::vector<const Node*> nodes{root};
+  while (!nodes.empty()) {
+    auto* node = nodes.back();
+    nodes.pop_back();
+    if (!node) continue;
+    switch (node->kind) {
+    case Kind::LET:
+      ++n;
+      nodes.push_back(static_cast<const LetStatement&>(*node).value);
+      break;
+    case Kind::RETURN:
+      nodes.push_back(static_cast<const ReturnStatement&>(*node).return_value);
+      break;
+    case Kind::EXPRESSION:
+      nodes.push_back(
+          static_cast<const ExpressionStatement&>(*node).expression);
+      break;
+    case Kind::BLOCK:
+      for (auto* stmt : static_cast<const BlockStatement&>(*node).statements) {
+        nodes.push_back(stmt);
+      }
+      break;
+    case Kind::PREFIX:
+      nodes.push_back(static_cast<const PrefixExpression&>(*node).right);
+      break;
+    case Kind::INFIX: {
+      auto& infix = static_cast<const InfixExpression&>(*node);
+      nodes.push_back(infix.left);
+      nodes.push_back(infix.right);
+      break;
+    }
+    case Kind::IF: {
+      auto& ife = static_cast<const IfExpression&>(*node);
+      nodes.push_back(ife.condition);
+      nodes.push_back(ife.consequence);
+      nodes.push_back(ife.alternative);
+      break;
+    }
+    case Kind::CALL: {
+      auto& call = static_cast<const CallExpression&>(*node);
+      nodes.push_back(call.function);
+      for (auto* arg : call.arguments) nodes.push_back(arg);
+      break;
+    }
+    case Kind::PROGRAM:
+    case Kind::FUNCTION:
+    case Kind::IDENTIFIER:
+    case Kind::INTEGER:
+    case Kind::BOOLEAN: break;
+    }
+  }
+  return n;
+}
+
+Compiler::Compiler() {
+  units.emplace_back();
+}
+
+Bytecode Compiler::compile(const Program& program) {
+  units.resize(1);
+  units[0] = Unit{};
+  // Functions may call globals bound after them.
+  for (auto* stmt : program.statements) {
+    if (stmt->kind == Kind::LET) {
+      globals.define(static_cast<const LetStatement&>(*stmt).name->value);
+    }
+  }
+  auto result = temp();
+  block(program.statements, result);
+  emit(Opcode::RETURN, result);
+
+  auto* main      = new Prototype{};
+  main->code      = std::move(units[0].code);
+  main->registers = units[0].registers;
+  return {{Value::Type::COMPILED_FUNCTION, main}, constants, globals.names};
+}
+
+/// Leaves the value of the last statement in `target`, or null if it is not
+/// an expression.
+void Compiler::block(span<Statement* const> statements, uint8_t target) {
+  for (auto* stmt : statements) statement(*stmt, target);
+  if (statements.empty() || statements.back()->kind != Kind::EXPRESSION) {
+    emit(Opcode::LOAD_NULL, target);
+  }
+}
+
+void Compiler::statement(const Statement& stmt, uint8_t target) {
+  auto mark = unit().top;
+  switch (stmt.kind) {
+  case Kind::EXPRESSION:
+    expression_into(*static_cast<const ExpressionStatement&>(stmt).expression,
+                    target);
+    break;
+  case Kind::RETURN:
+    emit(Opcode::RETURN,
+         operand(*static_cast<const ReturnStatement&>(stmt).return_value));
+    break;
+  case Kind::LET: {
+    auto& let = static_cast<const LetStatement&>(stmt);
+    auto name = let.name->value;
+    if (!unit().names) {
+      auto value = temp();
+      if (let.value->kind == Kind::FUNCTION) {
+        function(static_cast<const FunctionLiteral&>(*let.value), name, value);
+      } else {
+        expression_into(*let.value, value);
+      }
+      auto b = globals.define(name);
+      if (globals.definitions > CompileScope::MAX_GLOBALS) {
+        errors.push_back("too many globals");
+        break;
+      }
+      emit_bx(Opcode::SET_GLOBAL, value, b.index);
+      break;
+    }
+    // The register is claimed before the value is compiled, which may
+    // contain lets of its own, but the name is bound only after.
+    auto& scope = names();
+    auto reg    = scope.definitions++;
+    if (reg > std::numeric_limits<uint8_t>::max()) {
+      errors.push_back("too many registers");
+      break;
+    }
+    if (let.value->kind == Kind::FUNCTION) {
+      function(static_cast<const FunctionLiteral&>(*let.value), name, reg);
+    } else {
+      expression_into(*let.value, reg);
+    }
+    scope.store.insert_or_assign(
+        name, Binding{Scope::LOCAL, static_cast<uint16_t>(reg)});
+    break;
+  }
+  default: errors.push_back("unexpected statement {}"_format(stmt));
+  }
+  unit().top = mark;
+}
+
+uint8_t Compiler::expression(const Expression& e, uint8_t target) {
+  if (depth == MAX_NESTING) {
+    errors.push_back("nesting too deep");
+    return target;
+  }
+  ++depth;
+  auto mark = unit().top;
+  switch (e.kind) {
+  case Kind::IDENTIFIER: {
+    auto& ident = static_cast<const Identifier&>(e);
+    auto b      = names().resolve(ident.value);
+    if (!b) {
+      errors.push_back("identifier not found: {}"_format(ident.value.name()));
+      break;
+    }
+    switch (b->scope) {
+    case Scope::LOCAL: target = static_cast<uint8_t>(b->index); break;
+    case Scope::GLOBAL: emit_bx(Opcode::GET_GLOBAL, target, b->index); break;
+    case Scope::FREE: emit(Opcode::GET_FREE, target, b->index); break;
+    case Scope::FUNCTION: emit(Opcode::CURRENT_CLOSURE, target); break;
+    }
+    break;
+  }
+  case Kind::INTEGER:
+    emit_bx(Opcode::LOAD_CONSTANT,
+            target,
+            add_constant(Value::integer(
+                static_cast<const IntegerLiteral&>(e).value)));
+    break;
+  case Kind::BOOLEAN:
+    emit(static_cast<const monkey::Boolean&>(e).value ? Opcode::LOAD_TRUE
+                                                      : Opcode::LOAD_FALSE,
+         target);
+    break;
+  case Kind::PREFIX: {
+    auto& prefix = static_cast<const PrefixExpression&>(e);
+    auto right   = operand(*prefix.right);
+    emit(prefix.token.type == Token::Type::BANG ? Opcode::BANG : Opcode::MINUS,
+         target,
+         right);
+    break;
+  }
+  case Kind::INFIX: {
+    auto& infix = static_cast<const InfixExpression&>(e);
+    auto left   = operand(*infix.left);
+    auto right  = operand(*infix.right);
+    Opcode op{};
+    switch (infix.token.type) {
+    case Token::Type::PLUS: op = Opcode::ADD; break;
+    case Token::Type::MINUS: op = Opcode::SUB; break;
+    case Token::Type::ASTERISK: op = Opcode::MUL; break;
+    case Token::Type::SLASH: op = Opcode::DIV; break;
+    case Token::Type::LT: op = Opcode::LESS_THAN; break;
+    case Token::Type::GT: op = Opcode::GREATER_THAN; break;
+    case Token::Type::EQ: op = Opcode::EQUAL; break;
+    case Token::Type::NOT_EQ: op = Opcode::NOT_EQUAL; break;
+    default: errors.push_back("unknown operator {}"_format(infix.op));
+    }
+    emit(op, target, left, right);
+    break;
+  }
+  case Kind::IF: {
+    auto& ife = static_cast<const IfExpression&>(e);
+    auto jump_not_truthy =
+        emit_bx(Opcode::JUMP_NOT_TRUTHY, operand(*ife.condition), 0);
+    unit().top = mark;
+    block(ife.consequence->statements, target);
+    auto jump = emit_bx(Opcode::JUMP, 0, 0);
+    patch(jump_not_truthy, unit().code.size());
+    if (ife.alternative) {
+      block(ife.alternative->statements, target);
+    } else {
+      emit(Opcode::LOAD_NULL, target);
+    }
+    patch(jump, unit().code.size());
+    break;
+  }
+  case Kind::FUNCTION:
+    function(static_cast<const FunctionLiteral&>(e), Symbol{}, target);
+    break;
+  case Kind::CALL: {
+    // The callee and its arguments go in consecutive registers; the callee's
+    // frame starts just after the callee.
+    auto& call   = static_cast<const CallExpression&>(e);
+    auto callee  = temp();
+    expression_into(*call.function, callee);
+    for (auto* arg : call.arguments) expression_into(*arg, temp());
+    emit(Opcode::CALL, target, callee, static_cast<int>(call.arguments.size()));
+    break;
+  }
+  default: errors.push_back("unexpected expression {}"_format(e));
+  }
+  unit().top = mark;
+  --depth;
+  return target;
+}
+
+void Compiler::expression_into(const Expression& e, uint8_t target) {
+  auto reg = expression(e, target);
+  if (reg != target) emit(Opcode::MOVE, target, reg);
+}
+
+uint8_t Compiler::operand(const Expression& e) {
+  auto reg = temp();
+  auto at  = expression(e, reg);
+  // A local is read in place, so the temporary was not needed.
+  if (at != reg) --unit().top;
+  return at;
+}
+
+void Compiler::function(const FunctionLiteral& fn,
+                        Symbol name,
+                        uint8_t target) {
+  auto scope   = std::make_unique<CompileScope>();
+  scope->outer = &names();
+  units.push_back(Unit{{}, std::move(scope)});
+  auto& names = *unit().names;
+  if (name != Symbol{}) names.define_function_name(name);
+  for (auto& param : fn.parameters) names.define(param.value);
+  unit().top = unit().registers = fn.parameters.size() + count_lets(fn.body);
+
+  auto result = temp();
+  block(fn.body->statements, result);
+  emit(Opcode::RETURN, result);
+
+  auto body             = std::move(units.back());
+  units.pop_back();
+  auto* proto           = new Prototype{};
+  proto->code           = std::move(body.code);
+  proto->parameters     = static_cast<uint8_t>(fn.parameters.size());
+  proto->registers      = body.registers;
+  proto->captures       = std::move(body.names->free);
+  proto->source         = "{}"_format(fn);
+  emit_bx(Opcode::CLOSURE,
+          target,
+          add_constant({Value::Type::COMPILED_FUNCTION, proto}));
+}
+
+size_t Compiler::emit(Opcode op, int a, int b, int c) {
+  auto& code = unit().code;
+  code.push_back({op,
+                  static_cast<uint8_t>(a),
+                  static_cast<uint8_t>(b),
+                  static_cast<uint8_t>(c)});
+  return code.size() - 1;
+}
+
+size_t Compiler::emit_bx(Opcode op, int a, int bx) {
+  return emit(op, a, bx >> 8, bx & 0xff);
+}
+
+void Compiler::patch(size_t at, size_t target) {
+  // Jump targets are 16-bit instruction indices into the unit.
+  if (target > std::numeric_limits<uint16_t>::max()) {
+    errors.push_back("too much code");
+  }
+  auto& ins = unit().code[at];
+  ins.b     = static_cast<uint8_t>(target >> 8);
+  ins.c     = static_cast<uint8_t>(target);
+}
+
+uint16_t Compiler::add_constant(Value value) {
+  if (constants.size() > std::numeric_limits<uint16_t>::max()) {
+    errors.push_back("too many constants");
+  }
+  constants.push_back(std::move(value));
+  return static_cast<uint16_t>(constants.size() - 1);
+}
+
+uint8_t Compiler::temp() {
+  auto& u = unit();
+  if (u.top > std::numeric_limits<uint8_t>::max()) {
+    errors.push_back("too many registers");
+  }
+  u.registers = std::max(u.registers, u.top + 1);
+  return static_cast<uint8_t>(u.top++);
+}
+
+Compiler::Unit& Compiler::unit() {
+  return units.back();
+}
+
+CompileScope& Compiler::names() {
+  auto& scope = units.back().names;
+  return scope ? *scope : globals;
+}
+
+} // namespace monkey::reg
@@ -0,0 +1,243 @@
+#include <fmt/format.h>
+#include <monkey/evaluator.h>
+#include <monkey/register_vm.h>
+
+#include "dispatch.h"
+
+using namespace fmt::literals;
+using std::vector;
+
+namespace monkey::reg {
+
+using Type  = Value::Type;
+using Scope = Binding::Scope;
+
+static Token::Type token_of(Opcode op) {
+  switch (op) {
+  case Opcode::ADD: return Token::Type::PLUS;
+  case Opcode::SUB: return Token::Type::MINUS;
+  case Opcode::MUL: return Token::Type::ASTERISK;
+  case Opcode::DIV: return Token::Type::SLASH;
+  case Opcode::EQUAL: return Token::Type::EQ;
+  case Opcode::NOT_EQUAL: return Token::Type::NOT_EQ;
+  case Opcode::LESS_THAN: return Token::Type::LT;
+  case Opcode::GREATER_THAN: return Token::Type::GT;
+  default: return Token::Type::ILLEGAL;
+  }
+}
+
+VM::VM()
+    : stack(STACK_SIZE)
+    , globals(GLOBALS_SIZE)
+    , bound(GLOBALS_SIZE) {
+  frames.reserve(MAX_FRAMES);
+}
+
+Value VM::run(const Bytecode& bytecode) {
+  auto& constants = bytecode.constants;
+  auto& main      = bytecode.prototype();
+  auto* const end = stack.data() + stack.size();
+  // Registers above the current frame keep stale values until reused; this
+  // is how far they go.
+  Value* high{stack.data() + main.registers};
+  size_t count{0};
+  auto finish = [&](Value result) {
+    dispatched = count;
+    for (auto* slot = stack.data(); slot != high; ++slot) *slot = Value{};
+    frames.clear();
+    return result;
+  };
+
+  const object::Closure* closure{nullptr};
+  const Instruction* code{main.code.data()};
+  const Instruction* ip{code};
+  const Instruction* ins{nullptr};
+  Value* r{stack.data()};
+
+#define FETCH()                                                                \
+  do {                                                                         \
+    ins = ip++;                                                                \
+    ++count;                                                                   \
+  } while (0)
+#define OPCODE ins->op
+
+#if MONKEY_THREADED
+  static void* const targets[] = {
+      TARGET_ADDRESS(LOAD_CONSTANT),   TARGET_ADDRESS(LOAD_NULL),
+      TARGET_ADDRESS(LOAD_TRUE),       TARGET_ADDRESS(LOAD_FALSE),
+      TARGET_ADDRESS(MOVE),            TARGET_ADDRESS(GET_GLOBAL),
+      TARGET_ADDRESS(SET_GLOBAL),      TARGET_ADDRESS(GET_FREE),
+      TARGET_ADDRESS(CURRENT_CLOSURE), TARGET_ADDRESS(ADD),
+      TARGET_ADDRESS(SUB),             TARGET_ADDRESS(MUL),
+      TARGET_ADDRESS(DIV),             TARGET_ADDRESS(EQUAL),
+      TARGET_ADDRESS(NOT_EQUAL),       TARGET_ADDRESS(LESS_THAN),
+      TARGET_ADDRESS(GREATER_THAN),    TARGET_ADDRESS(MINUS),
+      TARGET_ADDRESS(BANG),            TARGET_ADDRESS(JUMP),
+      TARGET_ADDRESS(JUMP_NOT_TRUTHY), TARGET_ADDRESS(CLOSURE),
+      TARGET_ADDRESS(CALL),            TARGET_ADDRESS(RETURN),
+  };
+  static_assert(std::size(targets) == size_t(Opcode::RETURN) + 1);
+#endif
+
+  for (;;) {
+    FETCH();
+    switch (OPCODE) {
+    TARGET(LOAD_CONSTANT):
+      r[ins->a] = constants[ins->bx()];
+      NEXT();
+    TARGET(LOAD_NULL):
+      r[ins->a] = Value{};
+      NEXT();
+    TARGET(LOAD_TRUE):
+      r[ins->a] = Value::boolean(true);
+      NEXT();
+    TARGET(LOAD_FALSE):
+      r[ins->a] = Value::boolean(false);
+      NEXT();
+    TARGET(MOVE):
+      r[ins->a] = r[ins->b];
+      NEXT();
+    TARGET(GET_GLOBAL): {
+      auto index = ins->bx();
+      if (globals[index].type() == Type::NULL_ && !bound[index]) {
+        return finish(Value::error("identifier not found: {}"_format(
+            bytecode.globals[index].name())));
+      }
+      r[ins->a] = globals[index];
+      NEXT();
+    }
+    TARGET(SET_GLOBAL):
+      globals[ins->bx()] = r[ins->a];
+      bound[ins->bx()]   = true;
+      NEXT();
+    TARGET(GET_FREE):
+      r[ins->a] = closure->free[ins->b];
+      NEXT();
+    TARGET(CURRENT_CLOSURE):
+      r[ins->a] = r[-1];
+      NEXT();
+
+    TARGET(ADD):
+    TARGET(SUB):
+    TARGET(MUL):
+    TARGET(DIV):
+    TARGET(EQUAL):
+    TARGET(NOT_EQUAL):
+    TARGET(LESS_THAN):
+    TARGET(GREATER_THAN): {
+      auto &left = r[ins->b], &right = r[ins->c];
+      if (left.type() == Type::INTEGER && right.type() == Type::INTEGER) {
+        auto l = left.as_integer(), rr = right.as_integer();
+        auto& out = r[ins->a];
+        switch (ins->op) {
+        case Opcode::ADD:
+          out = Value::integer(wrapping_add(l, rr));
+          NEXT();
+        case Opcode::SUB:
+          out = Value::integer(wrapping_subtract(l, rr));
+          NEXT();
+        case Opcode::MUL:
+          out = Value::integer(wrapping_multiply(l, rr));
+          NEXT();
+        case Opcode::DIV:
+          if (rr == 0) break;
+          out = Value::integer(wrapping_divide(l, rr));
+          NEXT();
+        case Opcode::EQUAL: out = Value::boolean(l == rr); NEXT();
+        case Opcode::NOT_EQUAL: out = Value::boolean(l != rr); NEXT();
+        case Opcode::LESS_THAN: out = Value::boolean(l < rr); NEXT();
+        case Opcode::GREATER_THAN: out = Value::boolean(l > rr); NEXT();
+        default: break;
+        }
+      }
+      auto result = eval_infix(token_of(ins->op), left, right);
+      if (result.is_error()) return finish(std::move(result));
+      r[ins->a] = std::move(result);
+      NEXT();
+    }
+    TARGET(MINUS): {
+      auto& right = r[ins->b];
+      if (right.type() == Type::INTEGER) {
+        r[ins->a] = Value::integer(wrapping_negate(right.as_integer()));
+        NEXT();
+      }
+      auto result = eval_prefix(Token::Type::MINUS, right);
+      if (result.is_error()) return finish(std::move(result));
+      r[ins->a] = std::move(result);
+      NEXT();
+    }
+    TARGET(BANG):
+      r[ins->a] = Value::boolean(!r[ins->b].truthy());
+      NEXT();
+
+    TARGET(JUMP):
+      ip = code + ins->bx();
+      NEXT();
+    TARGET(JUMP_NOT_TRUTHY):
+      if (!r[ins->a].truthy()) ip = code + ins->bx();
+      NEXT();
+
+    TARGET(CLOSURE): {
+      auto& function = constants[ins->bx()];
+      auto& proto    = function.as<Prototype>();
+      vector<Value> free{};
+      free.reserve(proto.captures.size());
+      for (auto& capture : proto.captures) {
+        switch (capture.scope) {
+        case Scope::LOCAL: free.push_back(r[capture.index]); break;
+        case Scope::FREE: free.push_back(closure->free[capture.index]); break;
+        case Scope::FUNCTION: free.push_back(r[-1]); break;
+        case Scope::GLOBAL: break;
+        }
+      }
+      r[ins->a] = Value{Type::CLOSURE,
+                        new object::Closure{function, std::move(free)}};
+      NEXT();
+    }
+    TARGET(CALL): {
+      auto& callee = r[ins->b];
+      if (callee.type() != Type::CLOSURE) {
+        return finish(Value::error(
+            "not a function: {}"_format(type_name(callee.type()))));
+      }
+      auto& fn    = callee.as<object::Closure>();
+      auto& proto = fn.function.as<Prototype>();
+      if (proto.parameters != ins->c) {
+        return finish(
+            Value::error("wrong number of arguments: want={}, got={}"_format(
+                proto.parameters, ins->c)));
+      }
+      auto* base = &callee + 1;
+      if (frames.size() == MAX_FRAMES
+          || end - base < static_cast<ptrdiff_t>(proto.registers)) {
+        return finish(Value::error("stack overflow"));
+      }
+      high = std::max(high, base + proto.registers);
+      frames.push_back({closure, code, ip, r, &r[ins->a]});
+      closure = &fn;
+      code    = proto.code.data();
+      ip      = code;
+      r       = base;
+      NEXT();
+    }
+    TARGET(RETURN): {
+      if (frames.empty()) return finish(std::move(r[ins->a]));
+      auto& caller = frames.back();
+      // The result may land in the callee's own slot, which holds the
+      // closure this frame is running: move it out first.
+      auto result    = std::move(r[ins->a]);
+      *caller.result = std::move(result);
+      closure        = caller.closure;
+      code           = caller.code;
+      ip             = caller.ip;
+      r              = caller.base;
+      frames.pop_back();
+      NEXT();
+    }
+    }
+  }
+#undef FETCH
+#undef OPCODE
+}
+
+} // namespace monkey::reg
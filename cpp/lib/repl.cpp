@@ -2,9 +2,15 @@
 
 #include <fmt/color.h>
 #include <fmt/ostream.h>
+#include <monkey/closure_tree.h>
+#include <monkey/compiler.h>
 #include <monkey/evaluator.h>
 #include <monkey/parser.h>
+#include <monkey/register_vm.h>
+#include <monkey/stream_lexer.h>
+#include <monkey/vm.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include "monkey/lexer.h"
@@ -16,9 +22,11 @@ using std::ostream;
 using std::runtime_error;
 using std::string;
 using std::endl;
+using std::vector;
 using namespace fmt::literals;
 
-const auto PROMPT = ">> ";
+const auto PROMPT          = ">> ";
+const auto CONTINUE_PROMPT = ".. ";
 
 void print_parser_errors(ostream& out, const std::vector<string> &errors) {
   for (auto& err : errors) {
@@ -26,20 +34,99 @@ void print_parser_errors(ostream& out, const std::vector<string> &errors) {
   }
 }
 
-void start(istream& in, ostream& out) {
+/// How far `type` opens (+1) or closes (-1) a bracketed construct.
+int nesting(Token::Type type) {
+  switch (type) {
+  case Token::Type::LPAREN:
+  case Token::Type::LBRACE: return 1;
+  case Token::Type::RPAREN:
+  case Token::Type::RBRACE: return -1;
+  default: return 0;
+  }
+}
+
+void start(istream& in, ostream& out, Engine engine) {
+  StreamLexer lexer{};
+  vector<Token> tokens{};
+  int depth{0};
+  auto env = std::make_shared<object::Environment>();
+  // Functions made by eval point into the trees they were defined in, and
+  // the closure tree's into the code lowered from them, so the lines that
+  // have a function literal are kept. No other value points into a line,
+  // and the VMs' functions are bytecode, so the rest are dropped.
+  vector<Program> programs{};
+  vector<closure::Tree> trees{};
+  bool has_functions{false};
+  // The VM's globals, like `env`, carry over from line to line.
+  Compiler compiler{};
+  VM vm{};
+  reg::Compiler reg_compiler{};
+  reg::VM reg_vm{};
+  auto run = [&](const Program& program) {
+    auto compile = [&](auto& compiler, auto& vm) {
+      auto bytecode = compiler.compile(program);
+      if (!compiler.errors.empty()) {
+        auto error = Value::error(compiler.errors.front());
+        compiler.errors.clear();
+        return error;
+      }
+      return vm.run(bytecode);
+    };
+    switch (engine) {
+    case Engine::EVAL: break;
+    case Engine::VM: return compile(compiler, vm);
+    case Engine::REGISTER_VM: return compile(reg_compiler, reg_vm);
+    case Engine::CLOSURES: {
+      closure::Tree tree{program};
+      auto result = tree.run(env);
+      if (has_functions) trees.push_back(std::move(tree));
+      return result;
+    }
+    }
+    return eval(program, env);
+  };
+
   out << PROMPT;
   string line;
   while (std::getline(in, line)) {
-    Lexer lex{line};
-    Parser parser{lex};
+    lexer.push(line);
+    lexer.push("\n");
+    while (auto token = lexer.poll()) {
+      depth += nesting(token->type);
+      tokens.push_back(std::move(*token));
+    }
+    // Keep reading while a function body or argument list is still open.
+    if (depth > 0) {
+      out << CONTINUE_PROMPT;
+      continue;
+    }
+
+    has_functions = std::any_of(tokens.begin(), tokens.end(), [](auto& t) {
+      return t.type == Token::Type::FUNCTION;
+    });
+    TokenStream stream{tokens};
+    tokens.clear();
+    depth = 0;
+    Parser parser{stream};
     Program program = parser.parse_program();
     if (!parser.errors.empty()) {
       print_parser_errors(out, parser.errors);
       out << PROMPT;
       continue;
     }
-    out << *eval(program) << endl << PROMPT;
+    auto result = run(program);
+    // Like the book's REPL, bindings print nothing.
+    if (!program.statements.empty()
+        && program.statements.back()->kind != Node::Kind::LET) {
+      out << result << endl;
+    }
+    if (has_functions
+        && (engine == Engine::EVAL || engine == Engine::CLOSURES)) {
+      programs.push_back(std::move(program));
+    }
+    out << PROMPT;
   }
+  env->clear_globals();
   if (in.bad()) { throw runtime_error{"error reading input"}; }
   out << "\n";
 }
@@ -0,0 +1,347 @@
+#include "monkey/resolver.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+using std::deque;
+using std::unordered_map;
+using std::vector;
+
+namespace monkey {
+
+using Kind  = Node::Kind;
+using Scope = Identifier::Scope;
+
+namespace {
+
+struct Function;
+
+/// A parameter, or every let of one name in a function.
+struct Variable {
+  Function* owner;
+  /// Whether a nested function uses it, so it needs a cell.
+  bool captured{false};
+  uint32_t index{0};
+};
+
+/// The names of one function being resolved.
+struct Function {
+  FunctionLiteral* literal;
+  Function* outer;
+  /// Parameters and every let in the body, nested blocks included.
+  unordered_map<Symbol, Variable*> all{};
+  /// Parameters and the lets resolved so far.
+  unordered_map<Symbol, Variable*> bound{};
+  /// In the order they are bound, parameters first.
+  vector<Variable*> variables{};
+  /// Free variables, in the order of the closure's captures.
+  vector<Variable*> captures{};
+  unordered_map<Variable*, uint32_t> capture_index{};
+};
+
+/// A name referring to `variable`, from the body of `from`.
+struct Use {
+  Identifier* ident;
+  Function* from;
+  Variable* variable;
+};
+
+/// A node to visit, or with `after` set, to finish once its children have
+/// been. The tree is walked with an explicit stack so nesting depth is
+/// bounded by memory rather than the native stack.
+struct Step {
+  Node* node;
+  bool after{false};
+};
+
+/// Pushes the children of `node` that are always visited, last first, so
+/// they pop in source order. Lets and functions need more than a visit and
+/// are left to the caller.
+void push_children(vector<Step>& steps, Node& node) {
+  switch (node.kind) {
+  case Kind::RETURN:
+    steps.push_back({static_cast<ReturnStatement&>(node).return_value});
+    break;
+  case Kind::EXPRESSION:
+    steps.push_back({static_cast<ExpressionStatement&>(node).expression});
+    break;
+  case Kind::PROGRAM: {
+    auto& stmts = static_cast<Program&>(node).statements;
+    for (auto it = stmts.rbegin(); it != stmts.rend(); ++it) {
+      steps.push_back({*it});
+    }
+    break;
+  }
+  case Kind::BLOCK: {
+    auto& stmts = static_cast<BlockStatement&>(node).statements;
+    for (auto it = stmts.rbegin(); it != stmts.rend(); ++it) {
+      steps.push_back({*it});
+    }
+    break;
+  }
+  case Kind::PREFIX:
+    steps.push_back({static_cast<PrefixExpression&>(node).right});
+    break;
+  case Kind::INFIX: {
+    auto& infix = static_cast<InfixExpression&>(node);
+    steps.push_back({infix.right});
+    steps.push_back({infix.left});
+    break;
+  }
+  case Kind::IF: {
+    auto& ife = static_cast<IfExpression&>(node);
+    steps.push_back({ife.alternative});
+    steps.push_back({ife.consequence});
+    steps.push_back({ife.condition});
+    break;
+  }
+  case Kind::CALL: {
+    auto& call = static_cast<CallExpression&>(node);
+    auto& args = call.arguments;
+    for (auto it = args.rbegin(); it != args.rend(); ++it) {
+      steps.push_back({*it});
+    }
+    steps.push_back({call.function});
+    break;
+  }
+  case Kind::LET:
+  case Kind::FUNCTION:
+  case Kind::IDENTIFIER:
+  case Kind::INTEGER:
+  case Kind::BOOLEAN: break;
+  }
+}
+
+struct Resolver {
+  Arena& arena;
+  deque<Function> functions{};
+  deque<Variable> variables{};
+  vector<Function*> scopes{};
+  vector<Use> uses{};
+
+  Variable* declare(Function& fn, Symbol name) {
+    auto [it, added] = fn.all.try_emplace(name, nullptr);
+    if (added) {
+      it->second = &variables.emplace_back(Variable{&fn});
+      fn.variables.push_back(it->second);
+    }
+    return it->second;
+  }
+
+  /// Adds the lets in `node`, outside nested functions, to `fn`.
+  void collect(Function& fn, Node* node) {
+    vector<Step> steps{{node}};
+    while (!steps.empty()) {
+      auto [at, after] = steps.back();
+      steps.pop_back();
+      if (!at) continue;
+      if (at->kind == Kind::LET) {
+        auto& let = static_cast<LetStatement&>(*at);
+        if (after) {
+          if (let.name) declare(fn, let.name->value);
+        } else {
+          steps.push_back({at, true});
+          steps.push_back({let.value});
+        }
+      } else if (at->kind != Kind::FUNCTION) {
+        push_children(steps, *at);
+      }
+    }
+  }
+
+  void identifier(Identifier& ident) {
+    ident.scope = Scope::GLOBAL;
+    for (size_t depth{0}; depth < scopes.size(); ++depth) {
+      auto* fn    = scopes[scopes.size() - 1 - depth];
+      auto& names = depth == 0 ? fn->bound : fn->all;
+      auto found  = names.find(ident.value);
+      if (found == names.end()) continue;
+
+      // Every function between the one binding the variable and this one
+      // captures it, so each closure can copy it from the call making it.
+      auto* var = found->second;
+      if (depth > 0) var->captured = true;
+      for (size_t i{scopes.size() - depth}; i < scopes.size(); ++i) {
+        auto& inner = *scopes[i];
+        auto next   = static_cast<uint32_t>(inner.captures.size());
+        if (inner.capture_index.try_emplace(var, next).second) {
+          inner.captures.push_back(var);
+        }
+      }
+      uses.push_back({&ident, scopes.back(), var});
+      return;
+    }
+  }
+
+  void enter(FunctionLiteral& literal) {
+    auto& fn = functions.emplace_back(
+        Function{&literal, scopes.empty() ? nullptr : scopes.back()});
+    for (auto& param : literal.parameters) {
+      auto* var = declare(fn, param.value);
+      uses.push_back({&param, &fn, var});
+    }
+    fn.bound = fn.all;
+    collect(fn, literal.body);
+    scopes.push_back(&fn);
+  }
+
+  void leave(FunctionLiteral& literal) {
+    scopes.pop_back();
+    tail(literal.body);
+  }
+
+  /// Marks the calls in `node` whose value would be the function's.
+  void tail(Node* node) {
+    vector<Node*> pending{node};
+    while (!pending.empty()) {
+      auto* at = pending.back();
+      pending.pop_back();
+      if (!at) continue;
+      switch (at->kind) {
+      case Kind::CALL: static_cast<CallExpression&>(*at).tail = true; break;
+      case Kind::EXPRESSION:
+        pending.push_back(static_cast<ExpressionStatement&>(*at).expression);
+        break;
+      case Kind::BLOCK: {
+        auto& stmts = static_cast<BlockStatement&>(*at).statements;
+        if (!stmts.empty()) pending.push_back(stmts.back());
+        break;
+      }
+      case Kind::IF: {
+        auto& ife = static_cast<IfExpression&>(*at);
+        pending.push_back(ife.consequence);
+        pending.push_back(ife.alternative);
+        break;
+      }
+      default: break;
+      }
+    }
+  }
+
+  void resolve(Node* node) {
+    vector<Step> steps{{node}};
+    while (!steps.empty()) {
+      auto [at, after] = steps.back();
+      steps.pop_back();
+      if (!at) continue;
+      switch (at->kind) {
+      case Kind::LET: {
+        auto& let = static_cast<LetStatement&>(*at);
+        if (!after) {
+          steps.push_back({at, true});
+          steps.push_back({let.value});
+        } else if (let.name) {
+          bind(let);
+        }
+        break;
+      }
+      case Kind::RETURN: {
+        auto* value = static_cast<ReturnStatement&>(*at).return_value;
+        if (!scopes.empty()) tail(value);
+        steps.push_back({value});
+        break;
+      }
+      case Kind::IDENTIFIER:
+        identifier(static_cast<Identifier&>(*at));
+        at->operator_depth = 0;
+        break;
+      case Kind::INTEGER:
+      case Kind::BOOLEAN: at->operator_depth = 0; break;
+      case Kind::PREFIX:
+      case Kind::INFIX:
+        if (after) {
+          operator_depth(*at);
+        } else {
+          steps.push_back({at, true});
+          push_children(steps, *at);
+        }
+        break;
+      case Kind::FUNCTION: {
+        auto& literal = static_cast<FunctionLiteral&>(*at);
+        if (after) {
+          leave(literal);
+        } else {
+          enter(literal);
+          steps.push_back({at, true});
+          steps.push_back({literal.body});
+        }
+        break;
+      }
+      default: push_children(steps, *at);
+      }
+    }
+  }
+
+  /// Sets the depth of an operator node whose operands are done. A missing
+  /// operand, left by a parse error, counts as opaque.
+  static void operator_depth(Node& node) {
+    auto depth = [](const Node* operand) {
+      return operand ? operand->operator_depth : Node::OPAQUE;
+    };
+    uint8_t below{0};
+    if (node.kind == Kind::INFIX) {
+      auto& infix = static_cast<InfixExpression&>(node);
+      below       = std::max(depth(infix.left), depth(infix.right));
+    } else {
+      below = depth(static_cast<PrefixExpression&>(node).right);
+    }
+    node.operator_depth = below >= Node::OPAQUE - 1 ? Node::OPAQUE : below + 1;
+  }
+
+  void bind(LetStatement& let) {
+    if (scopes.empty()) {
+      let.name->scope = Scope::GLOBAL;
+      return;
+    }
+    auto& fn  = *scopes.back();
+    auto* var = fn.all.at(let.name->value);
+    fn.bound.insert_or_assign(let.name->value, var);
+    uses.push_back({let.name, &fn, var});
+  }
+
+  /// Where `var` is found from the body of `from`.
+  Capture address(const Function& from, Variable* var) const {
+    if (var->owner != &from) {
+      return {Scope::CAPTURE, from.capture_index.at(var)};
+    }
+    return {var->captured ? Scope::CELL : Scope::LOCAL, var->index};
+  }
+
+  /// Once every use is known, lays out each function's slots, cells and
+  /// captures and writes the addresses into the tree.
+  void finish() {
+    for (auto& fn : functions) {
+      uint32_t slots{0};
+      uint32_t cells{0};
+      for (auto* var : fn.variables) {
+        var->index = var->captured ? cells++ : slots++;
+      }
+      fn.literal->slots = slots;
+      fn.literal->cells = cells;
+    }
+    for (auto& use : uses) {
+      auto at          = address(*use.from, use.variable);
+      use.ident->scope = at.scope;
+      use.ident->index = at.index;
+    }
+    for (auto& fn : functions) {
+      vector<Capture> captures{};
+      for (auto* var : fn.captures) {
+        captures.push_back(address(*fn.outer, var));
+      }
+      fn.literal->captures = arena.copy(captures);
+    }
+  }
+};
+
+} // namespace
+
+void resolve(Program& program) {
+  Resolver resolver{*program.arena};
+  resolver.resolve(&program);
+  resolver.finish();
+}
+
+} // namespace monkey
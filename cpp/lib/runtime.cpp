@@ -0,0 +1,77 @@
+#include "monkey/runtime.h"
+
+#include <fmt/format.h>
+#include <pthread.h>
+
+#include <iostream>
+
+using std::vector;
+
+namespace monkey::runtime {
+
+using namespace fmt::literals;
+
+/// Native frames are bigger than eval's heap-allocated ones, so programs
+/// get a generous stack, reserved but only touched as deep as they go.
+constexpr size_t STACK_SIZE = size_t{1} << 30;
+
+Value unbound(const Global& global) {
+  return Value::error("identifier not found: {}"_format(global.name));
+}
+
+Value function(NativeFunction::Code code,
+               size_t parameters,
+               const char* source,
+               vector<Cell> captures) {
+  return {Value::Type::NATIVE,
+          new NativeFunction{code, parameters, source, std::move(captures)}};
+}
+
+Value call(const Value& callee, Value* args, size_t count) {
+  if (callee.type() != Value::Type::NATIVE) {
+    return Value::error("not a function: {}"_format(type_name(callee.type())));
+  }
+  auto& fn = callee.as<NativeFunction>();
+  if (fn.parameters != count) {
+    return Value::error(
+        "wrong number of arguments: want={}, got={}"_format(fn.parameters,
+                                                             count));
+  }
+  auto result      = fn.code(fn, args);
+  result.returning = false;
+  return result;
+}
+
+int main(Value (*program)()) {
+  struct Run {
+    Value (*program)();
+    Value result{};
+  } run{program};
+  auto body = [](void* arg) -> void* {
+    auto& run  = *static_cast<Run*>(arg);
+    run.result = run.program();
+    return nullptr;
+  };
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, STACK_SIZE);
+  pthread_t thread;
+  if (pthread_create(&thread, &attr, body, &run) == 0) {
+    pthread_join(thread, nullptr);
+  } else {
+    body(&run);
+  }
+  pthread_attr_destroy(&attr);
+
+  if (run.result.is_error()) {
+    std::cerr << run.result << std::endl;
+    return 1;
+  }
+  if (run.result.type() != Value::Type::NULL_) {
+    std::cout << run.result << std::endl;
+  }
+  return 0;
+}
+
+} // namespace monkey::runtime
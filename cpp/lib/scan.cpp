@@ -0,0 +1,145 @@
+#include "monkey/scan.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace monkey::scan {
+
+//<editor-fold desc="scalar">
+const char* scalar::skip_whitespace(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+  return p;
+}
+
+const char* scalar::skip_letters(const char* p, const char* end) {
+  while (p < end
+         && (('a' <= *p && *p <= 'z') || ('A' <= *p && *p <= 'Z') || *p == '_'))
+    ++p;
+  return p;
+}
+
+const char* scalar::skip_digits(const char* p, const char* end) {
+  while (p < end && '0' <= *p && *p <= '9') ++p;
+  return p;
+}
+//</editor-fold>
+
+#if defined(__AVX2__)
+
+using Block         = __m256i;
+constexpr int BLOCK = 32;
+inline Block load(const char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+inline Block splat(char c) {
+  return _mm256_set1_epi8(c);
+}
+inline Block eq(Block a, Block b) {
+  return _mm256_cmpeq_epi8(a, b);
+}
+inline Block gt(Block a, Block b) {
+  return _mm256_cmpgt_epi8(a, b);
+}
+inline Block either(Block a, Block b) {
+  return _mm256_or_si256(a, b);
+}
+inline Block both(Block a, Block b) {
+  return _mm256_and_si256(a, b);
+}
+inline unsigned mask(Block a) {
+  return static_cast<unsigned>(_mm256_movemask_epi8(a));
+}
+constexpr unsigned FULL = 0xffffffffu;
+
+#elif defined(__SSE2__)
+
+using Block         = __m128i;
+constexpr int BLOCK = 16;
+inline Block load(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+inline Block splat(char c) {
+  return _mm_set1_epi8(c);
+}
+inline Block eq(Block a, Block b) {
+  return _mm_cmpeq_epi8(a, b);
+}
+inline Block gt(Block a, Block b) {
+  return _mm_cmpgt_epi8(a, b);
+}
+inline Block either(Block a, Block b) {
+  return _mm_or_si128(a, b);
+}
+inline Block both(Block a, Block b) {
+  return _mm_and_si128(a, b);
+}
+inline unsigned mask(Block a) {
+  return static_cast<unsigned>(_mm_movemask_epi8(a));
+}
+constexpr unsigned FULL = 0xffffu;
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+/// Signed byte compares are enough for the ranges below: bytes >= 0x80 are
+/// negative and so never fall inside them.
+inline Block in_range(Block c, char lo, char hi) {
+  return both(gt(c, splat(lo - 1)), gt(splat(hi + 1), c));
+}
+
+/// Advances over whole blocks while `classify` accepts every byte, then hands
+/// the first block with a rejected byte (or the tail) to the scalar loop.
+template <class Classify>
+const char* skip(const char* p, const char* end, Classify classify) {
+  while (end - p >= BLOCK) {
+    unsigned m = mask(classify(load(p)));
+    if (m != FULL) return p + __builtin_ctz(~m);
+    p += BLOCK;
+  }
+  return p;
+}
+
+const char* skip_whitespace(const char* p, const char* end) {
+  p = skip(p, end, [](Block c) {
+    return either(either(eq(c, splat(' ')), eq(c, splat('\t'))),
+                  either(eq(c, splat('\n')), eq(c, splat('\r'))));
+  });
+  return scalar::skip_whitespace(p, end);
+}
+
+const char* skip_letters(const char* p, const char* end) {
+  p = skip(p, end, [](Block c) {
+    // Setting 0x20 folds 'A'-'Z' onto 'a'-'z' without pulling any other byte
+    // into that range.
+    return either(in_range(either(c, splat(0x20)), 'a', 'z'),
+                  eq(c, splat('_')));
+  });
+  return scalar::skip_letters(p, end);
+}
+
+const char* skip_digits(const char* p, const char* end) {
+  p = skip(p, end, [](Block c) { return in_range(c, '0', '9'); });
+  return scalar::skip_digits(p, end);
+}
+
+#else
+
+const char* skip_whitespace(const char* p, const char* end) {
+  return scalar::skip_whitespace(p, end);
+}
+
+const char* skip_letters(const char* p, const char* end) {
+  return scalar::skip_letters(p, end);
+}
+
+const char* skip_digits(const char* p, const char* end) {
+  return scalar::skip_digits(p, end);
+}
+
+#endif
+
+} // namespace monkey::scan
@@ -0,0 +1,66 @@
+#include "monkey/source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+using std::string;
+using std::string_view;
+using std::system_error;
+
+namespace monkey {
+
+system_error os_error(const string& what) {
+  return system_error{errno, std::generic_category(), what};
+}
+
+MappedFile::MappedFile(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) throw os_error(path);
+
+  struct stat st {};
+  if (fstat(fd, &st) < 0) {
+    auto err = os_error(path);
+    close(fd);
+    throw err;
+  }
+  size = static_cast<size_t>(st.st_size);
+
+  // mmap rejects empty mappings; an empty script is just an empty view.
+  if (size > 0) {
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      auto err = os_error(path);
+      close(fd);
+      throw err;
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(addr);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data) munmap(const_cast<char*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data{std::exchange(other.data, nullptr)}
+    , size{std::exchange(other.size, 0)} { }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  std::swap(data, other.data);
+  std::swap(size, other.size);
+  return *this;
+}
+
+string_view MappedFile::view() const {
+  return {data, size};
+}
+
+} // namespace monkey
@@ -0,0 +1,59 @@
+#include "monkey/stream_lexer.h"
+
+#include <monkey/lexer.h>
+
+#include <stdexcept>
+
+using std::optional;
+using std::string_view;
+
+namespace monkey {
+
+/// Whether more input could extend `token` into a different token.
+bool may_continue(const TokenView& token) {
+  char last = token.literal.back();
+  return is_letter(last) || is_digit(last) || token.type == Token::Type::ASSIGN
+         || token.type == Token::Type::BANG;
+}
+
+void StreamLexer::push(string_view chunk) {
+  if (closed) throw std::logic_error{"push to a closed StreamLexer"};
+  pending.append(chunk);
+  drain();
+}
+
+void StreamLexer::close() {
+  if (closed) return;
+  closed = true;
+  drain();
+}
+
+optional<Token> StreamLexer::poll() {
+  if (ready.empty()) return std::nullopt;
+  auto token = std::move(ready.front());
+  ready.pop_front();
+  return token;
+}
+
+void StreamLexer::drain() {
+  Lexer lex{string_view{pending}};
+  size_t consumed{0};
+  for (;;) {
+    auto token = lex.next_view();
+    size_t start = token.literal.data() - pending.data();
+    if (token.type == Token::Type::EOF_) {
+      consumed = pending.size();
+      if (closed) ready.emplace_back(token);
+      break;
+    }
+    if (!closed && start + token.literal.size() == pending.size()
+        && may_continue(token)) {
+      consumed = start;
+      break;
+    }
+    ready.emplace_back(token);
+  }
+  pending.erase(0, consumed);
+}
+
+} // namespace monkey
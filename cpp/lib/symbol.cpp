@@ -0,0 +1,84 @@
+#include "monkey/symbol.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+using std::string;
+using std::string_view;
+
+namespace monkey {
+
+struct SymbolTable {
+  /// Names are kept in chunks that double in size and are never moved or
+  /// freed, so a name can be read without a lock while others are added.
+  /// Chunk k holds FIRST << k names; together they cover every id.
+  static constexpr size_t FIRST  = 64;
+  static constexpr size_t CHUNKS = 27;
+  std::array<std::unique_ptr<string[]>, CHUNKS> chunks{};
+  /// How many names are complete. Stored with release after each is added.
+  std::atomic<uint32_t> size{0};
+  /// Parsers on several threads intern concurrently.
+  std::shared_mutex mutex{};
+  std::unordered_map<string_view, uint32_t> ids{};
+
+  SymbolTable() { add(""); }
+
+  static SymbolTable& global() {
+    static SymbolTable table{};
+    return table;
+  }
+
+  string& at(uint32_t id) const {
+    auto chunk = std::bit_width(id / FIRST + 1) - 1;
+    return chunks[chunk][id - FIRST * ((size_t{1} << chunk) - 1)];
+  }
+
+  /// Adds `name`, which is not interned yet. The caller holds the lock.
+  uint32_t add(string_view name) {
+    auto id    = size.load(std::memory_order_relaxed);
+    auto chunk = std::bit_width(id / FIRST + 1) - 1;
+    if (!chunks[chunk]) {
+      chunks[chunk] = std::make_unique<string[]>(FIRST << chunk);
+    }
+    auto& stored = at(id);
+    stored       = name;
+    ids.emplace(stored, id);
+    size.store(id + 1, std::memory_order_release);
+    return id;
+  }
+};
+
+Symbol Symbol::intern(string_view name) {
+  auto& table = SymbolTable::global();
+  {
+    std::shared_lock lock{table.mutex};
+    auto it = table.ids.find(name);
+    if (it != table.ids.end()) return Symbol{it->second};
+  }
+
+  std::unique_lock lock{table.mutex};
+  auto it = table.ids.find(name);
+  if (it != table.ids.end()) return Symbol{it->second};
+  return Symbol{table.add(name)};
+}
+
+string_view Symbol::name() const {
+  auto& table = SymbolTable::global();
+  // Pairs with the store in add(), so the name is seen complete.
+  [[maybe_unused]] auto size = table.size.load(std::memory_order_acquire);
+  assert(id < size);
+  return table.at(id);
+}
+
+std::ostream& operator<<(std::ostream& out, Symbol symbol) {
+  return out << symbol.name();
+}
+
+} // namespace monkey
@@ -0,0 +1,90 @@
+#include "monkey/token_stream.h"
+
+#include <limits>
+#include <stdexcept>
+
+using std::string_view;
+
+namespace monkey {
+
+TokenStream::TokenStream(string_view source)
+    : src{source} {
+  Lexer lexer{source};
+  tokenize(lexer);
+}
+
+TokenStream::TokenStream(Lexer& lexer)
+    : src{lexer.source()} {
+  tokenize(lexer);
+}
+
+TokenStream::TokenStream(const std::vector<Token>& tokens)
+    : text{std::make_unique<std::string>()} {
+  for (auto& token : tokens) {
+    if (!text->empty()) *text += ' ';
+    *text += token.literal;
+  }
+  src = *text;
+
+  size_t offset{0};
+  for (auto& token : tokens) {
+    push({token.type, src.substr(offset, token.literal.size())});
+    offset += token.literal.size() + 1;
+  }
+  if (tokens.empty() || tokens.back().type != Token::Type::EOF_) {
+    push({Token::Type::EOF_, src.substr(src.size(), 0)});
+  }
+}
+
+void TokenStream::tokenize(Lexer& lexer) {
+  if (src.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error{"source too large for a token stream"};
+  }
+  // Roughly one token per four bytes of typical source.
+  auto guess = src.size() / 4 + 1;
+  types.reserve(guess);
+  offsets.reserve(guess);
+  lengths.reserve(guess);
+
+  for (;;) {
+    auto token = lexer.next_view();
+    push(token);
+    if (token.type == Token::Type::EOF_) break;
+  }
+}
+
+void TokenStream::push(const TokenView& token) {
+  types.push_back(static_cast<uint8_t>(token.type));
+  offsets.push_back(static_cast<uint32_t>(token.literal.data() - src.data()));
+  lengths.push_back(static_cast<uint32_t>(token.literal.size()));
+}
+
+size_t TokenStream::size() const {
+  return types.size();
+}
+
+Token::Type TokenStream::type(size_t i) const {
+  if (i >= types.size()) return Token::Type::EOF_;
+  return static_cast<Token::Type>(types[i]);
+}
+
+string_view TokenStream::literal(size_t i) const {
+  if (i >= types.size()) return src.substr(src.size(), 0);
+  return src.substr(offsets[i], lengths[i]);
+}
+
+TokenView TokenStream::operator[](size_t i) const {
+  return {type(i), literal(i)};
+}
+
+string_view TokenStream::source() const {
+  return src;
+}
+
+size_t TokenStream::memory() const {
+  return types.capacity() * sizeof(uint8_t)
+         + offsets.capacity() * sizeof(uint32_t)
+         + lengths.capacity() * sizeof(uint32_t);
+}
+
+} // namespace monkey
@@ -0,0 +1,449 @@
+#include "monkey/transpiler.h"
+
+#include <fmt/format.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+using std::span;
+using std::string;
+using std::string_view;
+using std::vector;
+
+extern char** environ;
+
+namespace monkey {
+
+using namespace fmt::literals;
+using Kind  = Node::Kind;
+using Scope = Identifier::Scope;
+
+namespace {
+
+string_view operator_name(Token::Type op) {
+  switch (op) {
+  case Token::Type::PLUS: return "PLUS";
+  case Token::Type::MINUS: return "MINUS";
+  case Token::Type::BANG: return "BANG";
+  case Token::Type::ASTERISK: return "ASTERISK";
+  case Token::Type::SLASH: return "SLASH";
+  case Token::Type::LT: return "LT";
+  case Token::Type::GT: return "GT";
+  case Token::Type::EQ: return "EQ";
+  case Token::Type::NOT_EQ: return "NOT_EQ";
+  default: return "ILLEGAL";
+  }
+}
+
+/// `text` as a C++ string literal.
+string quote(string_view text) {
+  string quoted{"\""};
+  for (auto c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (c == '\n') {
+      quoted += "\\n";
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + '"';
+}
+
+/// Whether `expr` is a single C++ name, so it can be used more than once.
+bool is_name(string_view expr) {
+  for (auto c : expr) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+  }
+  return true;
+}
+
+/// A temporary is moved from where it is used last; anything else is
+/// copied or used as it is.
+string take(const string& expr) {
+  return expr[0] == 't' && is_name(expr) ? "std::move({})"_format(expr)
+                                          : expr;
+}
+
+/// The C++ of one function's body, or of the top level.
+struct Body {
+  const FunctionLiteral* literal{nullptr};
+  string code{};
+  int indent{1};
+  size_t temps{0};
+  /// Whether a tail call restarts the call, which needs a label to go to.
+  bool restarts{false};
+};
+
+struct Transpiler {
+  std::unordered_map<Symbol, size_t> global_index{};
+  vector<Symbol> globals{};
+  /// Definitions of the functions emitted so far.
+  vector<string> functions{};
+
+  void line(Body& b, string_view text) {
+    b.code.append(2 * b.indent, ' ');
+    b.code += text;
+    b.code += '\n';
+  }
+
+  /// A new null temporary.
+  string temporary(Body& b) {
+    auto name = "t{}"_format(b.temps++);
+    line(b, "Value {};"_format(name));
+    return name;
+  }
+
+  /// `expr` as a name, putting it in a temporary if it isn't one already.
+  string name(Body& b, const string& expr) {
+    if (is_name(expr)) return expr;
+    auto name = "t{}"_format(b.temps++);
+    line(b, "Value {} = {};"_format(name, expr));
+    return name;
+  }
+
+  string global(Symbol symbol) {
+    auto [it, added] = global_index.try_emplace(symbol, globals.size());
+    if (added) globals.push_back(symbol);
+    return "g{}"_format(it->second);
+  }
+
+  /// Where `ident` lives, as an lvalue.
+  string variable(const Identifier& ident) {
+    switch (ident.scope) {
+    case Scope::LOCAL: return "s{}"_format(ident.index);
+    case Scope::CELL: return "(*c{})"_format(ident.index);
+    case Scope::CAPTURE: return "(*self.captures[{}])"_format(ident.index);
+    case Scope::GLOBAL: break;
+    }
+    return "get({})"_format(global(ident.value));
+  }
+
+  /// Emits what evaluating `node` takes, returning a C++ expression for
+  /// its value to be used once.
+  string expression(Body& b, const Expression& node) {
+    switch (node.kind) {
+    case Kind::INTEGER:
+      return "Value::integer({})"_format(
+          static_cast<const IntegerLiteral&>(node).value);
+    case Kind::BOOLEAN:
+      return "Value::boolean({})"_format(
+          static_cast<const Boolean&>(node).value);
+    case Kind::IDENTIFIER:
+      return variable(static_cast<const Identifier&>(node));
+    case Kind::PREFIX: {
+      auto& prefix = static_cast<const PrefixExpression&>(node);
+      auto right   = expression(b, *prefix.right);
+      return "prefix<Token::Type::{}>({})"_format(
+          operator_name(prefix.token.type), right);
+    }
+    case Kind::INFIX: {
+      auto& infix = static_cast<const InfixExpression&>(node);
+      // Names are read after the right operand is evaluated, but nothing
+      // it runs can assign them.
+      auto left  = name(b, expression(b, *infix.left));
+      auto right = expression(b, *infix.right);
+      return "infix<Token::Type::{}>({}, {})"_format(
+          operator_name(infix.token.type), left, right);
+    }
+    case Kind::IF:
+      return if_expression(b, static_cast<const IfExpression&>(node));
+    case Kind::FUNCTION:
+      return function(static_cast<const FunctionLiteral&>(node));
+    case Kind::CALL: return call(b, static_cast<const CallExpression&>(node));
+    default: return "Value{}";
+    }
+  }
+
+  string if_expression(Body& b, const IfExpression& ife) {
+    auto condition = name(b, expression(b, *ife.condition));
+    auto value     = temporary(b);
+    line(b, "if ({}.is_error()) {{"_format(condition));
+    line(b, "  {} = {};"_format(value, take(condition)));
+    line(b, "}} else if ({}.truthy()) {{"_format(condition));
+    ++b.indent;
+    block(b, ife.consequence->statements, value);
+    --b.indent;
+    if (ife.alternative) {
+      line(b, "} else {");
+      ++b.indent;
+      block(b, ife.alternative->statements, value);
+      --b.indent;
+    }
+    line(b, "}");
+    return value;
+  }
+
+  /// Evaluates the callee and then each argument, stopping at the first
+  /// error, and makes the call.
+  string call(Body& b, const CallExpression& call) {
+    auto value = temporary(b);
+    line(b, "do {");
+    ++b.indent;
+    auto callee = name(b, expression(b, *call.function));
+    auto stop = [&](const string& at) {
+      line(b, "if ({}.is_error()) {{"_format(at));
+      line(b, "  {} = {};"_format(value, take(at)));
+      line(b, "  break;");
+      line(b, "}");
+    };
+    stop(callee);
+    vector<string> args{};
+    for (auto* arg : call.arguments) {
+      stop(args.emplace_back(name(b, expression(b, *arg))));
+    }
+    if (call.tail && b.literal
+        && args.size() == b.literal->parameters.size()) {
+      b.restarts = true;
+      line(b, "if (is_self({}, self, {})) {{"_format(callee, args.size()));
+      for (size_t i{0}; i < args.size(); ++i) {
+        line(b, "  p{} = {};"_format(i, take(args[i])));
+      }
+      line(b, "  goto start;");
+      line(b, "}");
+    }
+    if (args.empty()) {
+      line(b, "{} = call({}, nullptr, 0);"_format(value, callee));
+    } else {
+      auto argv = "a{}"_format(b.temps++);
+      string list{};
+      for (auto& arg : args) list += (list.empty() ? "" : ", ") + take(arg);
+      line(b, "Value {}[] = {{{}}};"_format(argv, list));
+      line(b,
+           "{} = call({}, {}, {});"_format(value, callee, argv, args.size()));
+    }
+    --b.indent;
+    line(b, "} while (false);");
+    return value;
+  }
+
+  /// Emits `literal` as a function and returns the closure making it.
+  string function(const FunctionLiteral& literal) {
+    auto id = emit_function(literal);
+    string captures{};
+    for (auto& capture : literal.captures) {
+      if (!captures.empty()) captures += ", ";
+      captures += capture.scope == Scope::CELL
+                      ? "c{}"_format(capture.index)
+                      : "self.captures[{}]"_format(capture.index);
+    }
+    std::ostringstream source{};
+    source << literal;
+    return "function(&f{}, {}, {}, {{{}}})"_format(
+        id, literal.parameters.size(), quote(source.str()), captures);
+  }
+
+  /// Emits `node`, returning a C++ expression for its value to be used
+  /// once.
+  string statement(Body& b, const Statement& node) {
+    switch (node.kind) {
+    case Kind::LET: {
+      auto& let  = static_cast<const LetStatement&>(node);
+      auto value = name(b, expression(b, *let.value));
+      auto done  = temporary(b);
+      string target{};
+      if (let.name->scope == Scope::GLOBAL) {
+        target = "set({}, {});"_format(global(let.name->value), take(value));
+      } else {
+        target = "{} = {};"_format(variable(*let.name), take(value));
+      }
+      line(b, "if ({}.is_error()) {{"_format(value));
+      line(b, "  {} = {};"_format(done, take(value)));
+      line(b, "} else {");
+      line(b, "  " + target);
+      line(b, "}");
+      return done;
+    }
+    case Kind::RETURN: {
+      auto* value = static_cast<const ReturnStatement&>(node).return_value;
+      auto done   = "t{}"_format(b.temps++);
+      line(b, "Value {} = {};"_format(done, expression(b, *value)));
+      line(b, "if (!{0}.is_error()) {0}.returning = true;"_format(done));
+      return done;
+    }
+    case Kind::EXPRESSION:
+      return expression(
+          b, *static_cast<const ExpressionStatement&>(node).expression);
+    default: return "Value{}";
+    }
+  }
+
+  /// Runs `stmts` into `target`, stopping early at a return or an error.
+  void block(Body& b, span<Statement* const> stmts, const string& target) {
+    if (stmts.empty()) return;
+    line(b, "do {");
+    ++b.indent;
+    for (size_t i{0}; i < stmts.size(); ++i) {
+      auto value = statement(b, *stmts[i]);
+      if (i + 1 == stmts.size()) {
+        line(b, "{} = {};"_format(target, take(value)));
+        continue;
+      }
+      value = name(b, value);
+      line(b, "if ({0}.returning || {0}.is_error()) {{"_format(value));
+      line(b, "  {} = {};"_format(target, take(value)));
+      line(b, "  break;");
+      line(b, "}");
+    }
+    --b.indent;
+    line(b, "} while (false);");
+  }
+
+  size_t emit_function(const FunctionLiteral& literal) {
+    auto id = functions.size();
+    functions.emplace_back();
+
+    Body b{&literal};
+    line(b, "Value result;");
+    block(b, literal.body->statements, "result");
+    line(b, "return result;");
+
+    Body head{&literal};
+    auto params = literal.parameters;
+    vector<bool> is_param(literal.slots, false);
+    for (auto& param : params) {
+      if (param.scope == Scope::LOCAL) is_param[param.index] = true;
+    }
+    for (uint32_t i{0}; i < literal.slots; ++i) {
+      line(head, "Value s{};"_format(i));
+    }
+    for (uint32_t i{0}; i < literal.cells; ++i) {
+      line(head, "Cell c{};"_format(i));
+    }
+    for (size_t i{0}; i < params.size(); ++i) {
+      line(head, "Value p{0} = std::move(args[{0}]);"_format(i));
+    }
+    if (b.restarts) head.code += "start:\n";
+    for (uint32_t i{0}; i < literal.cells; ++i) {
+      line(head, "c{} = cell();"_format(i));
+    }
+    // A restarted call must not see the lets of the one before.
+    if (b.restarts) {
+      for (uint32_t i{0}; i < literal.slots; ++i) {
+        if (!is_param[i]) line(head, "s{} = Value{{}};"_format(i));
+      }
+    }
+    for (size_t i{0}; i < params.size(); ++i) {
+      line(head, "{} = std::move(p{});"_format(variable(params[i]), i));
+    }
+
+    functions[id] = "Value f{}(const NativeFunction& self, Value* args) {{\n"
+                    "{}{}}}\n"_format(id, head.code, b.code);
+    return id;
+  }
+
+  string program(const Program& program) {
+    Body b{};
+    line(b, "Value result;");
+    block(b, program.statements, "result");
+    line(b, "result.returning = false;");
+    line(b, "return result;");
+
+    string out{"#include <monkey/runtime.h>\n\n"
+               "using namespace monkey;\n"
+               "using namespace monkey::runtime;\n\n"
+               "namespace {\n\n"};
+    for (size_t i{0}; i < globals.size(); ++i) {
+      out += "Global g{}{{{}}};\n"_format(i, quote(globals[i].name()));
+    }
+    if (!globals.empty()) out += '\n';
+    for (size_t i{0}; i < functions.size(); ++i) {
+      out += "Value f{}(const NativeFunction& self, Value* args);\n"_format(i);
+    }
+    for (auto& function : functions) out += '\n' + function;
+    out += "\nValue run() {\n" + b.code + "}\n\n} // namespace\n\n";
+    out += "int main() { return monkey::runtime::main(run); }\n";
+    return out;
+  }
+};
+
+} // namespace
+
+string transpile(const Program& program) {
+  return Transpiler{}.program(program);
+}
+
+namespace {
+
+/// Runs `args` without a shell, so no character in them is special, and
+/// returns the exit status, or -1 if it could not be run.
+int spawn(const vector<string>& args) {
+  vector<char*> argv{};
+  for (auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+  pid_t pid{};
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ)
+      != 0) {
+    return -1;
+  }
+  int status{};
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return -1;
+  }
+  if (!WIFEXITED(status)) return -1;
+  return WEXITSTATUS(status);
+}
+
+} // namespace
+
+int build(const string& source, const string& output) {
+  char path[] = "/tmp/monkey-XXXXXX.cpp";
+  auto fd     = mkstemps(path, 4);
+  if (fd < 0) return -1;
+  auto* file = fdopen(fd, "w");
+  if (!file) {
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+  auto written = std::fwrite(source.data(), 1, source.size(), file);
+  std::fclose(file);
+  if (written != source.size()) {
+    unlink(path);
+    return -1;
+  }
+
+  char object[] = "/tmp/monkey-XXXXXX.o";
+  fd            = mkstemps(object, 2);
+  if (fd < 0) {
+    unlink(path);
+    return -1;
+  }
+  close(fd);
+
+  // Compiled and linked in two steps, so the program itself is built
+  // without lib's coverage instrumentation but links its runtime.
+  auto* env = std::getenv("CXX");
+  string cxx{env && *env ? env : MONKEY_CXX};
+  auto status = spawn({cxx, "-std=c++20", "-O2", "-I" MONKEY_INCLUDE_DIR, "-c",
+                       path, "-o", object});
+  unlink(path);
+  if (status == 0) {
+    vector<string> link{cxx,
+                        object,
+                        "-o",
+                        output,
+                        MONKEY_LIBRARY,
+                        MONKEY_FMT_LIBRARY,
+                        "-Wl,-rpath," MONKEY_FMT_LIBRARY_DIR,
+                        "-lpthread"};
+    if (*MONKEY_COVERAGE_LINK_FLAG) {
+      link.emplace_back(MONKEY_COVERAGE_LINK_FLAG);
+    }
+    status = spawn(link);
+  }
+  unlink(object);
+  return status;
+}
+
+} // namespace monkey
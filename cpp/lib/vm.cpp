@@ -0,0 +1,276 @@
+#include "monkey/vm.h"
+
+#include <fmt/format.h>
+#include <monkey/evaluator.h>
+
+#include "dispatch.h"
+
+using namespace fmt::literals;
+using std::vector;
+
+namespace monkey {
+
+using code::Opcode;
+using code::read_u16;
+using Type = Value::Type;
+
+/// The operator token an arithmetic or comparison opcode stands for, so the
+/// VM can defer anything but integer fast paths to the evaluator.
+static Token::Type token_of(Opcode op) {
+  switch (op) {
+  case Opcode::ADD: return Token::Type::PLUS;
+  case Opcode::SUB: return Token::Type::MINUS;
+  case Opcode::MUL: return Token::Type::ASTERISK;
+  case Opcode::DIV: return Token::Type::SLASH;
+  case Opcode::EQUAL: return Token::Type::EQ;
+  case Opcode::NOT_EQUAL: return Token::Type::NOT_EQ;
+  case Opcode::LESS_THAN: return Token::Type::LT;
+  case Opcode::GREATER_THAN: return Token::Type::GT;
+  case Opcode::MINUS: return Token::Type::MINUS;
+  default: return Token::Type::ILLEGAL;
+  }
+}
+
+VM::VM()
+    : stack(STACK_SIZE)
+    , globals(GLOBALS_SIZE)
+    , bound(GLOBALS_SIZE) {
+  frames.reserve(MAX_FRAMES);
+}
+
+bool threaded_dispatch() {
+  return MONKEY_THREADED;
+}
+
+void VM::unwind(Value* sp, size_t count) {
+  dispatched = count;
+  for (auto* slot = stack.data(); slot != sp; ++slot) *slot = Value{};
+  frames.clear();
+}
+
+Value VM::run(const Bytecode& bytecode) {
+  auto& constants = bytecode.constants;
+  auto* const end = stack.data() + stack.size();
+  Value* sp{stack.data()};
+  // Everything above `sp` is null: pops move out of their slot.
+  auto pop  = [&] { return std::move(*--sp); };
+  size_t count{0};
+  auto fail = [&](Value error) {
+    unwind(sp, count);
+    return error;
+  };
+
+  const object::Closure* closure{nullptr};
+  const uint8_t* code{bytecode.instructions.data()};
+  const uint8_t* ip{code};
+  Value* base{sp};
+  Opcode op{};
+
+  // Every push checks for room; a deep expression can overflow as surely as
+  // deep recursion.
+#define PUSH(value)                                                            \
+  do {                                                                         \
+    if (sp == end) return fail(Value::error("stack overflow"));                \
+    *sp++ = value;                                                             \
+  } while (0)
+#define FETCH()                                                                \
+  do {                                                                         \
+    op = static_cast<Opcode>(*ip++);                                           \
+    ++count;                                                                   \
+  } while (0)
+#define OPCODE op
+
+#if MONKEY_THREADED
+  static void* const targets[] = {
+      TARGET_ADDRESS(CONSTANT),        TARGET_ADDRESS(POP),
+      TARGET_ADDRESS(ADD),             TARGET_ADDRESS(SUB),
+      TARGET_ADDRESS(MUL),             TARGET_ADDRESS(DIV),
+      TARGET_ADDRESS(TRUE),            TARGET_ADDRESS(FALSE),
+      TARGET_ADDRESS(NULL_),           TARGET_ADDRESS(EQUAL),
+      TARGET_ADDRESS(NOT_EQUAL),       TARGET_ADDRESS(LESS_THAN),
+      TARGET_ADDRESS(GREATER_THAN),    TARGET_ADDRESS(MINUS),
+      TARGET_ADDRESS(BANG),            TARGET_ADDRESS(JUMP),
+      TARGET_ADDRESS(JUMP_NOT_TRUTHY), TARGET_ADDRESS(GET_GLOBAL),
+      TARGET_ADDRESS(SET_GLOBAL),      TARGET_ADDRESS(GET_LOCAL),
+      TARGET_ADDRESS(SET_LOCAL),       TARGET_ADDRESS(GET_FREE),
+      TARGET_ADDRESS(CURRENT_CLOSURE), TARGET_ADDRESS(CLOSURE),
+      TARGET_ADDRESS(CALL),            TARGET_ADDRESS(RETURN_VALUE),
+      TARGET_ADDRESS(RETURN),
+  };
+  static_assert(std::size(targets) == size_t(Opcode::RETURN) + 1);
+#endif
+
+  // Every program ends in a return, which is what stops the loop.
+  for (;;) {
+    FETCH();
+    switch (OPCODE) {
+    TARGET(CONSTANT):
+      PUSH(constants[read_u16(ip)]);
+      ip += 2;
+      NEXT();
+    TARGET(POP):
+      *--sp = Value{};
+      NEXT();
+
+    TARGET(ADD):
+    TARGET(SUB):
+    TARGET(MUL):
+    TARGET(DIV):
+    TARGET(EQUAL):
+    TARGET(NOT_EQUAL):
+    TARGET(LESS_THAN):
+    TARGET(GREATER_THAN): {
+      auto right = pop();
+      auto& left = sp[-1];
+      if (left.type() == Type::INTEGER && right.type() == Type::INTEGER) {
+        auto l = left.as_integer(), r = right.as_integer();
+        switch (op) {
+        case Opcode::ADD:
+          left = Value::integer(wrapping_add(l, r));
+          NEXT();
+        case Opcode::SUB:
+          left = Value::integer(wrapping_subtract(l, r));
+          NEXT();
+        case Opcode::MUL:
+          left = Value::integer(wrapping_multiply(l, r));
+          NEXT();
+        case Opcode::DIV:
+          if (r == 0) break;
+          left = Value::integer(wrapping_divide(l, r));
+          NEXT();
+        case Opcode::EQUAL: left = Value::boolean(l == r); NEXT();
+        case Opcode::NOT_EQUAL: left = Value::boolean(l != r); NEXT();
+        case Opcode::LESS_THAN: left = Value::boolean(l < r); NEXT();
+        case Opcode::GREATER_THAN: left = Value::boolean(l > r); NEXT();
+        default: break;
+        }
+      }
+      left = eval_infix(token_of(op), left, right);
+      if (left.is_error()) return fail(std::move(left));
+      NEXT();
+    }
+    TARGET(MINUS): {
+      auto& right = sp[-1];
+      if (right.type() == Type::INTEGER) {
+        right = Value::integer(wrapping_negate(right.as_integer()));
+        NEXT();
+      }
+      right = eval_prefix(Token::Type::MINUS, right);
+      if (right.is_error()) return fail(std::move(right));
+      NEXT();
+    }
+    TARGET(BANG):
+      sp[-1] = Value::boolean(!sp[-1].truthy());
+      NEXT();
+
+    TARGET(TRUE):
+      PUSH(Value::boolean(true));
+      NEXT();
+    TARGET(FALSE):
+      PUSH(Value::boolean(false));
+      NEXT();
+    TARGET(NULL_):
+      PUSH(Value{});
+      NEXT();
+
+    TARGET(JUMP):
+      ip = code + read_u16(ip);
+      NEXT();
+    TARGET(JUMP_NOT_TRUTHY):
+      ip = pop().truthy() ? ip + 2 : code + read_u16(ip);
+      NEXT();
+
+    TARGET(GET_GLOBAL): {
+      auto index = read_u16(ip);
+      if (globals[index].type() == Type::NULL_ && !bound[index]) {
+        return fail(Value::error("identifier not found: {}"_format(
+            bytecode.globals[index].name())));
+      }
+      PUSH(globals[index]);
+      ip += 2;
+      NEXT();
+    }
+    TARGET(SET_GLOBAL): {
+      auto index     = read_u16(ip);
+      globals[index] = pop();
+      bound[index]   = true;
+      ip += 2;
+      NEXT();
+    }
+    TARGET(GET_LOCAL):
+      PUSH(base[*ip++]);
+      NEXT();
+    TARGET(SET_LOCAL):
+      base[*ip++] = pop();
+      NEXT();
+    TARGET(GET_FREE):
+      PUSH(closure->free[*ip++]);
+      NEXT();
+    TARGET(CURRENT_CLOSURE):
+      PUSH(base[-1]);
+      NEXT();
+
+    TARGET(CLOSURE): {
+      auto& function = constants[read_u16(ip)];
+      size_t captures{ip[2]};
+      ip += 3;
+      vector<Value> free(std::make_move_iterator(sp - captures),
+                         std::make_move_iterator(sp));
+      sp -= captures;
+      PUSH((Value{Type::CLOSURE,
+                  new object::Closure{function, std::move(free)}}));
+      NEXT();
+    }
+    TARGET(CALL): {
+      size_t args{*ip++};
+      auto& callee = sp[-1 - static_cast<ptrdiff_t>(args)];
+      if (callee.type() != Type::CLOSURE) {
+        return fail(Value::error(
+            "not a function: {}"_format(type_name(callee.type()))));
+      }
+      auto& fn       = callee.as<object::Closure>();
+      auto& compiled = fn.compiled();
+      if (compiled.parameters != args) {
+        return fail(
+            Value::error("wrong number of arguments: want={}, got={}"_format(
+                compiled.parameters, args)));
+      }
+      if (frames.size() == MAX_FRAMES
+          || end - sp < static_cast<ptrdiff_t>(compiled.locals - args)) {
+        return fail(Value::error("stack overflow"));
+      }
+      frames.push_back({closure, code, ip, base});
+      closure = &fn;
+      code    = compiled.instructions.data();
+      ip      = code;
+      base    = sp - args;
+      sp      = base + compiled.locals;
+      NEXT();
+    }
+    TARGET(RETURN_VALUE):
+    TARGET(RETURN): {
+      Value result{op == Opcode::RETURN_VALUE ? pop() : Value{}};
+      // A top-level return ends the program.
+      if (frames.empty()) {
+        unwind(sp, count);
+        return result;
+      }
+      // Drop the callee, its arguments and its locals.
+      while (sp != base - 1) *--sp = Value{};
+      *sp++ = std::move(result);
+      auto& caller = frames.back();
+      closure      = caller.closure;
+      code         = caller.code;
+      ip           = caller.ip;
+      base         = caller.base;
+      frames.pop_back();
+      NEXT();
+    }
+    }
+  }
+#undef PUSH
+#undef FETCH
+#undef OPCODE
+}
+
+} // namespace monkey
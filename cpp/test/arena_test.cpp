@@ -0,0 +1,63 @@
+#include "monkey/arena.h"
+
+#include <fmt/ostream.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+using namespace monkey;
+using namespace fmt::literals;
+using std::string;
+using std::vector;
+
+TEST_CASE("arena") {
+  SECTION("objects and copies") {
+    Arena arena{};
+    auto* n = arena.make<std::pair<int, double>>(3, 0.5);
+    REQUIRE(n->first == 3);
+
+    string text{"transient"};
+    auto kept = arena.copy(text);
+    text.assign("overwritten");
+    REQUIRE(kept == "transient");
+
+    auto items = arena.copy(vector<int>{1, 2, 3});
+    REQUIRE(items.size() == 3);
+    REQUIRE(items[2] == 3);
+    REQUIRE(arena.copy(vector<int>{}).empty());
+    REQUIRE(arena.used() >= sizeof(*n) + kept.size() + 3 * sizeof(int));
+  };
+
+  SECTION("adopted arenas live as long as the adopter") {
+    Arena arena{};
+    auto other = std::make_unique<Arena>();
+    auto text  = other->copy("from another arena");
+    arena.adopt(std::move(other));
+    REQUIRE(text == "from another arena");
+    REQUIRE(arena.used() == text.size());
+  };
+
+  SECTION("nodes outlive the parser and its source") {
+    Program program{};
+    {
+      string src{"let add = fn(x, y) { x + y }; add(1, 2)"};
+      Lexer l{src};
+      Parser p{l};
+      program = p.parse_program();
+      src.assign(src.size(), '?');
+    }
+    REQUIRE("{}"_format(program) == "let add = fn(x, y) { (x + y) };add(1, 2)");
+    REQUIRE(program.arena->used() > 0);
+  };
+
+  SECTION("appending takes over the other program's nodes") {
+    Lexer a{"1 + 2;"};
+    Lexer b{"!true;"};
+    Program program = Parser{a}.parse_program();
+    program.append(Parser{b}.parse_program());
+    REQUIRE(program.statements.size() == 2);
+    REQUIRE("{}"_format(program) == "(1 + 2)(!true)");
+  };
+}
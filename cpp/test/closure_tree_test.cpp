@@ -0,0 +1,114 @@
+#include "monkey/closure_tree.h"
+
+#include <monkey/evaluator.h>
+#include <monkey/lexer.h>
+#include <monkey/parser.h>
+#include <monkey/repl.h>
+
+#include <catch2/catch.hpp>
+#include <sstream>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+static Program parse(const string& input) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+  return program;
+}
+
+/// The program's value from its closures, which must be what eval makes of
+/// it.
+static string test_closures(const string& input) {
+  auto program = parse(input);
+  auto value   = closure::Tree{program}.run();
+  REQUIRE(value.inspect() == eval(program).inspect());
+  return value.inspect();
+}
+
+TEST_CASE("closure tree") {
+  SECTION("values") {
+    REQUIRE(test_closures(R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+let adder = fn(x) { fn(y) { x + y } };
+let twice = fn(f, x) { f(f(x)) };
+let f = fn(x) {
+  let y = if (x > 5) { return x * 10; } else { x };
+  let g = fn() { y + h() };
+  let h = fn() { 100 };
+  if (!(y == 3)) { g() } else { -g() }
+};
+let check = fn(a, b) { if (a == b) { 1 } else { 1 / 0 } };
+check(fib(15), 610) + check(twice(adder(3), 4), 10) + check(f(1), 101)
+  + check(f(3), -103) + check(f(7), 170) + check(true != false, true);
+)") == "6");
+    REQUIRE(test_closures("fn(x) { x * 2 };") == "fn(x) { (x * 2) }");
+    REQUIRE(test_closures("if (false) { 1 }; return 2; 3") == "2");
+    REQUIRE(test_closures("(-9223372036854775807 - 1) / -1 * -1 + -1")
+            == "9223372036854775807");
+  }
+
+  SECTION("errors") {
+    REQUIRE(test_closures("let f = fn(x) { x + true }; f(1); 5")
+            == "ERROR: type mismatch: INTEGER + BOOLEAN");
+    REQUIRE(test_closures("let f = fn() { missing }; f(1)")
+            == "ERROR: wrong number of arguments: want=0, got=1");
+    REQUIRE(test_closures("let f = fn() { missing(1 / 0) }; f()")
+            == "ERROR: identifier not found: missing");
+    REQUIRE(test_closures("5(1 / 0)") == "ERROR: division by zero");
+    REQUIRE(test_closures("true(1)") == "ERROR: not a function: BOOLEAN");
+    REQUIRE(test_closures("-true") == "ERROR: unknown operator: -BOOLEAN");
+  }
+
+  SECTION("tail calls") {
+    // A call returned from inside an expression ends the function there,
+    // as it does under eval.
+    REQUIRE(test_closures(R"(
+let g = fn(x) { x * 2 };
+let a = fn(x) { let y = if (x) { return g(1) }; 7 };
+let b = fn(x) { g(if (x) { return g(2) } else { 0 }) };
+let c = fn(x) { (if (x) { return g(3) }) + 1 };
+let d = fn(x) { (1 / 0) + (if (x) { return g(4) }) };
+a(true) + b(true) + c(true) + d(true) + a(false);
+)") == "27");
+    REQUIRE(test_closures(R"(
+let d = fn(x) { (1 / 0) + (if (x) { return d(true) }) };
+d(false);
+)") == "ERROR: division by zero");
+    REQUIRE(test_closures(R"(
+let loop = fn(n, acc) { if (n == 0) { return acc; } loop(n - 1, acc + 1) };
+loop(1000000, 0);
+)") == "1000000");
+  }
+
+  SECTION("deep recursion") {
+    auto sum = [](int n) {
+      return closure::Tree{parse(R"(
+let sum = fn(n) { if (n == 0) { 0 } else { n + sum(n - 1) } };
+sum()" + std::to_string(n) + ")")}
+          .run()
+          .inspect();
+    };
+    REQUIRE(sum(2000) == "2001000");
+    REQUIRE(sum(1000000) == "ERROR: stack overflow");
+    // Nesting is lowered and evaluated on the native stack too.
+    auto nested = [](int depth) {
+      string program(depth, '(');
+      program += "0";
+      for (int i{0}; i < depth; ++i) program += " + 1)";
+      return closure::Tree{parse(program)}.run().inspect();
+    };
+    REQUIRE(nested(4000) == "4000");
+    REQUIRE(nested(30000) == "ERROR: nesting too deep");
+  }
+
+  SECTION("repl") {
+    std::istringstream in{"let add = fn(a, b) { a + b };\nadd(1, 2)\n"};
+    std::ostringstream out{};
+    repl::start(in, out, repl::Engine::CLOSURES);
+    REQUIRE(out.str() == ">> >> 3\n>> \n");
+  }
+}
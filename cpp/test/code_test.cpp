@@ -0,0 +1,34 @@
+#include "monkey/code.h"
+
+#include <catch2/catch.hpp>
+
+using namespace monkey::code;
+
+TEST_CASE("code") {
+  SECTION("make") {
+    REQUIRE(make(Opcode::CONSTANT, {65534})
+            == Instructions{static_cast<uint8_t>(Opcode::CONSTANT), 255, 254});
+    REQUIRE(make(Opcode::ADD)
+            == Instructions{static_cast<uint8_t>(Opcode::ADD)});
+    REQUIRE(make(Opcode::GET_LOCAL, {255})
+            == Instructions{static_cast<uint8_t>(Opcode::GET_LOCAL), 255});
+    REQUIRE(make(Opcode::CLOSURE, {65534, 255})
+            == Instructions{
+                static_cast<uint8_t>(Opcode::CLOSURE), 255, 254, 255});
+  };
+  SECTION("disassemble") {
+    Instructions ins{};
+    for (auto part : {make(Opcode::ADD),
+                      make(Opcode::GET_LOCAL, {1}),
+                      make(Opcode::CONSTANT, {2}),
+                      make(Opcode::CONSTANT, {65535}),
+                      make(Opcode::CLOSURE, {65535, 255})}) {
+      ins.insert(ins.end(), part.begin(), part.end());
+    }
+    REQUIRE(disassemble(ins) == "0000 OpAdd\n"
+                                "0001 OpGetLocal 1\n"
+                                "0003 OpConstant 2\n"
+                                "0006 OpConstant 65535\n"
+                                "0009 OpClosure 65535 255\n");
+  };
+}
@@ -0,0 +1,88 @@
+#include "monkey/compiler.h"
+
+#include <monkey/lexer.h>
+#include <monkey/object.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+static Bytecode test_compile(string input) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+  Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  REQUIRE(compiler.errors.empty());
+  return bytecode;
+}
+
+TEST_CASE("compiler") {
+  SECTION("arithmetic") {
+    auto bc = test_compile("1 + 2; -3");
+    REQUIRE(code::disassemble(bc.instructions) == "0000 OpConstant 0\n"
+                                                  "0003 OpConstant 1\n"
+                                                  "0006 OpAdd\n"
+                                                  "0007 OpPop\n"
+                                                  "0008 OpConstant 2\n"
+                                                  "0011 OpMinus\n"
+                                                  "0012 OpReturnValue\n");
+    REQUIRE(bc.constants.size() == 3);
+    REQUIRE(bc.constants[2].as_integer() == 3);
+  };
+  SECTION("conditionals") {
+    auto bc = test_compile("if (true) { 10 }; 3333;");
+    REQUIRE(code::disassemble(bc.instructions) == "0000 OpTrue\n"
+                                                  "0001 OpJumpNotTruthy 10\n"
+                                                  "0004 OpConstant 0\n"
+                                                  "0007 OpJump 11\n"
+                                                  "0010 OpNull\n"
+                                                  "0011 OpPop\n"
+                                                  "0012 OpConstant 1\n"
+                                                  "0015 OpReturnValue\n");
+  };
+  SECTION("globals") {
+    auto bc = test_compile("let one = 1; let two = one; two;");
+    REQUIRE(code::disassemble(bc.instructions) == "0000 OpConstant 0\n"
+                                                  "0003 OpSetGlobal 0\n"
+                                                  "0006 OpGetGlobal 0\n"
+                                                  "0009 OpSetGlobal 1\n"
+                                                  "0012 OpGetGlobal 1\n"
+                                                  "0015 OpReturnValue\n");
+  };
+  SECTION("closures") {
+    auto bc = test_compile("fn(a) { fn(b) { a + b } }");
+    REQUIRE(code::disassemble(bc.instructions) == "0000 OpClosure 1 0\n"
+                                                  "0004 OpReturnValue\n");
+    auto& inner = bc.constants[0].as<object::CompiledFunction>();
+    REQUIRE(code::disassemble(inner.instructions) == "0000 OpGetFree 0\n"
+                                                     "0002 OpGetLocal 0\n"
+                                                     "0004 OpAdd\n"
+                                                     "0005 OpReturnValue\n");
+    auto& outer = bc.constants[1].as<object::CompiledFunction>();
+    REQUIRE(code::disassemble(outer.instructions) == "0000 OpGetLocal 0\n"
+                                                     "0002 OpClosure 0 1\n"
+                                                     "0006 OpReturnValue\n");
+    REQUIRE(outer.parameters == 1);
+  };
+  SECTION("recursion") {
+    auto bc = test_compile("let f = fn(x) { f(x) };");
+    auto& f = bc.constants[0].as<object::CompiledFunction>();
+    REQUIRE(code::disassemble(f.instructions) == "0000 OpCurrentClosure\n"
+                                                 "0001 OpGetLocal 0\n"
+                                                 "0003 OpCall 1\n"
+                                                 "0005 OpReturnValue\n");
+  };
+  SECTION("errors") {
+    Lexer l{"let f = fn() { y }"};
+    auto program = Parser{l}.parse_program();
+    Compiler compiler{};
+    compiler.compile(program);
+    REQUIRE(compiler.errors
+            == std::vector<string>{"identifier not found: y"});
+  };
+}
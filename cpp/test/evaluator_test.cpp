@@ -6,13 +6,13 @@
 
 #include <catch2/catch.hpp>
 #include <iostream>
+#include <type_traits>
 
 using namespace fmt::literals;
 using namespace monkey;
 using std::string;
-using std::unique_ptr;
 
-unique_ptr<object::Object> test_eval_node(string input) {
+Value test_eval_node(string input) {
   Lexer lex{input};
   Parser parse{lex};
   Program program = parse.parse_program();
@@ -20,32 +20,30 @@ unique_ptr<object::Object> test_eval_node(string input) {
 }
 
 string test_eval(string input) {
-  return test_eval_node(input)->inspect();
+  return test_eval_node(input).inspect();
 }
 
 TEST_CASE("evaluator") {
   SECTION("integer") {
     SECTION("5") {
       auto e = test_eval_node("5");
-      auto i = dynamic_cast<object::Integer&>(*e);
-      REQUIRE(i.value == 5);
+      REQUIRE(e.type() == Value::Type::INTEGER);
+      REQUIRE(e.as_integer() == 5);
     };
     SECTION("10") {
       auto e = test_eval_node("10");
-      auto i = dynamic_cast<object::Integer&>(*e);
-      REQUIRE(i.value == 10);
+      REQUIRE(e.as_integer() == 10);
     };
   };
   SECTION("bool") {
     SECTION("true"){
       auto e = test_eval_node("true");
-      auto i = dynamic_cast<object::Boolean&>(*e);
-      REQUIRE(i.value);
+      REQUIRE(e.type() == Value::Type::BOOLEAN);
+      REQUIRE(e.as_boolean());
     };
     SECTION("false"){
       auto e = test_eval_node("false");
-      auto i = dynamic_cast<object::Boolean&>(*e);
-      REQUIRE_FALSE(i.value);
+      REQUIRE_FALSE(e.as_boolean());
     };
   };
   SECTION("bang") {
@@ -63,8 +61,8 @@ TEST_CASE("evaluator") {
     };
     for (auto&& tt : tests) {
       auto e = test_eval_node(tt.input);
-      auto i = dynamic_cast<object::Boolean&>(*e);
-      REQUIRE(i.value == tt.expected);
+      REQUIRE(e.type() == Value::Type::BOOLEAN);
+      REQUIRE(e.as_boolean() == tt.expected);
     }
   };
   SECTION("negative") {
@@ -80,8 +78,8 @@ TEST_CASE("evaluator") {
     };
     for (auto&& tt : tests) {
       auto e = test_eval_node(tt.input);
-      auto i = dynamic_cast<object::Integer&>(*e);
-      REQUIRE(i.value == tt.expected);
+      REQUIRE(e.type() == Value::Type::INTEGER);
+      REQUIRE(e.as_integer() == tt.expected);
     }
   };
   SECTION("math") {
@@ -108,8 +106,217 @@ TEST_CASE("evaluator") {
     };
     for (auto&& tt : tests) {
       auto e = test_eval_node(tt.input);
-      auto i = dynamic_cast<object::Integer&>(*e);
-      REQUIRE(i.value == tt.expected);
+      REQUIRE(e.type() == Value::Type::INTEGER);
+      REQUIRE(e.as_integer() == tt.expected);
     }
   };
+  SECTION("comparison") {
+    REQUIRE(test_eval("1 < 2") == "true");
+    REQUIRE(test_eval("1 > 2") == "false");
+    REQUIRE(test_eval("1 == 1") == "true");
+    REQUIRE(test_eval("1 != 1") == "false");
+    REQUIRE(test_eval("true == false") == "false");
+    REQUIRE(test_eval("(1 < 2) == true") == "true");
+    REQUIRE(test_eval("(1 > 2) != false") == "false");
+  };
+  SECTION("overflow") {
+    // Integers wrap around rather than trap or overflow undefinedly.
+    REQUIRE(test_eval("(-9223372036854775807 - 1) / -1")
+            == "-9223372036854775808");
+    REQUIRE(test_eval("-(-9223372036854775807 - 1)") == "-9223372036854775808");
+    REQUIRE(test_eval("9223372036854775807 + 1") == "-9223372036854775808");
+    REQUIRE(test_eval("-9223372036854775807 - 2") == "9223372036854775807");
+    REQUIRE(test_eval("4611686018427387904 * 2") == "-9223372036854775808");
+  };
+  SECTION("if else") {
+    REQUIRE(test_eval("if (true) { 10 }") == "10");
+    REQUIRE(test_eval("if (false) { 10 }") == "null");
+    REQUIRE(test_eval("if (1) { 10 }") == "10");
+    REQUIRE(test_eval("if (1 > 2) { 10 } else { 20 }") == "20");
+  };
+  SECTION("return") {
+    REQUIRE(test_eval("return 10; 9;") == "10");
+    REQUIRE(test_eval("9; return 2 * 5; 9;") == "10");
+    REQUIRE(test_eval("if (10 > 1) { if (10 > 1) { return 10; } return 1; }")
+            == "10");
+  };
+  SECTION("errors") {
+    struct Test {
+      string input;
+      string expected;
+    };
+    std::vector<Test> tests{
+        {"5 + true;", "type mismatch: INTEGER + BOOLEAN"},
+        {"5 + true; 5;", "type mismatch: INTEGER + BOOLEAN"},
+        {"-true", "unknown operator: -BOOLEAN"},
+        {"true + false;", "unknown operator: BOOLEAN + BOOLEAN"},
+        {"if (10 > 1) { true + false; }",
+         "unknown operator: BOOLEAN + BOOLEAN"},
+        {"foobar", "identifier not found: foobar"},
+        {"5 / 0", "division by zero"},
+        {"5(1)", "not a function: INTEGER"},
+        {"fn(x) { x }()", "wrong number of arguments: want=1, got=0"},
+    };
+    for (auto&& tt : tests) {
+      auto e = test_eval_node(tt.input);
+      REQUIRE(e.is_error());
+      REQUIRE(e.as<object::Error>().message == tt.expected);
+    }
+  };
+  SECTION("let") {
+    REQUIRE(test_eval("let a = 5; a;") == "5");
+    REQUIRE(test_eval("let a = 5 * 5; a;") == "25");
+    REQUIRE(test_eval("let a = 5; let b = a; let c = a + b + 5; c;") == "15");
+  };
+  SECTION("functions") {
+    REQUIRE(test_eval("fn(x) { x + 2; };") == "fn(x) { (x + 2) }");
+    REQUIRE(test_eval("let identity = fn(x) { x; }; identity(5);") == "5");
+    REQUIRE(test_eval("let identity = fn(x) { return x; }; identity(5);")
+            == "5");
+    REQUIRE(test_eval("let add = fn(x, y) { x + y; }; add(5, add(5, 5));")
+            == "15");
+    REQUIRE(test_eval("fn(x) { x; }(5)") == "5");
+    REQUIRE(test_eval("let fib = fn(n) { if (n < 2) { n } else { "
+                      "fib(n - 1) + fib(n - 2) } }; fib(15)")
+            == "610");
+  };
+  SECTION("closures") {
+    REQUIRE(test_eval("let newAdder = fn(x) { fn(y) { x + y }; };"
+                      "let addTwo = newAdder(2); addTwo(2);")
+            == "4");
+  };
+  SECTION("functions share their globals") {
+    static_assert(!std::is_copy_constructible_v<object::Environment>);
+    static_assert(!std::is_move_constructible_v<object::Environment>);
+    auto k = Symbol::intern("k");
+    Lexer lex{"let k = 5; fn() { k }"};
+    auto program = Parser{lex}.parse_program();
+
+    auto env = std::make_shared<object::Environment>();
+    auto fn  = eval(program, env);
+    env.reset();
+    auto& globals = *fn.as<object::Function>().globals;
+    REQUIRE(globals.global(k)->inspect() == "5");
+
+    // A fresh environment is cleared once the program is done with it.
+    fn = eval(program);
+    REQUIRE(fn.as<object::Function>().globals->global(k) == nullptr);
+  };
+  SECTION("tail calls") {
+    // Deep enough to overflow the native stack if each call nested.
+    REQUIRE(test_eval("let loop = fn(i, acc) { if (i == 0) { acc } else { "
+                      "loop(i - 1, acc + 1) } }; loop(200000, 0)")
+            == "200000");
+    REQUIRE(test_eval("let loop = fn(i) { if (i > 0) { return loop(i - 1); } "
+                      "i }; loop(200000)")
+            == "0");
+    REQUIRE(test_eval("let even = fn(n) { if (n == 0) { true } else { "
+                      "odd(n - 1) } };"
+                      "let odd = fn(n) { if (n == 0) { false } else { "
+                      "even(n - 1) } }; even(200001)")
+            == "false");
+    REQUIRE(test_eval("let f = fn(x) { x(1) }; f(fn(y) { y + 1 })") == "2");
+    REQUIRE(test_eval("let f = fn() { g(1) }; let g = fn() { 0 }; f()")
+            == "ERROR: wrong number of arguments: want=0, got=1");
+    REQUIRE(test_eval("let f = fn() { return 1(); }; f()")
+            == "ERROR: not a function: INTEGER");
+    // Returned from inside an argument, the call still ends the function,
+    // and leaves what its caller had on the stack alone.
+    REQUIRE(test_eval("let g = fn(x) { x * 2 };"
+                      "let f = fn(x) { g(if (x) { return g(2) } else { 0 }) };"
+                      "1 + f(true)")
+            == "5");
+  };
+  SECTION("deep nesting") {
+    constexpr int DEPTH = 100000;
+    string src{};
+    for (int i{0}; i < DEPTH; ++i) src += "(";
+    src += "0";
+    for (int i{0}; i < DEPTH; ++i) src += " + 1)";
+    REQUIRE(test_eval(src) == "100000");
+    // Calls that are not in tail position still nest without limit.
+    REQUIRE(test_eval("let f = fn(n) { if (n == 0) { 0 } else { "
+                      "1 + f(n - 1) } }; f(100000)")
+            == "100000");
+  };
+  SECTION("specialization") {
+    auto env = std::make_shared<object::Environment>();
+    auto run = [&](string input) {
+      Lexer lex{input};
+      return eval(Parser{lex}.parse_program(), env).inspect();
+    };
+    Lexer lex{"let f = fn(a, b) { -a + b == a };"};
+    auto program = Parser{lex}.parse_program();
+    eval(program, env);
+    auto& f = static_cast<FunctionLiteral&>(
+        *static_cast<LetStatement&>(*program.statements[0]).value);
+    auto& eq = static_cast<InfixExpression&>(
+        *static_cast<ExpressionStatement&>(*f.body->statements[0]).expression);
+    auto& add    = static_cast<InfixExpression&>(*eq.left);
+    auto& negate = static_cast<PrefixExpression&>(*add.left);
+    REQUIRE(eq.specialization == Specialization::UNSEEN);
+
+    REQUIRE(run("f(1, 2)") == "true");
+    REQUIRE(eq.specialization == Specialization::INT_EQ);
+    REQUIRE(add.specialization == Specialization::INT_ADD);
+    REQUIRE(negate.specialization == Specialization::INT_NEGATE);
+    // A failed guard falls back to the generic operator for good.
+    REQUIRE(run("f(1, true)") == "ERROR: type mismatch: INTEGER + BOOLEAN");
+    REQUIRE(add.specialization == Specialization::GENERIC);
+    REQUIRE(negate.specialization == Specialization::INT_NEGATE);
+    REQUIRE(run("f(2, 3)") == "false");
+    REQUIRE(run("f(true, 3)") == "ERROR: unknown operator: -BOOLEAN");
+    REQUIRE(negate.specialization == Specialization::GENERIC);
+    REQUIRE(run("f(2, 4)") == "true");
+    // Specialized operators wrap around as the generic ones do.
+    Lexer g_lex{"let g = fn(a, b) { -a / b * b + b };"};
+    auto g = Parser{g_lex}.parse_program();
+    eval(g, env);
+    REQUIRE(run("g(1, 1)") == "0");
+    REQUIRE(run("g(-9223372036854775807 - 1, -1)") == "9223372036854775807");
+  };
+  SECTION("operator table") {
+    // Every infix operator on every pair of integer and boolean operands,
+    // straight from the shared table the engines call.
+    auto i = Value::integer(6), j = Value::integer(3);
+    auto t = Value::boolean(true), f = Value::boolean(false);
+    auto error = Value::error("boom");
+    struct Test {
+      Token::Type op;
+      string ints;
+      /// Empty where booleans don't take the operator.
+      string bools{};
+    };
+    std::vector<Test> tests{
+        {Token::Type::PLUS, "9"},
+        {Token::Type::MINUS, "3"},
+        {Token::Type::ASTERISK, "18"},
+        {Token::Type::SLASH, "2"},
+        {Token::Type::LT, "false"},
+        {Token::Type::GT, "true"},
+        {Token::Type::EQ, "false", "false"},
+        {Token::Type::NOT_EQ, "true", "true"},
+    };
+    for (auto& tt : tests) {
+      auto op = operator_str(tt.op);
+      REQUIRE(eval_infix(tt.op, i, j).inspect() == tt.ints);
+      REQUIRE(eval_infix(tt.op, t, f).inspect()
+              == (tt.bools.empty()
+                      ? "ERROR: unknown operator: BOOLEAN {} BOOLEAN"_format(op)
+                      : tt.bools));
+      REQUIRE(eval_infix(tt.op, i, t).inspect()
+              == "ERROR: type mismatch: INTEGER {} BOOLEAN"_format(op));
+      REQUIRE(eval_infix(tt.op, f, j).inspect()
+              == "ERROR: type mismatch: BOOLEAN {} INTEGER"_format(op));
+      REQUIRE(eval_infix(tt.op, error, i).inspect() == "ERROR: boom");
+      REQUIRE(eval_infix(tt.op, t, error).inspect() == "ERROR: boom");
+    }
+    REQUIRE(eval_infix(Token::Type::SLASH, i, Value::integer(0)).inspect()
+            == "ERROR: division by zero");
+    REQUIRE(eval_prefix(Token::Type::MINUS, i).inspect() == "-6");
+    REQUIRE(eval_prefix(Token::Type::MINUS, t).inspect()
+            == "ERROR: unknown operator: -BOOLEAN");
+    REQUIRE(eval_prefix(Token::Type::BANG, Value{}).inspect() == "true");
+    REQUIRE(eval_prefix(Token::Type::BANG, error).inspect() == "ERROR: boom");
+  };
 }
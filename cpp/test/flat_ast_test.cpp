@@ -0,0 +1,117 @@
+#include "monkey/flat_ast.h"
+
+#include <fmt/ostream.h>
+#include <monkey/evaluator.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using namespace fmt::literals;
+using std::string;
+using Kind  = FlatAst::Kind;
+using Scope = Identifier::Scope;
+
+TEST_CASE("flat ast") {
+  SECTION("prints like the tree it came from") {
+    for (string input : {
+             "let add = fn(x, y) { x + y; };",
+             "add(a + b + c * d / f + g, fn() { return !-x; })",
+             "if (x < y) { x } else { y }; if (a != b) { 1 == 1 }",
+             "return 5; true; false; let z = 7;",
+         }) {
+      Lexer l{input};
+      Parser p{l};
+      auto program = p.parse_program();
+      REQUIRE(p.errors.empty());
+      REQUIRE("{}"_format(FlatAst{program}) == "{}"_format(program));
+    }
+  };
+
+  SECTION("layout") {
+    Lexer l{"let f = fn(x) { x * 2 }; f(3)"};
+    auto ast = Parser{l}.parse_flat_program();
+
+    auto& root = ast[ast.root];
+    REQUIRE(root.kind == Kind::BLOCK);
+    REQUIRE(ast.root == ast.nodes.size() - 1);
+    auto top = ast.list(root.a, root.b);
+    REQUIRE(top.size() == 2);
+
+    auto& let = ast[top[0]];
+    REQUIRE(let.kind == Kind::LET);
+    REQUIRE(Symbol{ast[let.a].a} == "f");
+    REQUIRE(ast[let.a].b == static_cast<FlatAst::Ref>(Scope::GLOBAL));
+    auto& fn = ast[let.b];
+    REQUIRE(fn.kind == Kind::FUNCTION);
+    REQUIRE(fn.b == 1);
+    auto& x = ast[ast.list(fn.a, fn.b)[0]];
+    REQUIRE(x.kind == Kind::IDENT);
+    REQUIRE(x.b == static_cast<FlatAst::Ref>(Scope::LOCAL));
+    REQUIRE(ast.functions[fn.c].slots == 1);
+
+    auto& call = ast[ast[top[1]].a];
+    REQUIRE(call.kind == Kind::CALL);
+    REQUIRE(call.c == 1);
+    auto& arg = ast[ast.list(call.b, call.c)[0]];
+    REQUIRE(arg.kind == Kind::INT);
+    REQUIRE(ast.ints[arg.a] == 3);
+
+    // Children always come before their parents.
+    for (FlatAst::Ref i{0}; i < ast.nodes.size(); ++i) {
+      auto& n = ast[i];
+      if (n.kind == Kind::INFIX) REQUIRE((n.a < i && n.b < i));
+    }
+  };
+
+  SECTION("evaluation") {
+    struct Test {
+      string input;
+      string expected;
+    };
+    for (auto& [input, expected] : {
+             Test{"(5 + 10 * 2 + 15 / 3) * 2 + -10", "50"},
+             Test{"20 + 2 * -10", "0"},
+             Test{"!!5", "true"},
+             Test{"1 < 2 == true", "true"},
+             Test{"(1 > 2) != false", "false"},
+             Test{"5; 10", "10"},
+             Test{"if (1 < 2) { 10 } else { 20 }", "10"},
+             Test{"if (1 > 2) { 10 }", "null"},
+             Test{"if (true) { if (false) { 1 } else { 2 } }", "2"},
+             Test{"if (1 / 0) { 1 }", "ERROR: division by zero"},
+             Test{"-true; 5", "ERROR: unknown operator: -BOOLEAN"},
+             Test{"let x = 5; x", "5"},
+             Test{"1 + x", "ERROR: identifier not found: x"},
+             Test{"if (true) { return 1; }; 2", "1"},
+             Test{"fn(x) { x }", "fn(x) { x }"},
+             Test{"5(1)", "ERROR: not a function: INTEGER"},
+             Test{"fn(x) { x }()", "ERROR: wrong number of arguments: want=1, "
+                                   "got=0"},
+             Test{"let f = fn(x) { f(x) + 1 }; f(1)", "ERROR: stack overflow"},
+         }) {
+      Lexer l{input};
+      REQUIRE(eval(Parser{l}.parse_flat_program()).inspect() == expected);
+    }
+  };
+
+  SECTION("evaluates as the tree does") {
+    for (string input : {
+             "let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + "
+             "fib(n - 2) } }; fib(15)",
+             "let newAdder = fn(x) { fn(y) { x + y } }; newAdder(2)(3)",
+             "let f = fn(a) { let g = fn() { a + b }; let b = 10; g() }; f(1)",
+             "let x = 1; let f = fn() { x }; let x = 2; f()",
+             "let f = fn(n) { if (n > 0) { return n; } -n }; f(3) + f(-4)",
+             "let f = fn() { let y = 1; fn() { fn() { y } } }; f()()()",
+             "let g = fn() { h() }; let h = fn() { 5 }; g()",
+             "fn(x) { x + true }(1); 5",
+             "let f = fn(x) { x }; f(1 / 0)",
+         }) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      REQUIRE(eval(FlatAst{program}).inspect() == eval(program).inspect());
+    }
+  };
+}
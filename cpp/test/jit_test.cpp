@@ -0,0 +1,97 @@
+#include "monkey/jit.h"
+
+#include <monkey/evaluator.h>
+#include <monkey/lexer.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+/// The program's value with and without the JIT, which must agree, and how
+/// many functions the JIT compiled.
+static string test_jit(string input, size_t compiled) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+  jit::Jit jit{};
+  auto value = eval(program, std::make_shared<object::Environment>(), &jit);
+  REQUIRE(value.inspect() == eval(program).inspect());
+  if (jit::available()) REQUIRE(jit.compiled() == compiled);
+  return value.inspect();
+}
+
+TEST_CASE("jit") {
+  SECTION("integer functions") {
+    REQUIRE(test_jit(R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(20);
+)",
+                     1)
+            == "6765");
+    REQUIRE(test_jit(R"(
+let sum = fn(a, b, c, d, e) { a + b * c - d / e };
+let loop = fn(i, total) {
+  if (i == 0) { return total; }
+  let next = total + sum(i, 2, 3, 4, 2);
+  loop(i - 1, next)
+};
+loop(100, 0);
+)",
+                     2)
+            == "5450");
+    REQUIRE(test_jit(R"(
+let f = fn(x) {
+  let small = x < 10;
+  let y = if (!small) { x * 2 } else { -x };
+  if (small == true) { return y; }
+  if (x / -1 != -x) { return 0; }
+  y
+};
+let g = fn(i) { if (i > 20) { 0 } else { f(i) + g(i + 1) } };
+g(0);
+)",
+                     2)
+            == "285");
+    // A call without arguments passes the JIT an empty span.
+    REQUIRE(test_jit(R"(
+let seven = fn() { 7 };
+let g = fn(i) { if (i == 0) { 0 } else { seven() + g(i - 1) } };
+g(20);
+)",
+                     2)
+            == "140");
+  }
+
+  SECTION("fallbacks") {
+    // Division by zero bails out to the interpreter, which reports it.
+    REQUIRE(test_jit(R"(
+let f = fn(x) { 100 / x };
+let g = fn(i) { if (i == 0) { f(i) } else { f(i) + g(i - 1) } };
+g(20);
+)",
+                     2)
+            == "ERROR: division by zero");
+    // Closures, booleans and missing functions are left alone.
+    REQUIRE(test_jit(R"(
+let adder = fn(x) { fn(y) { x + y } };
+let even = fn(n) { if (n == 0) { true } else { !even(n - 1) } };
+let h = fn(n) { if (n == 0) { 0 } else { missing(n) } };
+let loop = fn(i) { if (i == 0) { adder(1)(2) } else { even(i); loop(i - 1) } };
+loop(20);
+)",
+                     0)
+            == "3");
+    // Recursion too deep for the native stack gives up, and the whole call
+    // is run again by the interpreter.
+    REQUIRE(test_jit(R"(
+let sum = fn(n) { if (n == 0) { 0 } else { n + sum(n - 1) } };
+sum(100000);
+)",
+                     1)
+            == "5000050000");
+  }
+}
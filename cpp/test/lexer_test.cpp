@@ -2,6 +2,8 @@
 
 #include <fmt/color.h>
 #include <fmt/ostream.h>
+#include <monkey/stream_lexer.h>
+#include <monkey/token_stream.h>
 
 #include <catch2/catch.hpp>
 
@@ -190,3 +192,108 @@ if (5 < 10) {
     test(input, expected);
   }
 }
+
+TEST_CASE("lexer views") {
+  string input = "let add = fn(x, y) { x + y; };\nadd(5, 10) != 15;";
+
+  SECTION("match owned tokens") {
+    auto owned = Lexer{input};
+    auto views = Lexer{std::string_view{input}};
+    for (;;) {
+      auto tok  = owned.next_token();
+      auto view = views.next_view();
+      REQUIRE(view.type == tok.type);
+      REQUIRE(view.literal == tok.literal);
+      if (tok.type == Token::Type::EOF_) break;
+    }
+  }
+
+  SECTION("point into the source") {
+    auto lex = Lexer{std::string_view{input}};
+    for (auto tok = lex.next_view(); tok.type != Token::Type::EOF_;
+         tok      = lex.next_view()) {
+      auto offset = tok.literal.data() - input.data();
+      REQUIRE(input.substr(offset, tok.literal.size()) == tok.literal);
+    }
+  }
+
+  SECTION("survive a move of an owning lexer") {
+    auto lex = Lexer{string{"foobar == x"}};
+    REQUIRE(lex.next_view() == TokenView{Token::Type::IDENT, "foobar"});
+    auto moved = std::move(lex);
+    REQUIRE(moved.next_view() == TokenView{Token::Type::EQ, "=="});
+    REQUIRE(moved.next_view() == TokenView{Token::Type::IDENT, "x"});
+    REQUIRE(moved.next_view().type == Token::Type::EOF_);
+  }
+
+  SECTION("own a copy of a string they are not given") {
+    string source = "foobar";
+    Lexer lex{source};
+    source = "barfoo";
+    REQUIRE(lex.next_view() == TokenView{Token::Type::IDENT, "foobar"});
+  }
+}
+
+TEST_CASE("token stream") {
+  string input = "let add = fn(x, y) { x + y; };\nadd(5, 10) != 15;";
+  TokenStream tokens{input};
+
+  Lexer lex{std::string_view{input}};
+  size_t i{0};
+  for (auto tok = lex.next_view();; tok = lex.next_view(), ++i) {
+    REQUIRE(tokens[i] == tok);
+    REQUIRE(tokens.offsets[i] == tok.literal.data() - input.data());
+    if (tok.type == Token::Type::EOF_) break;
+  }
+  REQUIRE(tokens.size() == i + 1);
+  REQUIRE(tokens.type(i + 100) == Token::Type::EOF_);
+  REQUIRE(tokens.literal(i + 100).empty());
+}
+
+TEST_CASE("stream lexer") {
+  string input = "let five = 5;\nlet add = fn(x, y) { x + y; };\n"
+                 "if (add(five, 10) != 15) { return false } else { !true == "
+                 "false }";
+  vector<Token> expected{};
+  Lexer lex{input};
+  for (auto tok = lex.next_token();; tok = lex.next_token()) {
+    expected.push_back(tok);
+    if (tok.type == Token::Type::EOF_) break;
+  }
+
+  auto lex_chunks = [](const vector<string>& chunks) {
+    StreamLexer stream{};
+    vector<Token> tokens{};
+    for (auto& chunk : chunks) {
+      stream.push(chunk);
+      while (auto tok = stream.poll()) tokens.push_back(std::move(*tok));
+    }
+    stream.close();
+    while (auto tok = stream.poll()) tokens.push_back(std::move(*tok));
+    return tokens;
+  };
+
+  SECTION("split at every position") {
+    for (size_t i{0}; i <= input.size(); ++i) {
+      REQUIRE(lex_chunks({input.substr(0, i), input.substr(i)}) == expected);
+    }
+  };
+
+  SECTION("one byte at a time") {
+    vector<string> bytes{};
+    for (char c : input) bytes.emplace_back(1, c);
+    REQUIRE(lex_chunks(bytes) == expected);
+  };
+
+  SECTION("emits tokens before the input ends") {
+    StreamLexer stream{};
+    stream.push("let x = 1");
+    REQUIRE(stream.poll() == Token{Token::Type::LET, "let"});
+    REQUIRE(stream.poll() == Token{Token::Type::IDENT, "x"});
+    REQUIRE(stream.poll() == Token{Token::Type::ASSIGN, "="});
+    REQUIRE_FALSE(stream.poll());
+    stream.push("0;");
+    REQUIRE(stream.poll() == Token{Token::Type::INT, "10"});
+    REQUIRE(stream.poll() == Token{Token::Type::SEMICOLON, ";"});
+  };
+}
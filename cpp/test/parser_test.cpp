@@ -9,7 +9,6 @@
 using namespace monkey;
 using namespace fmt::literals;
 using ranges::views::enumerate;
-using std::make_unique;
 using std::string;
 using std::vector;
 using color = fmt::terminal_color;
@@ -99,12 +98,14 @@ return 993322;
   };
 
   SECTION("to_str") {
-    auto lstmt  = make_unique<LetStatement>(Token{Token::Type::LET, "let"});
-    lstmt->name = make_unique<Identifier>(Token{Token::Type::IDENT, "myVar"});
-    lstmt->value =
-        make_unique<Identifier>(Token{Token::Type::IDENT, "anotherVar"});
     Program p{};
-    p.statements.push_back(std::move(lstmt));
+    auto& arena = *p.arena;
+    auto lstmt  = arena.make<LetStatement>(TokenView{Token::Type::LET, "let"});
+    lstmt->name =
+        arena.make<Identifier>(TokenView{Token::Type::IDENT, "myVar"});
+    lstmt->value =
+        arena.make<Identifier>(TokenView{Token::Type::IDENT, "anotherVar"});
+    p.statements.push_back(lstmt);
     REQUIRE("{}"_format(p) == "let myVar = anotherVar;");
   };
 
@@ -311,3 +312,105 @@ TEST_CASE("expression parsing") {
     REQUIRE("{}"_format(stmt) == "add((((a + b) + ((c * d) / f)) + g))");
   };
 }
+
+TEST_CASE("parallel parsing") {
+  // Identifiers are letters only, so spell the index out in them.
+  auto name = [](int i) {
+    string s{};
+    do s += static_cast<char>('a' + i % 26);
+    while (i /= 26);
+    return s;
+  };
+  string input{};
+  for (int i{0}; i < 400; ++i) {
+    input += "let rule_{0} = fn(a, b) {{ if (a < b) {{ a * {1} }} else {{ b }} "
+             "}};\nlet value_{0} = rule_{0}({1}, 7) + -{1};\n"_format(name(i),
+                                                                     i);
+  }
+
+  auto sequential = [](const string& src) {
+    Lexer l{src};
+    Parser p{l};
+    Program program = p.parse_program();
+    return std::pair{"{}"_format(program), p.errors};
+  };
+
+  SECTION("same statements in source order") {
+    vector<string> errors{};
+    Program program = parse_program_parallel(input, errors, 4);
+    REQUIRE(errors.empty());
+    REQUIRE(program.statements.size() == 800);
+    REQUIRE("{}"_format(program) == sequential(input).first);
+  };
+
+  SECTION("errors keep their positions") {
+    auto broken = input;
+    auto at = broken.find("let value_" + name(350) + " =");
+    broken.replace(at, 14, "let value_mn ;");
+    broken += "\n  let = 5;";
+    vector<string> errors{};
+    Program program = parse_program_parallel(broken, errors, 4);
+    REQUIRE(errors == sequential(broken).second);
+    REQUIRE(errors.size() == 4);
+    REQUIRE(errors[0] == "702:14: expected next token to be ASSIGN but got "
+                         "SEMICOLON");
+    REQUIRE(errors[3] == "802:7: no prefix parse function for ASSIGN found");
+  };
+}
+
+TEST_CASE("node kinds") {
+  using Kind   = Node::Kind;
+  auto program = parse("let f = fn(x) { return -x; }; if (f(1) < 2) { true }");
+  REQUIRE(program.kind == Kind::PROGRAM);
+
+  auto& let = *program.statements[0];
+  REQUIRE(let.kind == Kind::LET);
+  auto& fn = *static_cast<LetStatement&>(let).value;
+  REQUIRE(fn.kind == Kind::FUNCTION);
+  auto& body = *static_cast<FunctionLiteral&>(fn).body;
+  REQUIRE(body.kind == Kind::BLOCK);
+  REQUIRE(body.statements[0]->kind == Kind::RETURN);
+  auto& neg = *static_cast<ReturnStatement&>(*body.statements[0]).return_value;
+  REQUIRE(neg.kind == Kind::PREFIX);
+  REQUIRE(static_cast<PrefixExpression&>(neg).right->kind == Kind::IDENTIFIER);
+
+  auto& stmt = *program.statements[1];
+  REQUIRE(stmt.kind == Kind::EXPRESSION);
+  auto& cond = *static_cast<ExpressionStatement&>(stmt).expression;
+  REQUIRE(cond.kind == Kind::IF);
+  auto& lt = *static_cast<IfExpression&>(cond).condition;
+  REQUIRE(lt.kind == Kind::INFIX);
+  auto& call = *static_cast<InfixExpression&>(lt).left;
+  REQUIRE(call.kind == Kind::CALL);
+  REQUIRE(static_cast<CallExpression&>(call).arguments[0]->kind
+          == Kind::INTEGER);
+  REQUIRE(static_cast<IfExpression&>(cond).consequence->statements[0]->kind
+          == Kind::EXPRESSION);
+}
+
+TEST_CASE("deep nesting") {
+  // Far deeper than the native stack would allow one frame per level.
+  constexpr size_t DEPTH = 100000;
+  auto repeat = [](std::string_view s, size_t n) {
+    string out{};
+    for (size_t i{0}; i < n; ++i) out += s;
+    return out;
+  };
+
+  SECTION("groups") {
+    auto program = parse(repeat("(", DEPTH) + "1" + repeat(" + 1)", DEPTH));
+    Node* node   = static_cast<ExpressionStatement&>(*program.statements[0])
+                     .expression;
+    size_t depth{0};
+    for (; node->kind == Node::Kind::INFIX; ++depth) {
+      node = static_cast<InfixExpression&>(*node).left;
+    }
+    REQUIRE(depth == DEPTH);
+  };
+  SECTION("prefixes, calls and blocks") {
+    parse(repeat("-", DEPTH) + "1");
+    parse(repeat("f(", DEPTH) + repeat(")", DEPTH));
+    parse(repeat("if (x) { ", DEPTH) + repeat("}", DEPTH));
+    parse(repeat("fn() { ", DEPTH) + repeat("}", DEPTH));
+  };
+}
@@ -0,0 +1,161 @@
+#include "monkey/register_vm.h"
+
+#include <monkey/evaluator.h>
+#include <monkey/lexer.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+static reg::Bytecode test_compile(string input) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+  reg::Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  REQUIRE(compiler.errors.empty());
+  return bytecode;
+}
+
+static Value test_run(string input) {
+  Lexer l{input};
+  auto program = Parser{l}.parse_program();
+  reg::Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  if (!compiler.errors.empty()) return Value::error(compiler.errors.front());
+  return reg::VM{}.run(bytecode);
+}
+
+/// `count` lets of distinct globals, named v, vb, vc, ..., vab, ...
+static string lets(int count) {
+  string program{};
+  for (int i{0}; i < count; ++i) {
+    string name{"v"};
+    for (int n{i}; n > 0; n /= 26) name += char('a' + n % 26);
+    program += "let " + name + " = true;";
+  }
+  return program;
+}
+
+/// `0 + 1 + ... + 1` with `depth` additions, each in its own parentheses.
+/// `depth` nested ifs, which need no registers of their own.
+static string nested(int depth) {
+  string program{};
+  for (int i{0}; i < depth; ++i) program += "if (true) { ";
+  program += "1";
+  for (int i{0}; i < depth; ++i) program += " }";
+  return program;
+}
+
+TEST_CASE("register vm") {
+  SECTION("operands are read in place") {
+    auto bc = test_compile("fn(a, b) { let c = a * b; c + 1 }");
+    auto& fn = bc.constants[1].as<reg::Prototype>();
+    REQUIRE(reg::disassemble(fn.code) == "0000 OpMul 2 0 1\n"
+                                         "0001 OpLoadConstant 4 0\n"
+                                         "0002 OpAdd 3 2 4\n"
+                                         "0003 OpReturn 3\n");
+    REQUIRE(fn.registers == 5);
+  };
+  SECTION("calls pass arguments in consecutive registers") {
+    auto bc = test_compile("let f = fn(x) { f(x - 1) };");
+    auto& fn = bc.constants[1].as<reg::Prototype>();
+    REQUIRE(reg::disassemble(fn.code) == "0000 OpCurrentClosure 2\n"
+                                         "0001 OpLoadConstant 4 0\n"
+                                         "0002 OpSub 3 0 4\n"
+                                         "0003 OpCall 1 2 1\n"
+                                         "0004 OpReturn 1\n");
+  };
+  SECTION("matches the evaluator") {
+    for (string input : {
+             "-50 + 100 + -50",
+             "(5 + 10 * 2 + 15 / 3) * 2 + -10",
+             "!!5",
+             "!(if (false) { 5; })",
+             "(1 > 2) != false",
+             "if (1 > 2) { 10 } else { 20 }",
+             "9; return 2 * 5; 9;",
+             "if (10 > 1) { if (10 > 1) { return 10; } return 1; }",
+             "let a = 5; let b = a; let c = a + b + 5; c;",
+             "let a = 5;",
+             "",
+             "fn(x) { x + 2; };",
+             "let add = fn(x, y) { x + y; }; add(5, add(5, 5));",
+             "fn() { }()",
+             "fn(x) { let y = if (x) { let z = 2; z } else { 3 }; y + z }(1)",
+             "let f = fn(x) { if (x > 1) { return x; } 0 }; f(2) + f(1)",
+             "let fib = fn(n) { if (n < 2) { n } else { "
+             "fib(n - 1) + fib(n - 2) } }; fib(15)",
+             "let newAdder = fn(x) { fn(y) { x + y }; };"
+             "let addTwo = newAdder(2); addTwo(2);",
+             "let f = fn(a) { fn(b) { fn(c) { a + b + c } } }; f(1)(2)(3)",
+             "let f = fn(a) { let g = fn(n) { if (n == 0) { a } else { "
+             "g(n - 1) } }; g(3) }; f(7)",
+             "5 + true; 5;",
+             "-true",
+             "5 / 0",
+             "5(1)",
+             "fn(x) { x }()",
+             "let f = fn(x) { x + true }; f(1) + 2",
+             "(-9223372036854775807 - 1) / -1",
+             "-(-9223372036854775807 - 1) + 9223372036854775807 + 1",
+             "4611686018427387904 * 2 - 1",
+         }) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      INFO(input);
+      REQUIRE(test_run(input).inspect() == eval(program).inspect());
+    }
+  };
+  SECTION("errors") {
+    REQUIRE(test_run("foobar").inspect()
+            == "ERROR: identifier not found: foobar");
+    REQUIRE(test_run("let f = fn(x) { f(x) + 1 }; f(1)").inspect()
+            == "ERROR: stack overflow");
+    REQUIRE(test_run(lets(65537) + "v").inspect() == "ERROR: too many globals");
+    // Jumps past 65536 instructions, which their operands cannot reach.
+    REQUIRE(test_run(lets(40000) + "if (1 < 2) { 111 } else { 222 }").inspect()
+            == "ERROR: too much code");
+    REQUIRE(test_run(lets(20000) + "if (1 < 2) { 111 } else { 222 }").inspect()
+            == "111");
+    // Compiling recurses on the native stack.
+    REQUIRE(test_run("let f = fn() { " + nested(4000) + " }; f()").inspect()
+            == "1");
+    REQUIRE(test_run("let f = fn() { " + nested(30000) + " }; f()").inspect()
+            == "ERROR: nesting too deep");
+  };
+  SECTION("globals bound after their use") {
+    for (string input : {
+             "let g = fn() { h() }; let h = fn() { 5 }; g()",
+             R"(
+let even = fn(n) { if (n == 0) { true } else { odd(n - 1) } };
+let odd = fn(n) { if (n == 0) { false } else { even(n - 1) } };
+even(10);
+)",
+             "let f = fn() { later }; let x = f(); let later = 1; x",
+             "let x = x; 1",
+             "if (false) { let never = 1; }; never",
+             "let x = if (false) { 1 }; x",
+         }) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      INFO(input);
+      REQUIRE(test_run(input).inspect() == eval(program).inspect());
+    }
+  };
+  SECTION("dispatches fewer instructions than the stack vm") {
+    auto src = "let f = fn(a, b) { a * b + a - b }; f(3, 4)";
+    Lexer l{src};
+    auto program = Parser{l}.parse_program();
+    reg::Compiler compiler{};
+    reg::VM vm{};
+    REQUIRE(vm.run(compiler.compile(program)).as_integer() == 11);
+    // fn: Mul, Add, Sub, Return; top level: Closure, SetGlobal, GetGlobal,
+    // two LoadConstant, Call, Return.
+    REQUIRE(vm.dispatched == 11);
+  };
+}
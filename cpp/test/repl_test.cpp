@@ -9,11 +9,42 @@ using std::ostringstream;
 
 TEST_CASE("repl") {
   SECTION("simple") {
-    istringstream in{R"(let add = fn(x, y) { x + y; };)"};
+    istringstream in{"let add = fn(x, y) { x + y; };\nadd(2, 3)\nadd"};
     ostringstream out{};
 
     repl::start(in, out);
 
-    REQUIRE(out.str() == ">> let add = fn(x, y) { (x + y) };\n>> \n");
+    REQUIRE(out.str() == ">> >> 5\n>> fn(x, y) { (x + y) }\n>> \n");
+  };
+
+  SECTION("multi-line") {
+    istringstream in{"!(\ntrue\n)\n-5"};
+    ostringstream out{};
+
+    repl::start(in, out);
+
+    REQUIRE(out.str() == ">> .. .. false\n>> -5\n>> \n");
+  };
+
+  SECTION("functions outlive the lines that made them") {
+    for (auto engine : {repl::Engine::EVAL, repl::Engine::CLOSURES}) {
+      istringstream in{"let make = fn(x) { fn() { x * 2 } };\n"
+                       "let six = make(3);\nlet one = 1;\nsix() + one"};
+      ostringstream out{};
+
+      repl::start(in, out, engine);
+
+      REQUIRE(out.str() == ">> >> >> >> 7\n>> \n");
+    }
+  };
+
+  SECTION("vm") {
+    istringstream in{"let add = fn(x, y) { x + y; };\nadd(2, 3)\nadd\nfoo"};
+    ostringstream out{};
+
+    repl::start(in, out, repl::Engine::VM);
+
+    REQUIRE(out.str() == ">> >> 5\n>> fn(x, y) { (x + y) }\n"
+                         ">> ERROR: identifier not found: foo\n>> \n");
   };
 };
@@ -0,0 +1,176 @@
+#include "monkey/resolver.h"
+
+#include <monkey/evaluator.h>
+#include <monkey/lexer.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+static string test_eval(string input) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+  return eval(program).inspect();
+}
+
+template <class T>
+static T& as(Node* node) {
+  return static_cast<T&>(*node);
+}
+
+TEST_CASE("resolver") {
+  SECTION("addresses") {
+    Lexer l{"let f = fn(a) { let b = a; fn(c) { a + b + c + d } };"};
+    auto program = Parser{l}.parse_program();
+
+    auto& f     = as<FunctionLiteral>(as<LetStatement>(program.statements[0])
+                                      .value);
+    REQUIRE(as<LetStatement>(program.statements[0]).name->scope
+            == Identifier::Scope::GLOBAL);
+    // The inner function uses both of f's variables, so they get cells.
+    REQUIRE(f.slots == 0);
+    REQUIRE(f.cells == 2);
+    REQUIRE(f.captures.empty());
+    auto& let_b = as<LetStatement>(f.body->statements[0]);
+    REQUIRE(let_b.name->scope == Identifier::Scope::CELL);
+    REQUIRE(let_b.name->index == 1);
+    REQUIRE(as<Identifier>(let_b.value).scope == Identifier::Scope::CELL);
+    REQUIRE(as<Identifier>(let_b.value).index == 0);
+
+    auto& inner = as<FunctionLiteral>(
+        as<ExpressionStatement>(f.body->statements[1]).expression);
+    REQUIRE(inner.slots == 1);
+    REQUIRE(inner.cells == 0);
+    REQUIRE(inner.captures.size() == 2);
+    REQUIRE(inner.captures[0].scope == Identifier::Scope::CELL);
+    REQUIRE(inner.captures[0].index == 0);
+    REQUIRE(inner.captures[1].scope == Identifier::Scope::CELL);
+    REQUIRE(inner.captures[1].index == 1);
+    // ((a + b) + c) + d
+    auto& sum = as<InfixExpression>(
+        as<ExpressionStatement>(inner.body->statements[0]).expression);
+    auto& d   = as<Identifier>(sum.right);
+    auto& abc = as<InfixExpression>(sum.left);
+    auto& c   = as<Identifier>(abc.right);
+    auto& ab  = as<InfixExpression>(abc.left);
+    auto& a   = as<Identifier>(ab.left);
+    auto& b   = as<Identifier>(ab.right);
+    REQUIRE((a.scope == Identifier::Scope::CAPTURE && a.index == 0));
+    REQUIRE((b.scope == Identifier::Scope::CAPTURE && b.index == 1));
+    REQUIRE((c.scope == Identifier::Scope::LOCAL && c.index == 0));
+    REQUIRE(d.scope == Identifier::Scope::GLOBAL);
+  };
+  SECTION("captures pass through the functions in between") {
+    Lexer l{"fn(a, b) { fn(c) { fn() { a + c } } }"};
+    auto program = Parser{l}.parse_program();
+
+    auto& outer = as<FunctionLiteral>(
+        as<ExpressionStatement>(program.statements[0]).expression);
+    REQUIRE(outer.slots == 1);
+    REQUIRE(outer.cells == 1);
+    auto& middle = as<FunctionLiteral>(
+        as<ExpressionStatement>(outer.body->statements[0]).expression);
+    REQUIRE(middle.cells == 1);
+    REQUIRE(middle.captures.size() == 1);
+    REQUIRE(middle.captures[0].scope == Identifier::Scope::CELL);
+    auto& inner = as<FunctionLiteral>(
+        as<ExpressionStatement>(middle.body->statements[0]).expression);
+    REQUIRE(inner.captures.size() == 2);
+    REQUIRE(inner.captures[0].scope == Identifier::Scope::CAPTURE);
+    REQUIRE(inner.captures[0].index == 0);
+    REQUIRE(inner.captures[1].scope == Identifier::Scope::CELL);
+    REQUIRE(inner.captures[1].index == 0);
+
+    REQUIRE(test_eval("fn(a, b) { fn(c) { fn() { a + c } } }(1, 2)(3)()")
+            == "4");
+  };
+  SECTION("closures share their variables with the call") {
+    REQUIRE(test_eval("let f = fn() { let x = 1; let g = fn() { x }; "
+                      "let x = 2; g() }; f()")
+            == "2");
+    REQUIRE(test_eval("let make = fn(x) { fn() { x } };"
+                      "let a = make(1); let b = make(2); a() * 10 + b()")
+            == "12");
+  };
+  SECTION("a let is visible in its own body only after it") {
+    REQUIRE(test_eval("let x = 1; let f = fn() { let x = x + 1; x }; f()")
+            == "2");
+    REQUIRE(test_eval("let f = fn(x) { let x = x * 2; let x = x + 1; x }; "
+                      "f(5)")
+            == "11");
+  };
+  SECTION("and to nested functions anywhere") {
+    REQUIRE(test_eval("let f = fn() { let g = fn() { x }; let x = 5; g() };"
+                      "f()")
+            == "5");
+    REQUIRE(test_eval("let f = fn() {"
+                      "  let even = fn(n) { if (n == 0) { true } else { "
+                      "odd(n - 1) } };"
+                      "  let odd = fn(n) { if (n == 0) { false } else { "
+                      "even(n - 1) } };"
+                      "  even(10)"
+                      "}; f()")
+            == "true");
+  };
+  SECTION("lets in blocks belong to the function") {
+    REQUIRE(test_eval("fn(c) { if (c) { let y = 2; } else { let y = 3; }; "
+                      "y }(false)")
+            == "3");
+  };
+  SECTION("tail calls") {
+    Lexer l{"fn(n) { f(n); if (n) { return g(n); }; if (n) { h(n) } else { "
+            "i(j(n)) } }; k()"};
+    auto program = Parser{l}.parse_program();
+    auto& fn     = as<FunctionLiteral>(
+        as<ExpressionStatement>(program.statements[0]).expression);
+    auto& body   = fn.body->statements;
+
+    REQUIRE(!as<CallExpression>(
+                 as<ExpressionStatement>(body[0]).expression)
+                 .tail);
+    auto& first  = as<IfExpression>(
+        as<ExpressionStatement>(body[1]).expression);
+    REQUIRE(as<CallExpression>(
+                as<ReturnStatement>(first.consequence->statements[0])
+                    .return_value)
+                .tail);
+    auto& last = as<IfExpression>(as<ExpressionStatement>(body[2]).expression);
+    REQUIRE(as<CallExpression>(
+                as<ExpressionStatement>(last.consequence->statements[0])
+                    .expression)
+                .tail);
+    auto& i = as<CallExpression>(
+        as<ExpressionStatement>(last.alternative->statements[0]).expression);
+    REQUIRE(i.tail);
+    REQUIRE(!as<CallExpression>(i.arguments[0]).tail);
+    // Outside any function there is no call to replace.
+    REQUIRE(!as<CallExpression>(
+                 as<ExpressionStatement>(program.statements[1]).expression)
+                 .tail);
+  };
+  SECTION("operator depth") {
+    Lexer l{"-a + 2 * 3; 1 + f(2); (1 + 2) + if (x) { 3 }; " + string(300, '-')
+            + "1"};
+    auto program = Parser{l}.parse_program();
+    auto depth   = [&](size_t i) {
+      return as<ExpressionStatement>(program.statements[i])
+          .expression->operator_depth;
+    };
+
+    REQUIRE(depth(0) == 2);
+    // A call or an if makes the whole expression opaque, but not its
+    // operands made of operators alone.
+    REQUIRE(depth(1) == Node::OPAQUE);
+    auto& mixed = as<InfixExpression>(
+        as<ExpressionStatement>(program.statements[2]).expression);
+    REQUIRE(mixed.operator_depth == Node::OPAQUE);
+    REQUIRE(mixed.left->operator_depth == 1);
+    REQUIRE(depth(3) == Node::OPAQUE);
+    REQUIRE(program.statements[0]->operator_depth == Node::OPAQUE);
+  };
+}
@@ -0,0 +1,37 @@
+#include "monkey/scan.h"
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+TEST_CASE("scan") {
+  auto check = [](const string& input, auto fast, auto slow) {
+    // Every start offset and length, so blocks straddle the end of input
+    // and the first mismatch lands on every lane.
+    for (size_t from{0}; from <= input.size(); ++from) {
+      for (size_t to{from}; to <= input.size(); ++to) {
+        const char* b = input.data() + from;
+        const char* e = input.data() + to;
+        REQUIRE(fast(b, e) == slow(b, e));
+      }
+    }
+  };
+
+  SECTION("whitespace") {
+    string input = string(37, ' ') + "\t\r\n x" + string(20, '\n') + "\x80  ";
+    check(input, scan::skip_whitespace, scan::scalar::skip_whitespace);
+  };
+
+  SECTION("letters") {
+    string input = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                   "@[`{\x80\xe1Zz_aa0";
+    check(input, scan::skip_letters, scan::scalar::skip_letters);
+  };
+
+  SECTION("digits") {
+    string input = "0123456789012345678901234567890123456789/:a\xb0" "99";
+    check(input, scan::skip_digits, scan::scalar::skip_digits);
+  };
+}
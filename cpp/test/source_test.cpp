@@ -0,0 +1,44 @@
+#include "monkey/source.h"
+
+#include <monkey/lexer.h>
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+#include <unistd.h>
+
+using namespace monkey;
+using std::string;
+
+string write_temp(const string& contents) {
+  char path[] = "/tmp/monkey_source_XXXXXX";
+  close(mkstemp(path));
+  std::ofstream{path} << contents;
+  return path;
+}
+
+TEST_CASE("mapped file") {
+  SECTION("lexes from the mapping") {
+    auto path = write_temp("let x = 5;\nx == 5;");
+    MappedFile file{path};
+    REQUIRE(file.view() == "let x = 5;\nx == 5;");
+
+    Lexer lex{file.view()};
+    REQUIRE(lex.next_view() == TokenView{Token::Type::LET, "let"});
+    REQUIRE(lex.next_view().literal.data() == file.view().data() + 4);
+    std::remove(path.c_str());
+  };
+
+  SECTION("empty") {
+    auto path = write_temp("");
+    MappedFile file{path};
+    REQUIRE(file.view().empty());
+    REQUIRE(Lexer{file.view()}.next_view().type == Token::Type::EOF_);
+    std::remove(path.c_str());
+  };
+
+  SECTION("missing") {
+    REQUIRE_THROWS_AS(MappedFile{"/nonexistent/monkey.mk"}, std::system_error);
+  };
+}
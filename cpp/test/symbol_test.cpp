@@ -0,0 +1,63 @@
+#include "monkey/symbol.h"
+
+#include <monkey/parser.h>
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace monkey;
+using std::string;
+
+TEST_CASE("symbol") {
+  SECTION("interning") {
+    auto a = Symbol::intern("first_argument");
+    auto b = Symbol::intern(string{"first_"} + "argument");
+    auto c = Symbol::intern("second_argument");
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+    REQUIRE(a.name() == "first_argument");
+    REQUIRE(c == "second_argument");
+    REQUIRE(Symbol{}.name().empty());
+    REQUIRE(Symbol::intern("") == Symbol{});
+  };
+
+  SECTION("names are read while others are interned") {
+    auto name = [](int i) {
+      string name{"symbol_"};
+      for (; i > 0; i /= 26) name += static_cast<char>('a' + i % 26);
+      return name;
+    };
+    std::vector<Symbol> symbols(20000);
+    std::atomic<int> interned{0};
+    std::thread writer{[&] {
+      for (int i{0}; i < 20000; ++i) {
+        symbols[i] = Symbol::intern(name(i));
+        interned.store(i + 1, std::memory_order_release);
+      }
+    }};
+    int wrong{0};
+    for (int done{0}; done < 20000;) {
+      done = interned.load(std::memory_order_acquire);
+      for (int i{done > 64 ? done - 64 : 0}; i < done; ++i) {
+        if (symbols[i].name() != name(i)) ++wrong;
+      }
+    }
+    writer.join();
+    REQUIRE(wrong == 0);
+  };
+
+  SECTION("shared by every identifier with the same name") {
+    Lexer l{"let x = fn(x, y) { x + y }; x"};
+    Parser p{l};
+    Program program = p.parse_program();
+    auto& let = dynamic_cast<LetStatement&>(*program.statements[0]);
+    auto& fn  = dynamic_cast<FunctionLiteral&>(*let.value);
+    auto& use = dynamic_cast<ExpressionStatement&>(*program.statements[1]);
+    REQUIRE(let.name->value == fn.parameters[0].value);
+    REQUIRE(dynamic_cast<Identifier&>(*use.expression).value.id
+            == let.name->value.id);
+  };
+}
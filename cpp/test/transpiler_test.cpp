@@ -0,0 +1,95 @@
+#include "monkey/transpiler.h"
+
+#include <monkey/evaluator.h>
+#include <monkey/lexer.h>
+#include <monkey/parser.h>
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+/// What the compiled program prints, which must be what eval makes of it.
+static string test_compile(string input) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+
+  auto path =
+      (std::filesystem::temp_directory_path() / "monkey-transpiler-test")
+          .string();
+  REQUIRE(build(transpile(program), path) == 0);
+  string output{};
+  auto* pipe = popen((path + " 2>&1").c_str(), "r");
+  REQUIRE(pipe);
+  char buffer[256];
+  while (auto n = fread(buffer, 1, sizeof buffer, pipe)) {
+    output.append(buffer, n);
+  }
+  pclose(pipe);
+  std::filesystem::remove(path);
+
+  // Coverage builds may add lines of their own as the program exits.
+  auto value = eval(program);
+  REQUIRE(output.substr(0, output.find('\n')) == value.inspect());
+  return value.inspect();
+}
+
+TEST_CASE("transpiler") {
+  SECTION("values") {
+    REQUIRE(test_compile(R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+let adder = fn(x) { fn(y) { x + y } };
+let twice = fn(f, x) { f(f(x)) };
+let f = fn(x) {
+  let y = if (x > 5) { return x * 10; } else { x };
+  let g = fn() { y + h() };
+  let h = fn() { 100 };
+  if (!(y == 3)) { g() } else { -g() }
+};
+let check = fn(a, b) { if (a == b) { 1 } else { 1 / 0 } };
+check(fib(15), 610) + check(twice(adder(3), 4), 10) + check(f(1), 101)
+  + check(f(3), -103) + check(f(7), 170) + check(true != false, true);
+)") == "6");
+    REQUIRE(test_compile("fn(x) { x * 2 };") == "fn(x) { (x * 2) }");
+    REQUIRE(test_compile(R"(
+let min = -9223372036854775807 - 1;
+let f = fn(a, b) { a / b + -a * b - 1 };
+f(min, -1);
+)") == "-1");
+  }
+
+  SECTION("errors") {
+    REQUIRE(test_compile("let f = fn(x) { x + true }; f(1); 5")
+            == "ERROR: type mismatch: INTEGER + BOOLEAN");
+    REQUIRE(test_compile("let f = fn() { missing }; f(1)")
+            == "ERROR: wrong number of arguments: want=0, got=1");
+    REQUIRE(test_compile("let f = fn() { missing(1 / 0) }; f()")
+            == "ERROR: identifier not found: missing");
+    REQUIRE(test_compile("5(1 / 0)") == "ERROR: division by zero");
+    REQUIRE(test_compile("true(1)") == "ERROR: not a function: BOOLEAN");
+  }
+
+  SECTION("output paths") {
+    // Nothing in the path reaches a shell.
+    auto dir = std::filesystem::temp_directory_path() / "monkey 'test' $(x)";
+    std::filesystem::create_directories(dir);
+    auto path = (dir / "it's \"a\" program;").string();
+    Lexer l{"1 + 2"};
+    REQUIRE(build(transpile(Parser{l}.parse_program()), path) == 0);
+    REQUIRE(std::filesystem::exists(path));
+    std::filesystem::remove_all(dir);
+  }
+
+  SECTION("deep recursion") {
+    REQUIRE(test_compile(R"(
+let sum = fn(n) { if (n == 0) { 0 } else { n + sum(n - 1) } };
+let loop = fn(n, acc) { if (n == 0) { return acc; } loop(n - 1, acc + 1) };
+sum(100000) + loop(1000000, 0);
+)") == "5001050000");
+  }
+}
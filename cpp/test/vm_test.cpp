@@ -0,0 +1,165 @@
+#include "monkey/vm.h"
+
+#include <monkey/closure_tree.h>
+#include <monkey/evaluator.h>
+#include <monkey/lexer.h>
+#include <monkey/parser.h>
+#include <monkey/register_vm.h>
+
+#include <catch2/catch.hpp>
+#include <string>
+
+using namespace monkey;
+using std::string;
+
+static Value test_run(string input) {
+  Lexer l{input};
+  Parser p{l};
+  auto program = p.parse_program();
+  REQUIRE(p.errors.empty());
+  Compiler compiler{};
+  auto bytecode = compiler.compile(program);
+  if (!compiler.errors.empty()) return Value::error(compiler.errors.front());
+  return VM{}.run(bytecode);
+}
+
+/// `count` lets of distinct globals, named v, vb, vc, ..., vab, ...
+static string lets(int count) {
+  string program{};
+  for (int i{0}; i < count; ++i) {
+    string name{"v"};
+    for (int n{i}; n > 0; n /= 26) name += char('a' + n % 26);
+    program += "let " + name + " = true;";
+  }
+  return program;
+}
+
+/// `0 + 1 + ... + 1` with `depth` additions, each in its own parentheses.
+static string nested(int depth) {
+  string program(depth, '(');
+  program += "0";
+  for (int i{0}; i < depth; ++i) program += " + 1)";
+  return program;
+}
+
+TEST_CASE("vm") {
+  SECTION("matches the evaluator") {
+    for (string input : {
+             "5",
+             "-50 + 100 + -50",
+             "(5 + 10 * 2 + 15 / 3) * 2 + -10",
+             "!!5",
+             "!(if (false) { 5; })",
+             "(1 < 2) == true",
+             "(1 > 2) != false",
+             "1 == 1; true == false",
+             "if (1) { 10 }",
+             "if (false) { 10 }",
+             "if (1 > 2) { 10 } else { 20 }",
+             "return 10; 9;",
+             "9; return 2 * 5; 9;",
+             "if (10 > 1) { if (10 > 1) { return 10; } return 1; }",
+             "let a = 5; let b = a; let c = a + b + 5; c;",
+             "let a = 5;",
+             "",
+             "fn(x) { x + 2; };",
+             "let identity = fn(x) { return x; }; identity(5);",
+             "let add = fn(x, y) { x + y; }; add(5, add(5, 5));",
+             "fn(x) { x; }(5)",
+             "fn() { }()",
+             "fn() { let a = 1; }()",
+             "let f = fn(x) { if (x > 1) { return x; } 0 }; f(2) + f(1)",
+             "let fib = fn(n) { if (n < 2) { n } else { "
+             "fib(n - 1) + fib(n - 2) } }; fib(15)",
+             "let newAdder = fn(x) { fn(y) { x + y }; };"
+             "let addTwo = newAdder(2); addTwo(2);",
+             "let f = fn(a) { fn(b) { fn(c) { a + b + c } } }; f(1)(2)(3)",
+             "let f = fn(a) { let g = fn(n) { if (n == 0) { a } else { "
+             "g(n - 1) } }; g(3) }; f(7)",
+             "5 + true; 5;",
+             "-true",
+             "if (10 > 1) { true + false; }",
+             "5 / 0",
+             "5(1)",
+             "fn(x) { x }()",
+             "let f = fn(x) { x + true }; f(1) + 2",
+             "(-9223372036854775807 - 1) / -1",
+             "-(-9223372036854775807 - 1) + 9223372036854775807 + 1",
+             "4611686018427387904 * 2 - 1",
+         }) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      INFO(input);
+      REQUIRE(test_run(input).inspect() == eval(program).inspect());
+    }
+  };
+  SECTION("compile errors") {
+    REQUIRE(test_run("foobar").inspect()
+            == "ERROR: identifier not found: foobar");
+    // One more global than there are slots.
+    REQUIRE(test_run(lets(65537) + "v").inspect() == "ERROR: too many globals");
+    // Jumps past 64 KiB of bytecode, which their operands cannot reach.
+    REQUIRE(test_run(lets(20000) + "if (1 < 2) { 111 } else { 222 }").inspect()
+            == "ERROR: too much code");
+    REQUIRE(test_run(lets(10000) + "if (1 < 2) { 111 } else { 222 }").inspect()
+            == "111");
+    // Compiling recurses on the native stack.
+    REQUIRE(test_run(nested(4000)).inspect() == "4000");
+    REQUIRE(test_run(nested(30000)).inspect() == "ERROR: nesting too deep");
+  };
+  SECTION("names bound after their use") {
+    // Globals are declared before the program runs.
+    for (string input : {
+             "let g = fn() { h() }; let h = fn() { 5 }; g()",
+             R"(
+let even = fn(n) { if (n == 0) { true } else { odd(n - 1) } };
+let odd = fn(n) { if (n == 0) { false } else { even(n - 1) } };
+even(10);
+)",
+             "let f = fn() { later }; let x = f(); let later = 1; x",
+             "let x = x; 1",
+             "if (false) { let never = 1; }; never",
+             "let x = if (false) { 1 }; x",
+         }) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      INFO(input);
+      REQUIRE(test_run(input).inspect() == eval(program).inspect());
+    }
+    // Locals are resolved where they are used under the compilers, and
+    // where they run under eval and the closure tree, so only the latter
+    // see later bindings.
+    for (string input : {
+             "let f = fn() { let g = fn() { x }; let x = 5; g() }; f()",
+         }) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      REQUIRE(eval(program).inspect() == "5");
+      REQUIRE(closure::Tree{program}.run().inspect() == "5");
+      Compiler compiler{};
+      compiler.compile(program);
+      reg::Compiler reg_compiler{};
+      reg_compiler.compile(program);
+      for (auto& errors : {compiler.errors, reg_compiler.errors}) {
+        REQUIRE(errors.size() == 1);
+        REQUIRE(errors.front().starts_with("identifier not found: "));
+      }
+    }
+  };
+  SECTION("stack overflow") {
+    REQUIRE(test_run("let f = fn(x) { f(x) + 1 }; f(1)").inspect()
+            == "ERROR: stack overflow");
+  };
+  SECTION("globals persist across runs") {
+    Compiler compiler{};
+    VM vm{};
+    auto run = [&](string input) {
+      Lexer l{input};
+      auto program = Parser{l}.parse_program();
+      return vm.run(compiler.compile(program)).inspect();
+    };
+    REQUIRE(run("let add = fn(x, y) { x + y };") == "null");
+    REQUIRE(run("let three = add(1, 2);") == "null");
+    REQUIRE(run("add(three, 4)") == "7");
+  };
+}